@@ -0,0 +1,119 @@
+#include "alphabetatracker.h"
+
+#include <cmath>
+#include <limits>
+
+namespace mgo
+{
+
+namespace
+{
+
+// If we haven't had an edge for this long, the spindle has
+// stopped (or near enough), and we start again
+constexpr int32_t STALE_MICROSECONDS = 100'000;
+
+// ...or for this many of the usual intervals between them, which is
+// sooner when it was going quickly
+constexpr double STALE_INTERVALS = 8.0;
+
+// Weighting for the running averages used for the uncertainty
+constexpr double SMOOTHING = 0.05;
+
+} // end anonymous namespace
+
+void AlphaBetaTracker::reset()
+{
+    m_position = 0.0;
+    m_velocity = 0.0;
+    m_residualSquared = 0.0;
+    m_interval = 0.0;
+    m_updates = 0;
+}
+
+void AlphaBetaTracker::update( double position, uint32_t tick )
+{
+    int32_t dt = static_cast<int32_t>( tick - m_lastTick ); // handles wrap
+    if( m_updates > 0 && ( dt > STALE_MICROSECONDS || dt < 0 ) )
+    {
+        reset();
+    }
+    if( m_updates == 0 )
+    {
+        m_position = position;
+        m_lastTick = tick;
+        ++m_updates;
+        return;
+    }
+    if( dt == 0 )
+    {
+        // Two edges within the same microsecond; the best we can do
+        // is take the latest position
+        m_position = position;
+        return;
+    }
+    if( m_updates == 1 )
+    {
+        // Second point gives us our first velocity
+        m_velocity = ( position - m_position ) / dt;
+        m_position = position;
+        m_interval = dt;
+        m_lastTick = tick;
+        ++m_updates;
+        return;
+    }
+
+    double predicted = m_position + m_velocity * dt;
+    double residual = position - predicted;
+    m_position = predicted + m_alpha * residual;
+    m_velocity += m_beta * residual / dt;
+
+    m_residualSquared += SMOOTHING * ( residual * residual - m_residualSquared );
+    m_interval += SMOOTHING * ( dt - m_interval );
+    m_lastTick = tick;
+    if( m_updates < std::numeric_limits<unsigned>::max() )
+    {
+        ++m_updates;
+    }
+}
+
+bool AlphaBetaTracker::stale( uint32_t tick ) const
+{
+    int32_t dt = static_cast<int32_t>( tick - m_lastTick );
+    return dt > STALE_MICROSECONDS ||
+        ( m_interval > 0.0 && dt > STALE_INTERVALS * m_interval );
+}
+
+TrackerEstimate AlphaBetaTracker::estimateAt( uint32_t tick ) const
+{
+    if( ! valid() || stale( tick ) )
+    {
+        return { m_position, 0.0, std::numeric_limits<double>::infinity(), false };
+    }
+    int32_t dt = static_cast<int32_t>( tick - m_lastTick );
+    // The residuals tell us how far out we are when predicting one edge
+    // ahead; predicting further ahead than that is proportionally worse
+    double uncertainty = std::sqrt( m_residualSquared );
+    if( m_interval > 0.0 && std::abs( dt ) > m_interval )
+    {
+        uncertainty *= std::abs( dt ) / m_interval;
+    }
+    return { m_position + m_velocity * dt, m_velocity, uncertainty, true };
+}
+
+bool AlphaBetaTracker::tickAtPosition( double position, uint32_t& tick ) const
+{
+    if( ! valid() || m_velocity == 0.0 )
+    {
+        return false;
+    }
+    double dt = ( position - m_position ) / m_velocity;
+    if( std::abs( dt ) > std::numeric_limits<int32_t>::max() )
+    {
+        return false;
+    }
+    tick = m_lastTick + static_cast<int32_t>( std::lround( dt ) );
+    return true;
+}
+
+} // end namespace
@@ -0,0 +1,75 @@
+#pragma once
+// An alpha-beta (fixed-gain, constant-velocity) tracker. The rotary
+// encoder feeds it the position count at the last edge of each batch it
+// gets from pigpio, along with the gpio tick of that edge, and it keeps a smoothed estimate of position
+// and velocity which can be extrapolated to any other tick. This lets us
+// say where the spindle is "now" (or at some tick in the future) to a
+// fraction of an encoder count, rather than to the last edge we saw.
+
+#include <cstdint>
+
+namespace mgo
+{
+
+struct TrackerEstimate
+{
+    double position;    // counts
+    double velocity;    // counts per microsecond
+    double uncertainty; // counts, approx one standard deviation
+    bool   valid;
+};
+
+class AlphaBetaTracker
+{
+public:
+    // Defaults are critically damped (beta = alpha^2 / (2 - alpha)).
+    // Larger alpha follows speed changes more quickly but lets more of the
+    // encoder's edge-spacing error through.
+    explicit AlphaBetaTracker( double alpha = 0.2, double beta = 0.0222 )
+        : m_alpha( alpha ), m_beta( beta ) {}
+
+    // Forget everything, e.g. after the spindle stops
+    void reset();
+
+    // Feed in a measured position (an exact count at an edge)
+    void update( double position, uint32_t tick );
+
+    // Moves the position estimate without affecting velocity, e.g.
+    // when the count is corrected by an index pulse
+    void shift( double delta )
+    {
+        m_position += delta;
+    }
+
+    // Where we think we are at the given tick. Not valid if, by then,
+    // we'd have gone too long without an edge to trust the velocity
+    // (the spindle may well have stopped).
+    TrackerEstimate estimateAt( uint32_t tick ) const;
+
+    // When we think we will reach (or did reach) the given position.
+    // Returns false if we have no estimate or aren't moving. This
+    // doesn't know the time now, so check stale() first.
+    bool tickAtPosition( double position, uint32_t& tick ) const;
+
+    // Whether it's been too long since the last edge, at the given tick
+    bool stale( uint32_t tick ) const;
+
+    bool valid() const
+    {
+        return m_updates >= 2;
+    }
+
+private:
+    double   m_alpha;
+    double   m_beta;
+    double   m_position{ 0.0 };
+    double   m_velocity{ 0.0 };
+    // Running mean square of the prediction residuals, and of the
+    // interval between updates, used for the uncertainty estimate
+    double   m_residualSquared{ 0.0 };
+    double   m_interval{ 0.0 };
+    uint32_t m_lastTick{ 0 };
+    unsigned m_updates{ 0 };
+};
+
+} // end namespace
@@ -0,0 +1,90 @@
+#include "commandexecutor.h"
+
+#include "log.h"
+
+#include <exception>
+
+namespace mgo
+{
+
+namespace
+{
+
+// Producers don't take the mutex to wake us (so they can't be held up by
+// it), which means a wakeup can occasionally be missed. We never sleep
+// longer than this, so one is late by this much at worst.
+constexpr auto MAX_SLEEP = std::chrono::milliseconds( 5 );
+
+} // end anonymous namespace
+
+CommandExecutor::CommandExecutor( Handler handler )
+    : m_handler( std::move( handler ) ),
+      m_discardBefore( std::chrono::steady_clock::time_point::min().time_since_epoch().count() )
+{
+    m_thread = std::thread( &CommandExecutor::threadFunction, this );
+}
+
+CommandExecutor::~CommandExecutor()
+{
+    m_quit = true;
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+bool CommandExecutor::post( Command command )
+{
+    command.enqueued = std::chrono::steady_clock::now();
+    if( ! m_queue.push( command ) )
+    {
+        ++m_dropped;
+        return false;
+    }
+    m_cv.notify_one();
+    return true;
+}
+
+void CommandExecutor::discardQueued()
+{
+    m_discardBefore = std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+void CommandExecutor::threadFunction()
+{
+    while( ! m_quit )
+    {
+        Command command;
+        if( ! m_queue.pop( command ) )
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_cv.wait_for( lock, MAX_SLEEP );
+            continue;
+        }
+        // Before looking at whether it's been discarded, so that anyone
+        // who discards it and then sees us not busy knows it won't run
+        m_busy = true;
+        if( command.enqueued.time_since_epoch().count() <= m_discardBefore )
+        {
+            m_busy = false;
+            continue;
+        }
+        auto waited = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - command.enqueued ).count();
+        if( waited > m_longestWait )
+        {
+            m_longestWait = static_cast<uint32_t>( waited );
+        }
+        try
+        {
+            m_handler( command );
+        }
+        catch( const std::exception& e )
+        {
+            // Nobody above us to catch it, and one bad command shouldn't
+            // stop the keys working
+            MGOLOG( "Command " << command.key << " failed: " << e.what() );
+        }
+        m_busy = false;
+    }
+}
+
+} // end namespace
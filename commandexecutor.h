@@ -0,0 +1,91 @@
+#pragma once
+// Carries out commands (keypresses, as far as the controller is
+// concerned) one at a time, in order, on a thread of its own. Much of
+// what a key does waits for a motor to stop, which can take a second or
+// more while the carriage decelerates; done here, the UI carries on
+// drawing and reading keys meanwhile - including the stop key.
+//
+// Posting never blocks: commands go on a lock-free queue, each with the
+// time it was posted so we can see how long they wait. If the queue is
+// full (something has hung), the command is dropped.
+
+#include "mpscqueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace mgo
+{
+
+struct Command
+{
+    int key{ 0 };
+    // When the key was taken from the UI toolkit, and converted to our
+    // code; only for timing
+    std::chrono::steady_clock::time_point polled;
+    std::chrono::steady_clock::time_point converted;
+    // Set by post()
+    std::chrono::steady_clock::time_point enqueued;
+};
+
+class CommandExecutor
+{
+public:
+    using Handler = std::function<void( const Command& )>;
+
+    explicit CommandExecutor( Handler handler );
+    // Finishes the command in hand (if any); the rest are dropped
+    ~CommandExecutor();
+
+    CommandExecutor( const CommandExecutor& ) = delete;
+    CommandExecutor& operator=( const CommandExecutor& ) = delete;
+
+    // Any thread. Returns false if the queue is full.
+    bool post( Command command );
+
+    // Any thread. Everything posted so far, and not yet started, is
+    // dropped. For an emergency stop, which is carried out straight away
+    // rather than queued, so that the keys before it don't start
+    // anything afterwards.
+    void discardQueued();
+
+    // Any thread. Whether a command has been taken off the queue and not
+    // yet finished. Once this is false after a discardQueued(), nothing
+    // from before it can still be under way.
+    bool isBusy() const
+    {
+        return m_busy;
+    }
+
+    // Longest a command has waited between being posted and started
+    uint32_t getLongestWaitMicroseconds() const
+    {
+        return m_longestWait;
+    }
+    uint64_t getDropped() const
+    {
+        return m_dropped;
+    }
+
+private:
+    void threadFunction();
+
+    Handler m_handler;
+    MpscQueue<Command, 64> m_queue;
+    // Only used for the thread to sleep on when there's nothing to do
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::atomic<std::chrono::steady_clock::rep> m_discardBefore;
+    std::atomic<bool>     m_quit{ false };
+    std::atomic<bool>     m_busy{ false };
+    std::atomic<uint32_t> m_longestWait{ 0 };
+    std::atomic<uint64_t> m_dropped{ 0 };
+    std::thread m_thread;
+};
+
+} // end namespace
@@ -30,6 +30,20 @@ public:
 
 class MockConfigReader: public IConfigReader
 {
+public:
+    // Lets a test give a number for a key, which readDouble() then returns
+    // instead of the default
+    void setDouble( const std::string& key, double value )
+    {
+        m_doubles[ key ] = value;
+    }
+    // ...and likewise for readBool()
+    void setBool( const std::string& key, bool value )
+    {
+        m_bools[ key ] = value;
+    }
+
+private:
     std::string read(
         const std::string&,
         const std::string& defaultValue = ""
@@ -45,17 +59,22 @@ class MockConfigReader: public IConfigReader
         return defaultValue;
     }
     double readDouble(
-        const std::string&,
+        const std::string& key,
         double defaultValue = 0.0 ) override
     {
-        return defaultValue;
+        auto it = m_doubles.find( key );
+        return it == m_doubles.end() ? defaultValue : it->second;
     }
     bool readBool(
-        const std::string&,
+        const std::string& key,
         bool defaultValue ) override
     {
-        return defaultValue;
+        auto it = m_bools.find( key );
+        return it == m_bools.end() ? defaultValue : it->second;
     }
+
+    std::unordered_map<std::string, double> m_doubles;
+    std::unordered_map<std::string, bool>   m_bools;
 };
 
 class ConfigReader : public IConfigReader
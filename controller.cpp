@@ -7,29 +7,21 @@
 #include "threadpitches.h"
 #include "view_sfml.h"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <fstream>
+#include <sstream>
 
 namespace mgo
 {
 
-namespace
-{
-
-void yieldSleep( std::chrono::microseconds microsecs )
-{
-    auto start = std::chrono::high_resolution_clock::now();
-    auto end = start + microsecs;
-    while( std::chrono::high_resolution_clock::now() < end )
-    {
-        std::this_thread::yield();
-    }
-}
-
-} // end anonymous namespace
-
-Controller::Controller( Model* model )
-    : m_model( model )
+Controller::Controller( Model* model, LatencyMonitor* latency )
+    : m_model( model ),
+      m_latency( latency ),
+      m_keys(
+          static_cast<int>( model->m_config.readLong( "Axis1Leader", 122L ) ),
+          static_cast<int>( model->m_config.readLong( "Axis2Leader", 120L ) ) )
 {
     m_view = std::make_unique<ViewSfml>();
     m_view->initialise( *m_model );
@@ -42,872 +34,899 @@ void Controller::run()
     m_model->m_axis1Motor->setSpeed( m_model->m_config.readDouble( "Axis1SpeedPreset2", 40.0 ) );
     m_model->m_axis2Motor->setSpeed( m_model->m_config.readDouble( "Axis2SpeedPreset2", 20.0 ) );
 
+    // Anything the display should show straight away wakes us up
+    m_model->m_onChanged = [ this ](){ m_wakeup.notify(); };
+    // A key's time in the model stops when it starts waiting for a motor
+    m_model->m_onMotorWait = [ this ](){ m_latency->modelWaiting(); };
+
+    // The safety checks no longer wait for the display to be drawn
+    unsigned long rate =
+        std::max<unsigned long>( 1'000, m_model->m_config.readLong( "ControlLoopHz", 1'000 ) );
+    m_executor = std::make_unique<CommandExecutor>(
+        [ this ]( const Command& command )
+            {
+                // (waiting for the mutex counts from here)
+                auto dispatched = LatencyMonitor::Clock::now();
+                // Keys change the model, so mustn't overlap with its checks
+                {
+                    std::lock_guard<PriorityMutex> lock( m_model->m_mutex );
+                    handleKey( command, dispatched );
+                }
+                // So what it did is seen at once
+                m_wakeup.notify();
+            }
+        );
+    m_controlThread = std::make_unique<ControlThread>(
+        static_cast<uint32_t>( 1'000'000 / rate ),
+        [ this ]()
+            {
+                std::lock_guard<PriorityMutex> lock( m_model->m_mutex );
+                m_model->checkStatus();
+                // Motion may start again after an emergency stop once
+                // whatever key was under way when it came has finished
+                if( ! m_executor->isBusy() )
+                {
+                    m_model->emergencyStopHandled();
+                }
+                m_latency->tick();
+            }
+        );
+
+    // The display is drawn when something has changed, and otherwise
+    // this often, more often while anything is moving
+    auto refresh = []( unsigned long hz )
+        {
+            return std::chrono::microseconds( 1'000'000 / std::max<unsigned long>( 1, hz ) );
+        };
+    const auto movingRefresh = refresh( m_model->m_config.readLong( "DisplayRefreshHz", 20 ) );
+    const auto idleRefresh = refresh( m_model->m_config.readLong( "IdleDisplayRefreshHz", 2 ) );
+    // SFML has no way to wake us when a key is pressed, nor to wait for
+    // one with a time limit, so in between we look for one this often
+    const auto inputPoll = std::chrono::milliseconds(
+        std::max<unsigned long>( 1, m_model->m_config.readLong( "InputPollMilliseconds", 10 ) ) );
+
+    Wakeup::Clock::time_point lastDrawn;
+    bool redraw = true;
     while( ! m_model->m_quit )
     {
         processKeyPress();
 
-        m_model->checkStatus();
+        auto now = Wakeup::Clock::now();
+        auto period = m_model->m_moving ? movingRefresh : idleRefresh;
+        if( redraw || now >= lastDrawn + period )
+        {
+            // If the model was busy, we try again next time round
+            redraw = ! m_view->updateDisplay( *m_model );
+            if( ! redraw )
+            {
+                lastDrawn = now;
+            }
+        }
 
+        // Sleeps, rather than spinning, until there's something to do
+        if( m_wakeup.waitUntil( std::min( lastDrawn + period, now + inputPoll ) ) )
+        {
+            redraw = true;
+        }
+    }
+    // The key which asks for this is handled on the executor's thread,
+    // so we only find out once the loop has ended
+    if( m_model->m_shutdown )
+    {
         m_view->updateDisplay( *m_model );
+        // Stop the motor threads
+        m_controlThread.reset();
+        m_executor.reset();
+        m_model->m_axis2Motor.reset();
+        m_model->m_axis1Motor.reset();
+        // Note the command used for shutdown should be made passwordless
+        // in the /etc/sudoers files
+        system( "sudo shutdown -h now &" );
+    }
+    if( m_controlThread )
+    {
+        MGOLOG( "Control thread overran " << m_controlThread->getOverruns()
+            << " times, longest tick " << m_controlThread->getLongestTickMicroseconds() << " us" );
+        m_controlThread.reset();
+    }
+    {
+        // Logged here rather than as they fire, as that's on a realtime thread
+        DeadlineScheduler& scheduler = m_model->m_rotaryEncoder->getScheduler();
+        MGOLOG( "Spindle-timed actions: " << scheduler.getFired() << " fired, worst "
+            << scheduler.getWorstErrorMicroseconds() << " us from target, "
+            << scheduler.getTimedOut() << " given up" );
+    }
+    if( m_executor )
+    {
+        MGOLOG( "Longest a key waited to be handled " << m_executor->getLongestWaitMicroseconds()
+            << " us, " << m_executor->getDropped() << " dropped" );
+        m_executor.reset();
+        writeLatencyStats();
+    }
+    m_model->m_onChanged = nullptr;
+    m_model->m_onMotorWait = nullptr;
+}
 
-        if( m_model->m_shutdown )
+void Controller::processKeyPress()
+{
+    // Everything that's come in since last time
+    for(;;)
+    {
+        int t = m_view->getInput();
+        if( t == key::None ) return;
+        InputTimes times = m_view->getInputTimes();
+        if( isEmergencyStop( t ) )
         {
-            // Stop the motor threads
-            m_model->m_axis2Motor.reset();
-            m_model->m_axis1Motor.reset();
-            // Note the command used for shutdown should be made passwordless
-            // in the /etc/sudoers files
-            system( "sudo shutdown -h now &" );
+            // Now, rather than once the model has finished what it's
+            // doing, and anything typed before it is forgotten
+            m_executor->discardQueued();
+            m_model->emergencyStop();
+            continue;
         }
+        if( ! m_executor->post( { t, times.polled, times.converted, {} } ) )
+        {
+            MGOLOG( "Command queue full; key " << t << " dropped" );
+        }
+    }
+}
+
+bool Controller::isEmergencyStop( int key ) const
+{
+    if( key != key::SPACE ) return false;
+    // Not where it's typed in, or ignored; this is called without the
+    // model's mutex, but the display mode can be read without it
+    Mode mode = m_model->m_currentDisplayMode;
+    return mode == Mode::None || mode == Mode::Help || mode == Mode::Setup;
+}
 
-        // Small delay just to avoid the UI loop spinning
-        yieldSleep( std::chrono::microseconds( 50'000 ) );
+void Controller::handleKey( const Command& command, LatencyMonitor::Clock::time_point dispatched )
+{
+    int key = command.key;
+    // The mode means some keys are ignored, for instance in
+    // threading, you cannot change the speed of the z-axis as
+    // that would affect the thread pitch, and others are typed in
+    Action action = m_keys.modeAction(
+        m_model->m_currentDisplayMode, m_model->m_axis2Retracted, key );
+    if( action == Action::Pass )
+    {
+        // If a leader key came before this one, this is the second key
+        // of the chord, and after it we're back to normal
+        action = m_keys.keyModeAction( m_model->m_keyMode, key );
+        m_model->m_keyMode = KeyMode::None;
     }
+    m_latency->begin( action, command.polled, command.converted, dispatched,
+        m_model->axis1IsRunning() || m_model->axis2IsRunning() );
+    perform( action, key );
+    m_latency->modelCalled( m_model->axis1IsRunning() || m_model->axis2IsRunning() );
 }
 
-void Controller::processKeyPress()
+void Controller::perform( Action action, int key )
 {
-    int t = m_view->getInput();
-    t = checkKeyAllowedForMode( t );
-    t = processModeInputKeys( t );
-    if( t != key::None )
+    switch( action )
     {
-        if( m_model->m_keyMode != KeyMode::None )
+        case Action::Pass:
+        case Action::Ignore:
+        case Action::Count:
         {
-            // If we are in a "leader key mode" (i.e. the first "prefix" key has
-            // already been pressed) then we can modify t here. If the key
-            // combination is recognised, we get a "chord" keypress e.g. key::xz.
-            t = processLeaderKeyModeKeyPress( t );
-            m_model->m_keyMode = KeyMode::None;
+            break;
         }
-        m_model->m_keyPressed = t;
-        // Modify key press if it is a known axis leader key:
-        m_model->m_keyPressed = checkForAxisLeaderKeys( m_model->m_keyPressed );
-        switch( m_model->m_keyPressed )
+        case Action::Type:
         {
-            case key::None:
-            {
-                break;
-            }
-            case key::F2:
+            typeInput( key );
+            break;
+        }
+        case Action::Accept:
+        {
+            m_model->acceptInputValue();
+            break;
+        }
+        case Action::CancelThreading:
+        {
+            // Reset motor speed to something sane
+            m_model->m_axis1Motor->setSpeed(
+                m_model->m_config.readDouble( "Axis1SpeedPreset2", 40.0 ) );
+            [[fallthrough]];
+        }
+        case Action::Cancel: // return to normal mode
+        {
+            // Cancel any retract as well
+            m_model->m_axis2Retracted = false;
+            changeMode( action );
+            break;
+        }
+        case Action::ThreadPitchPrevious:
+        {
+            if( m_model->m_threadPitchIndex == 0 )
             {
-                m_model->m_keyMode = KeyMode::Function;
-                break;
+                m_model->m_threadPitchIndex = threadPitches.size() - 1;
             }
-            // End of "Leader" keys ==============
-            case key::CtrlQ:
+            else
             {
-                m_model->stopAllMotors();
-                m_model->m_quit = true;
-                break;
+                --m_model->m_threadPitchIndex;
             }
-            case key::l:
-            case key::L:
+            break;
+        }
+        case Action::ThreadPitchNext:
+        {
+            if( m_model->m_threadPitchIndex == threadPitches.size() - 1 )
             {
-                m_model->axis1GoToPreviousPosition();
-                break;
+                m_model->m_threadPitchIndex = 0;
             }
-            case key::FULLSTOP:
+            else
             {
-                m_model->repeatLastRelativeMove();
-                break;
+                ++m_model->m_threadPitchIndex;
             }
-            case key::a2_MINUS:
+            break;
+        }
+        case Action::RetractInwards:
+        {
+            m_model->m_xRetractionDirection = XRetractionDirection::Inwards;
+            break;
+        }
+        case Action::RetractOutwards:
+        {
+            m_model->m_xRetractionDirection = XRetractionDirection::Outwards;
+            break;
+        }
+        case Action::SetDiameter:
+        {
+            float xPos = 0;
+            try
             {
-                // X-axis speed decrease
-                if( m_model->m_axis2Motor->getSpeed() > 10.1 )
-                {
-                    m_model->m_axis2Motor->setSpeed( m_model->m_axis2Motor->getSpeed() - 10.0 );
-                }
-                else if( m_model->m_axis2Motor->getSpeed() > 2.1 )
-                {
-                    m_model->m_axis2Motor->setSpeed( m_model->m_axis2Motor->getSpeed() - 2.0 );
-                }
-                break;
+                xPos = - std::abs( std::stof( m_model->m_input ) );
             }
-            case key::a2_EQUALS:
+            catch( ... ) {}
+            m_model->m_axis2Motor->setPosition( xPos / 2 );
+            // This will invalidate any memorised X positions, so we clear them
+            for( auto& m : m_model->m_axis2Memory )
             {
-                // X-axis speed increase
-                if( m_model->m_axis2Motor->getSpeed() < 10.0 )
-                {
-                    m_model->m_axis2Motor->setSpeed( m_model->m_axis2Motor->getSpeed() + 2.0 );
-                }
-                else if( m_model->m_axis2Motor->getSpeed() <
-                    m_model->m_config.readDouble( "Axis2MaxMotorSpeed", 1'000.0 ) )
-                {
-                    m_model->m_axis2Motor->setSpeed( m_model->m_axis2Motor->getSpeed() + 10.0 );
-                }
-                break;
+                m = INF_OUT;
             }
-            // Nudge in X axis
-            case key::W:
-            case key::w:
+            // Only the dialog is closed; whatever was enabled stays so
+            m_model->m_currentDisplayMode = ACTIONS[ toIndex( action ) ].to;
+            m_model->m_xDiameterSet = true;
+            break;
+        }
+        case Action::StopAll: // e.g. space bar to stop all motors
+        {
+            m_model->stopAllMotors();
+            break;
+        }
+        case Action::Quit:
+        {
+            m_model->stopAllMotors();
+            m_model->m_quit = true;
+            break;
+        }
+        case Action::Shutdown:
+        {
+            #ifndef FAKE
+            m_model->stopAllMotors();
+            // Shutdown first, as the UI stops as soon as it sees quit
+            m_model->m_shutdown = true;
+            m_model->m_quit = true;
+            #endif
+            break;
+        }
+        case Action::LatencyStats:
+        {
+            writeLatencyStats();
+            break;
+        }
+        case Action::FunctionLeader:
+        {
+            m_model->m_keyMode = KeyMode::Function;
+            break;
+        }
+        case Action::Axis1Leader:
+        {
+            m_model->m_keyMode = KeyMode::Axis1;
+            break;
+        }
+        case Action::Axis2Leader:
+        {
+            m_model->m_keyMode = KeyMode::Axis2;
+            break;
+        }
+        case Action::Axis1PreviousPosition:
+        {
+            m_model->axis1GoToPreviousPosition();
+            break;
+        }
+        case Action::RepeatLastRelativeMove:
+        {
+            m_model->repeatLastRelativeMove();
+            break;
+        }
+        case Action::NextThreadStart:
+        {
+            // Move on to the next start of a multi-start thread
+            if( m_model->m_enabledFunction == Mode::Threading )
             {
-                if ( m_model->m_axis2Motor->isRunning() )
-                {
-                    m_model->axis2Stop();
-                }
-                double nudgeValue = 60.0;
-                if( m_model->m_keyPressed == key::W )
-                {
-                    // extra fine with shift
-                    nudgeValue = 6.0;
-                }
-                if( m_model->m_config.readBool( "Axis2MotorFlipDirection", false ) )
-                {
-                    nudgeValue = -nudgeValue;
-                }
-                m_model->m_axis2Motor->goToStep(
-                    m_model->m_axis2Motor->getCurrentStep() + nudgeValue );
-                break;
+                m_model->threadingNextStart();
             }
-            // Nudge out X axis
-            case key::S:
-            case key::s:
+            break;
+        }
+        case Action::ThreadingCycle:
+        {
+            // Run every pass of the thread, or pause / carry on
+            // if it's already running
+            if( m_model->m_enabledFunction != Mode::Threading ) break;
+            if( m_model->m_threadingStage == ThreadingCycleStage::Idle )
             {
-                if ( m_model->m_axis2Motor->isRunning() )
-                {
-                    m_model->axis2Stop();
-                }
-                double nudgeValue = 60.0;
-                if( m_model->m_keyPressed == key::S )
-                {
-                    // extra fine with shift
-                    nudgeValue = 6.0;
-                }
-                if( m_model->m_config.readBool( "Axis2MotorFlipDirection", false ) )
-                {
-                    nudgeValue = -nudgeValue;
-                }
-                m_model->m_axis2Motor->goToStep(
-                    m_model->m_axis2Motor->getCurrentStep() - nudgeValue );
-                break;
+                m_model->threadingCycleStart();
             }
-            case key::a1_EQUALS:
-            case key::EQUALS: // (i.e. plus)
+            else
             {
-                if( m_model->m_enabledFunction == Mode::Threading ) break;
-                if( m_model->m_axis1Motor->getRpm() < 20.0 )
-                {
-                    m_model->m_axis1Motor->setSpeed( m_model->m_axis1Motor->getRpm() + 1.0 );
-                }
-                else
-                {
-                    if( m_model->m_axis1Motor->getRpm() <=
-                        m_model->m_config.readDouble( "Axis1MaxMotorSpeed", 1'000.0 ) - 20 )
-                    {
-                        m_model->m_axis1Motor->setSpeed( m_model->m_axis1Motor->getRpm() + 20.0 );
-                    }
-                }
-                break;
+                m_model->threadingCyclePause();
             }
-            case key::a1_MINUS:
-            case key::MINUS:
+            break;
+        }
+        case Action::Axis2SpeedDown:
+        {
+            if( m_model->m_axis2Motor->getSpeed() > 10.1 )
             {
-                if( m_model->m_enabledFunction == Mode::Threading ) break;
-                if( m_model->m_axis1Motor->getRpm() > 20 )
-                {
-                    m_model->m_axis1Motor->setSpeed( m_model->m_axis1Motor->getRpm() - 20.0 );
-                }
-                else
-                {
-                    if ( m_model->m_axis1Motor->getRpm() > 1 )
-                    {
-                        m_model->m_axis1Motor->setSpeed( m_model->m_axis1Motor->getRpm() - 1.0 );
-                    }
-                }
-                break;
+                m_model->m_axis2Motor->setSpeed( m_model->m_axis2Motor->getSpeed() - 10.0 );
             }
-            case key::a1_m:
+            else if( m_model->m_axis2Motor->getSpeed() > 2.1 )
             {
-                m_model->m_axis1Memory.at( m_model->m_currentMemory ) =
-                    m_model->m_axis1Motor->getCurrentStep();
-                break;
+                m_model->m_axis2Motor->setSpeed( m_model->m_axis2Motor->getSpeed() - 2.0 );
             }
-            case key::a2_m:
+            break;
+        }
+        case Action::Axis2SpeedUp:
+        {
+            if( m_model->m_axis2Motor->getSpeed() < 10.0 )
             {
-                m_model->m_axis2Memory.at( m_model->m_currentMemory ) =
-                    m_model->m_axis2Motor->getCurrentStep();
-                break;
+                m_model->m_axis2Motor->setSpeed( m_model->m_axis2Motor->getSpeed() + 2.0 );
             }
-            case key::m:
-            case key::M:
+            else if( m_model->m_axis2Motor->getSpeed() <
+                m_model->m_config.readDouble( "Axis2MaxMotorSpeed", 1'000.0 ) )
             {
-                m_model->m_axis1Memory.at( m_model->m_currentMemory ) =
-                    m_model->m_axis1Motor->getCurrentStep();
-                m_model->m_axis2Memory.at( m_model->m_currentMemory ) =
-                    m_model->m_axis2Motor->getCurrentStep();
-                break;
+                m_model->m_axis2Motor->setSpeed( m_model->m_axis2Motor->getSpeed() + 10.0 );
             }
-            case key::a2_ENTER:
+            break;
+        }
+        case Action::Axis2NudgeIn:
+        case Action::Axis2NudgeInFine:
+        {
+            if ( m_model->m_axis2Motor->isRunning() )
             {
-                if( m_model->m_axis2Memory.at( m_model->m_currentMemory ) == INF_RIGHT ) break;
-                if( m_model->m_axis2Memory.at( m_model->m_currentMemory ) ==
-                    m_model->m_axis2Motor->getCurrentStep() ) break;
                 m_model->axis2Stop();
-                m_model->m_axis2Status = "returning";
-                m_model->m_axis2Motor->goToStep(
-                    m_model->m_axis2Memory.at( m_model->m_currentMemory ) );
-                break;
-            }
-            case key::ENTER:
-            case key::a1_ENTER:
-            {
-                m_model->axis1GoToCurrentMemory();
-                break;
-            }
-            case key::UP:
-            {
-                if( m_model->m_axis2Motor->isRunning() )
-                {
-                    m_model->axis2Stop();
-                }
-                else
-                {
-                    m_model->m_axis2Status = "moving in";
-                    if( m_model->m_config.readBool( "Axis2MotorFlipDirection", false ) )
-                    {
-                        m_model->m_axis2Motor->goToStep( INF_OUT );
-                    }
-                    else
-                    {
-                        m_model->m_axis2Motor->goToStep( INF_IN );
-                    }
-                }
-                break;
-            }
-            case key::DOWN:
-            {
-                if( m_model->m_axis2Motor->isRunning() )
-                {
-                    m_model->axis2Stop();
-                }
-                else
-                {
-                    m_model->m_axis2Status = "moving out";
-                    if( m_model->m_config.readBool( "Axis2MotorFlipDirection", false ) )
-                    {
-                        m_model->m_axis2Motor->goToStep( INF_IN );
-                    }
-                    else
-                    {
-                        m_model->m_axis2Motor->goToStep( INF_OUT );
-                    }
-                }
-                break;
-            }
-            case key::LEFT:
-            {
-                m_model->axis1MoveLeft();
-                break;
-            }
-            case key::RIGHT:
-            {
-                m_model->axis1MoveRight();
-                break;
-            }
-            case key::a:
-            case key::A:
-            {
-                long nudgeAmount = 25L;
-                if( m_model->m_keyPressed == key::A ) // extra fine with shift
-                {
-                    nudgeAmount = 2L;
-                }
-                m_model->axis1Nudge( nudgeAmount );
-                break;
             }
-            case key::d:
-            case key::D:
+            double nudgeValue = 60.0;
+            if( action == Action::Axis2NudgeInFine )
             {
-                long nudgeAmount = -25L;
-                if( m_model->m_keyPressed == key::D ) // extra fine with shift
-                {
-                    nudgeAmount = -2L;
-                }
-                m_model->axis1Nudge( nudgeAmount );
-                break;
+                nudgeValue = 6.0;
             }
-            case key::LBRACKET: // [
+            if( m_model->m_config.readBool( "Axis2MotorFlipDirection", false ) )
             {
-                if( m_model->m_currentMemory > 0 )
-                {
-                    --m_model->m_currentMemory;
-                }
-                break;
-            }
-            case key::RBRACKET: // ]
-            {
-                if( m_model->m_currentMemory < m_model->m_axis1Memory.size() - 1 )
-                {
-                    ++m_model->m_currentMemory;
-                }
-                break;
-            }
-
-            // Speed presets for Z with number keys 1-5
-            case key::ONE:
-            {
-                if( m_model->m_currentDisplayMode != Mode::Threading )
-                {
-                    m_model->m_axis1Motor->setSpeed(
-                        m_model->m_config.readDouble( "Axis1SpeedPreset1", 20.0 )
-                        );
-                }
-                break;
+                nudgeValue = -nudgeValue;
             }
-            case key::TWO:
+            m_model->axis2GoToStep(
+                m_model->m_axis2Motor->getCurrentStep() + nudgeValue );
+            break;
+        }
+        case Action::Axis2NudgeOut:
+        case Action::Axis2NudgeOutFine:
+        {
+            if ( m_model->m_axis2Motor->isRunning() )
             {
-                if( m_model->m_currentDisplayMode != Mode::Threading )
-                {
-                    m_model->m_axis1Motor->setSpeed(
-                        m_model->m_config.readDouble( "Axis1SpeedPreset2", 40.0 )
-                        );
-                }
-                break;
+                m_model->axis2Stop();
             }
-            case key::THREE:
+            double nudgeValue = 60.0;
+            if( action == Action::Axis2NudgeOutFine )
             {
-                if( m_model->m_currentDisplayMode != Mode::Threading )
-                {
-                    m_model->m_axis1Motor->setSpeed(
-                        m_model->m_config.readDouble( "Axis1SpeedPreset3", 100.0 )
-                        );
-                }
-                break;
+                nudgeValue = 6.0;
             }
-            case key::FOUR:
+            if( m_model->m_config.readBool( "Axis2MotorFlipDirection", false ) )
             {
-                if( m_model->m_currentDisplayMode != Mode::Threading )
-                {
-                    m_model->m_axis1Motor->setSpeed(
-                        m_model->m_config.readDouble( "Axis1SpeedPreset4", 250.0 )
-                        );
-                }
-                break;
+                nudgeValue = -nudgeValue;
             }
-            case key::FIVE:
+            m_model->axis2GoToStep(
+                m_model->m_axis2Motor->getCurrentStep() - nudgeValue );
+            break;
+        }
+        case Action::Axis1SpeedUp:
+        {
+            if( m_model->m_enabledFunction == Mode::Threading ) break;
+            if( m_model->m_axis1Motor->getRpm() < 20.0 )
             {
-                if( m_model->m_currentDisplayMode != Mode::Threading )
-                {
-                    m_model->m_axis1Motor->setSpeed(
-                        m_model->m_config.readDouble( "Axis1SpeedPreset5",
-                            m_model->m_config.readDouble( "Axis1MaxMotorSpeed", 1'000.0 )
-                            )
-                        );
-                }
-                break;
+                m_model->m_axis1Motor->setSpeed( m_model->m_axis1Motor->getRpm() + 1.0 );
             }
-            // Speed presets for X with number keys 6-0 or X leader + 1-5
-            case key::a2_1:
-            case key::SIX:
+            else
             {
-                if( m_model->m_currentDisplayMode != Mode::Threading )
+                if( m_model->m_axis1Motor->getRpm() <=
+                    m_model->m_config.readDouble( "Axis1MaxMotorSpeed", 1'000.0 ) - 20 )
                 {
-                    m_model->m_axis2Motor->setSpeed(
-                        m_model->m_config.readDouble( "Axis2SpeedPreset1", 5.0 )
-                        );
+                    m_model->m_axis1Motor->setSpeed( m_model->m_axis1Motor->getRpm() + 20.0 );
                 }
-                break;
             }
-            case key::a2_2:
-            case key::SEVEN:
+            break;
+        }
+        case Action::Axis1SpeedDown:
+        {
+            if( m_model->m_enabledFunction == Mode::Threading ) break;
+            if( m_model->m_axis1Motor->getRpm() > 20 )
             {
-                if( m_model->m_currentDisplayMode != Mode::Threading )
-                {
-                    m_model->m_axis2Motor->setSpeed(
-                        m_model->m_config.readDouble( "Axis2SpeedPreset2", 20.0 )
-                        );
-                }
-                break;
+                m_model->m_axis1Motor->setSpeed( m_model->m_axis1Motor->getRpm() - 20.0 );
             }
-            case key::a2_3:
-            case key::EIGHT:
+            else
             {
-                if( m_model->m_currentDisplayMode != Mode::Threading )
+                if ( m_model->m_axis1Motor->getRpm() > 1 )
                 {
-                    m_model->m_axis2Motor->setSpeed(
-                        m_model->m_config.readDouble( "Axis2SpeedPreset3", 40.0 )
-                        );
+                    m_model->m_axis1Motor->setSpeed( m_model->m_axis1Motor->getRpm() - 1.0 );
                 }
-                break;
             }
-            case key::a2_4:
-            case key::NINE:
+            break;
+        }
+        case Action::Axis1Memorise:
+        {
+            m_model->m_axis1Memory.at( m_model->m_currentMemory ) =
+                m_model->m_axis1Motor->getCurrentStep();
+            break;
+        }
+        case Action::Axis2Memorise:
+        {
+            m_model->m_axis2Memory.at( m_model->m_currentMemory ) =
+                m_model->m_axis2Motor->getCurrentStep();
+            break;
+        }
+        case Action::Memorise:
+        {
+            m_model->m_axis1Memory.at( m_model->m_currentMemory ) =
+                m_model->m_axis1Motor->getCurrentStep();
+            m_model->m_axis2Memory.at( m_model->m_currentMemory ) =
+                m_model->m_axis2Motor->getCurrentStep();
+            break;
+        }
+        case Action::Axis2ReturnToMemory:
+        {
+            if( m_model->m_axis2Memory.at( m_model->m_currentMemory ) == INF_RIGHT ) break;
+            if( m_model->m_axis2Memory.at( m_model->m_currentMemory ) ==
+                m_model->m_axis2Motor->getCurrentStep() ) break;
+            m_model->axis2Stop();
+            m_model->m_axis2Status = "returning";
+            m_model->axis2GoToStep(
+                m_model->m_axis2Memory.at( m_model->m_currentMemory ) );
+            break;
+        }
+        case Action::Axis1ReturnToMemory:
+        {
+            m_model->axis1GoToCurrentMemory();
+            break;
+        }
+        case Action::Axis2MoveIn:
+        {
+            if( m_model->m_axis2Motor->isRunning() )
             {
-                if( m_model->m_currentDisplayMode != Mode::Threading )
-                {
-                    m_model->m_axis2Motor->setSpeed(
-                        m_model->m_config.readDouble( "Axis2SpeedPreset4", 80.0 )
-                        );
-                }
-                break;
+                m_model->axis2Stop();
             }
-            case key::a2_5:
-            case key::ZERO:
+            else
             {
-                if( m_model->m_currentDisplayMode != Mode::Threading )
+                m_model->m_axis2Status = "moving in";
+                if( m_model->m_config.readBool( "Axis2MotorFlipDirection", false ) )
                 {
-                    m_model->m_axis2Motor->setSpeed(
-                        m_model->m_config.readDouble( "Axis2SpeedPreset5",
-                            m_model->m_config.readDouble( "Axis2MaxMotorSpeed", 1'000.0 ) )
-                        );
-                }
-                break;
-            }
-            case key::f:
-            case key::F:
-            case key::a1_f:
-            {
-                // Fast return to point
-                if( m_model->m_axis1Memory.at( m_model->m_currentMemory ) == INF_RIGHT ) break;
-                if( m_model->m_axis1FastReturning ) break;
-                m_model->m_previousZSpeed = m_model->m_axis1Motor->getSpeed();
-                m_model->m_axis1FastReturning = true;
-                m_model->axis1Stop();
-                if( m_model->m_enabledFunction == Mode::Taper )
-                {
-                    // If we are tapering, we need to set a speed the x-axis motor can keep up with
-                    m_model->m_axis1Motor->setSpeed( 100.0 );
-                    ZDirection direction = ZDirection::Left;
-                    if( m_model->m_axis1Memory.at( m_model->m_currentMemory ) <
-                        m_model->m_axis1Motor->getCurrentStep() )
-                    {
-                        direction = ZDirection::Right;
-                    }
-                    m_model->takeUpZBacklash( direction );
-                    m_model->startSynchronisedXMotorForTaper( direction );
+                    m_model->axis2GoToStep( INF_OUT );
                 }
                 else
                 {
-                    m_model->m_axis1Motor->setSpeed( m_model->m_axis1Motor->getMaxRpm() );
+                    m_model->axis2GoToStep( INF_IN );
                 }
-                m_model->m_axis1Status = "fast returning";
-                m_model->axis1GoToStep(
-                    m_model->m_axis1Memory.at( m_model->m_currentMemory ) );
-                break;
             }
-            case key::a2_f:
+            break;
+        }
+        case Action::Axis2MoveOut:
+        {
+            if( m_model->m_axis2Motor->isRunning() )
             {
-                // Fast return to point
-                if( m_model->m_axis2Memory.at( m_model->m_currentMemory ) == INF_RIGHT ) break;
-                if( m_model->m_axis2FastReturning ) break;
-                m_model->m_previousZSpeed = m_model->m_axis2Motor->getSpeed();
-                m_model->m_axis2FastReturning = true;
                 m_model->axis2Stop();
-                m_model->m_axis2Motor->setSpeed( m_model->m_axis2Motor->getMaxRpm() );
-                m_model->m_axis2Status = "fast returning";
-                m_model->m_axis2Motor->goToStep(
-                    m_model->m_axis2Memory.at( m_model->m_currentMemory ) );
-                break;
             }
-            case key::r:
-            case key::R:
+            else
             {
-                // X retraction
-                if( m_model->m_config.readBool( "DisableAxis2", false ) ) break;
-                if( m_model->m_axis2Motor->isRunning() ) break;
-                if( m_model->m_enabledFunction == Mode::Taper ) break;
-                if( m_model->m_axis2Retracted )
+                m_model->m_axis2Status = "moving out";
+                if( m_model->m_config.readBool( "Axis2MotorFlipDirection", false ) )
                 {
-                    // Return
-                    m_model->m_axis2Motor->setSpeed( 100.0 );
-                    m_model->m_axis2Motor->goToStep( m_model->m_xOldPosition );
-                    m_model->m_axis2Status = "Unretracting";
-                    m_model->m_fastRetracting = true;
+                    m_model->axis2GoToStep( INF_IN );
                 }
                 else
                 {
-                    m_model->m_xOldPosition = m_model->m_axis2Motor->getCurrentStep();
-                    m_model->m_previousXSpeed = m_model->m_axis2Motor->getSpeed();
-                    m_model->m_axis2Motor->setSpeed( 100.0 );
-                    int direction = -1;
-                    if( m_model->m_xRetractionDirection == XRetractionDirection::Inwards )
-                    {
-                        direction = 1;
-                    }
-                    long stepsForRetraction =
-                        2.0 / std::abs( m_model->m_axis2Motor->getConversionFactor() );
-                    m_model->m_axis2Motor->goToStep(
-                        m_model->m_axis2Motor->getCurrentStep() + stepsForRetraction * direction );
-                    m_model->m_axis2Retracted = true;
-                    m_model->m_axis2Status = "Retracting";
-                }
-                break;
-            }
-            case key::a1_z:
-            {
-                if( m_model->m_enabledFunction == Mode::Taper )
-                {
-                    m_model->changeMode( Mode::None );
+                    m_model->axis2GoToStep( INF_OUT );
                 }
-                m_model->m_axis1Motor->zeroPosition();
-                // Zeroing will invalidate any memorised Z positions, so we clear them
-                for( auto& m : m_model->m_axis1Memory )
-                {
-                    m = INF_RIGHT;
-                }
-                break;
             }
-            case key::a2_z:
-            {
-                if( m_model->m_enabledFunction == Mode::Taper )
-                {
-                    m_model->changeMode( Mode::None );
-                }
-                m_model->m_axis2Motor->zeroPosition();
-                // Zeroing will invalidate any memorised X positions, so we clear them
-                for( auto& m : m_model->m_axis2Memory )
-                {
-                    m = INF_OUT;
-                }
-                break;
-            }
-            case key::a1_g:
-            {
-                m_model->changeMode( Mode::Axis1GoTo );
-                break;
-            }
-            case key::a2_g:
+            break;
+        }
+        case Action::Axis1MoveLeft:
+        {
+            m_model->axis1MoveLeft();
+            break;
+        }
+        case Action::Axis1MoveRight:
+        {
+            m_model->axis1MoveRight();
+            break;
+        }
+        case Action::Axis1NudgeLeft:
+        case Action::Axis1NudgeLeftFine:
+        {
+            m_model->axis1Nudge( action == Action::Axis1NudgeLeftFine ? 2L : 25L );
+            break;
+        }
+        case Action::Axis1NudgeRight:
+        case Action::Axis1NudgeRightFine:
+        {
+            m_model->axis1Nudge( action == Action::Axis1NudgeRightFine ? -2L : -25L );
+            break;
+        }
+        case Action::PreviousMemory:
+        {
+            if( m_model->m_currentMemory > 0 )
             {
-                m_model->changeMode( Mode::Axis2GoTo );
-                break;
+                --m_model->m_currentMemory;
             }
-            case key::a1_r:
+            break;
+        }
+        case Action::NextMemory:
+        {
+            if( m_model->m_currentMemory < m_model->m_axis1Memory.size() - 1 )
             {
-                m_model->changeMode( Mode::Axis1GoToOffset );
-                break;
+                ++m_model->m_currentMemory;
             }
-            case key::a2_r:
+            break;
+        }
+        case Action::Axis1SpeedPreset1:
+        {
+            if( m_model->m_currentDisplayMode != Mode::Threading )
             {
-                m_model->changeMode( Mode::Axis2GoToOffset );
-                break;
+                m_model->m_axis1Motor->setSpeed(
+                    m_model->m_config.readDouble( "Axis1SpeedPreset1", 20.0 )
+                    );
             }
-            case key::ASTERISK: // shutdown
+            break;
+        }
+        case Action::Axis1SpeedPreset2:
+        {
+            if( m_model->m_currentDisplayMode != Mode::Threading )
             {
-                #ifndef FAKE
-                m_model->stopAllMotors();
-                m_model->m_quit = true;
-                m_model->m_shutdown = true;
-                #endif
-                break;
+                m_model->m_axis1Motor->setSpeed(
+                    m_model->m_config.readDouble( "Axis1SpeedPreset2", 40.0 )
+                    );
             }
-            case key::F1: // help mode
-            case key::f2h:
+            break;
+        }
+        case Action::Axis1SpeedPreset3:
+        {
+            if( m_model->m_currentDisplayMode != Mode::Threading )
             {
-                m_model->changeMode( Mode::Help );
-                break;
+                m_model->m_axis1Motor->setSpeed(
+                    m_model->m_config.readDouble( "Axis1SpeedPreset3", 100.0 )
+                    );
             }
-            case key::f2s: // setup mode
+            break;
+        }
+        case Action::Axis1SpeedPreset4:
+        {
+            if( m_model->m_currentDisplayMode != Mode::Threading )
             {
-                m_model->m_enabledFunction = Mode::None;
-                m_model->m_axis1Motor->setSpeed( 0.8f );
-                m_model->m_axis2Motor->setSpeed( 1.f );
-                m_model->changeMode( Mode::Setup );
-                break;
+                m_model->m_axis1Motor->setSpeed(
+                    m_model->m_config.readDouble( "Axis1SpeedPreset4", 250.0 )
+                    );
             }
-            case key::f2t: // threading mode
+            break;
+        }
+        case Action::Axis1SpeedPreset5:
+        {
+            if( m_model->m_currentDisplayMode != Mode::Threading )
             {
-                if( m_model->m_config.readBool( "DisableAxis2", false ) ) break;
-                m_model->changeMode( Mode::Threading );
-                break;
+                m_model->m_axis1Motor->setSpeed(
+                    m_model->m_config.readDouble( "Axis1SpeedPreset5",
+                        m_model->m_config.readDouble( "Axis1MaxMotorSpeed", 1'000.0 )
+                        )
+                    );
             }
-            case key::f2p: // taper mode
+            break;
+        }
+        case Action::Axis2SpeedPreset1:
+        {
+            if( m_model->m_currentDisplayMode != Mode::Threading )
             {
-                if( m_model->m_config.readBool( "DisableAxis2", false ) ) break;
-                m_model->changeMode( Mode::Taper );
-                break;
+                m_model->m_axis2Motor->setSpeed(
+                    m_model->m_config.readDouble( "Axis2SpeedPreset1", 5.0 )
+                    );
             }
-            case key::f2r: // X retraction setup
+            break;
+        }
+        case Action::Axis2SpeedPreset2:
+        {
+            if( m_model->m_currentDisplayMode != Mode::Threading )
             {
-                if( m_model->m_config.readBool( "DisableAxis2", false ) ) break;
-                m_model->changeMode( Mode::Axis2RetractSetup );
-                break;
+                m_model->m_axis2Motor->setSpeed(
+                    m_model->m_config.readDouble( "Axis2SpeedPreset2", 20.0 )
+                    );
             }
-            case key::f2o: // Radius mode
+            break;
+        }
+        case Action::Axis2SpeedPreset3:
+        {
+            if( m_model->m_currentDisplayMode != Mode::Threading )
             {
-                if( m_model->m_config.readBool( "DisableAxis2", false ) ) break;
-                m_model->changeMode( Mode::Radius );
-                break;
+                m_model->m_axis2Motor->setSpeed(
+                    m_model->m_config.readDouble( "Axis2SpeedPreset3", 40.0 )
+                    );
             }
-            case key::a2_s: // X position set
+            break;
+        }
+        case Action::Axis2SpeedPreset4:
+        {
+            if( m_model->m_currentDisplayMode != Mode::Threading )
             {
-                m_model->changeMode( Mode::Axis2PositionSetup );
-                break;
+                m_model->m_axis2Motor->setSpeed(
+                    m_model->m_config.readDouble( "Axis2SpeedPreset4", 80.0 )
+                    );
             }
-            case key::a1_s: // Z position set
+            break;
+        }
+        case Action::Axis2SpeedPreset5:
+        {
+            if( m_model->m_currentDisplayMode != Mode::Threading )
             {
-                m_model->changeMode( Mode::Axis1PositionSetup );
-                break;
+                m_model->m_axis2Motor->setSpeed(
+                    m_model->m_config.readDouble( "Axis2SpeedPreset5",
+                        m_model->m_config.readDouble( "Axis2MaxMotorSpeed", 1'000.0 ) )
+                    );
             }
-            case key::ESC: // return to normal mode
-            {
-                // Cancel any retract as well
-                m_model->m_axis2Retracted = false;
-                m_model->changeMode( Mode::None );
+            break;
+        }
+        case Action::Axis1FastReturn:
+        {
+            // Fast return to point
+            if( m_model->m_axis1Memory.at( m_model->m_currentMemory ) == INF_RIGHT ) break;
+            if( m_model->m_axis1FastReturning ) break;
+            m_model->axis1Stop();
+            m_model->m_axis1FastReturning = true;
+            // Once there, or stopped on the way, back to the speed we were at
+            Model::StoppedFunction restoreSpeed =
+                [ model = m_model, speed = m_model->m_axis1Motor->getSpeed() ]( bool )
+                {
+                    model->m_axis1Motor->setSpeed( speed );
+                    model->m_axis1FastReturning = false;
+                };
+            if( m_model->m_enabledFunction == Mode::Taper )
+            {
+                // If we are tapering, we need to set a speed the x-axis motor can keep up with
+                m_model->m_axis1Motor->setSpeed( 100.0 );
+                ZDirection direction = ZDirection::Left;
+                if( m_model->m_axis1Memory.at( m_model->m_currentMemory ) <
+                    m_model->m_axis1Motor->getCurrentStep() )
+                {
+                    direction = ZDirection::Right;
+                }
+                m_model->takeUpZBacklash( direction );
+                m_model->startSynchronisedXMotorForTaper( direction );
+            }
+            else if( m_model->axis1RapidToStep(
+                m_model->m_axis1Memory.at( m_model->m_currentMemory ) ) )
+            {
+                // Planned to accelerate smoothly, so it's already on its way
+                m_model->m_axis1Status = "fast returning";
+                m_model->axis1WhenStopped( std::move( restoreSpeed ) );
                 break;
             }
-            default: // e.g. space bar to stop all motors
+            else
             {
-                m_model->stopAllMotors();
-                break;
+                m_model->m_axis1Motor->setSpeed( m_model->m_axis1Motor->getMaxRpm() );
             }
+            m_model->m_axis1Status = "fast returning";
+            m_model->axis1GoToStep(
+                m_model->m_axis1Memory.at( m_model->m_currentMemory ),
+                std::move( restoreSpeed ) );
+            break;
         }
-    }
-}
-
-int Controller::checkKeyAllowedForMode( int key )
-{
-    // The mode means some keys are ignored, for instance in
-    // threading, you cannot change the speed of the z-axis as
-    // that would affect the thread pitch
-    // Always allow certain keys:
-    if( key == key::CtrlQ  ||
-        key == key::ESC    ||
-        key == key::ENTER
-        )
-    {
-        return key;
-    }
-    // Don't allow any x movement when retracted
-    if( m_model->m_axis2Retracted && ( key == key::UP || key == key::DOWN || key == key::W
-        || key == key::w || key == key::s || key == key::S ) )
-    {
-        return -1;
-    }
-    switch( m_model->m_currentDisplayMode )
-    {
-        case Mode::None:
-            return key;
-        case Mode::Help:
-            return key;
-        case Mode::Setup:
-            if( key == key::LEFT || key == key::RIGHT || key == key::UP || key == key::DOWN )
-            {
-                return key;
-            }
-            if( key == key::SPACE ) return key;
-            return -1;
-        case Mode::Threading:
-            if( key == key::UP || key == key::DOWN ) return key;
-            return -1;
-        case Mode::Axis2RetractSetup:
-            if( key == key::UP || key == key::DOWN ) return key;
-            return -1;
-        // Any modes that have numerical input:
-        case Mode::Axis2PositionSetup:
-            if( key >= key::ZERO && key <= key::NINE ) return key;
-            if( key == key::FULLSTOP || key == key::BACKSPACE || key == key::DELETE ) return key;
-            if( key == key::MINUS ) return key;
-            if( key == key::d || key == key::D ) return key;
-            return -1;
-        case Mode::Axis1PositionSetup:
-        case Mode::Taper:
-        case Mode::Axis1GoTo:
-        case Mode::Axis2GoTo:
-        case Mode::Axis1GoToOffset:
-        case Mode::Axis2GoToOffset:
-        case Mode::Radius:
-            if( key >= key::ZERO && key <= key::NINE ) return key;
-            if( key == key::FULLSTOP || key == key::BACKSPACE || key == key::DELETE ) return key;
-            if( key == key::MINUS ) return key;
-            return -1;
-        default:
-            // unhandled mode
-            assert( false );
-    }
-}
-
-int Controller::processModeInputKeys( int key )
-{
-    // If we are in a "mode" then certain keys (e.g. the number keys) are used for input
-    // so are processed here before allowing them to fall through to the main key processing
-    if( m_model->m_currentDisplayMode == Mode::Taper ||
-        m_model->m_currentDisplayMode == Mode::Axis2PositionSetup ||
-        m_model->m_currentDisplayMode == Mode::Axis1PositionSetup ||
-        m_model->m_currentDisplayMode == Mode::Axis1GoTo ||
-        m_model->m_currentDisplayMode == Mode::Axis2GoTo ||
-        m_model->m_currentDisplayMode == Mode::Axis1GoToOffset ||
-        m_model->m_currentDisplayMode == Mode::Axis2GoToOffset ||
-        m_model->m_currentDisplayMode == Mode::Radius
-        )
-    {
-        if( key >= key::ZERO && key <= key::NINE )
+        case Action::Axis2FastReturn:
         {
-            m_model->m_input += static_cast<char>( key );
-            return -1;
+            // Fast return to point
+            if( m_model->m_axis2Memory.at( m_model->m_currentMemory ) == INF_RIGHT ) break;
+            if( m_model->m_axis2FastReturning ) break;
+            m_model->axis2Stop();
+            m_model->m_axis2FastReturning = true;
+            double speed = m_model->m_axis2Motor->getSpeed();
+            m_model->m_axis2Motor->setSpeed( m_model->m_axis2Motor->getMaxRpm() );
+            m_model->m_axis2Status = "fast returning";
+            m_model->axis2GoToStep(
+                m_model->m_axis2Memory.at( m_model->m_currentMemory ),
+                [ model = m_model, speed ]( bool )
+                {
+                    model->m_axis2Motor->setSpeed( speed );
+                    model->m_axis2FastReturning = false;
+                }
+                );
+            break;
         }
-        if( key == key::FULLSTOP )
+        case Action::Retract:
         {
-            if( m_model->m_input.find( "." ) == std::string::npos )
-            {
-                m_model->m_input += static_cast<char>( key );
+            // X retraction
+            if( m_model->m_config.readBool( "DisableAxis2", false ) ) break;
+            if( m_model->m_axis2Motor->isRunning() ) break;
+            if( m_model->m_enabledFunction == Mode::Taper ) break;
+            if( m_model->m_axis2Retracted )
+            {
+                // Return
+                m_model->m_axis2Motor->setSpeed( 100.0 );
+                m_model->axis2GoToStep( m_model->m_xOldPosition,
+                    [ model = m_model ]( bool )
+                    {
+                        model->m_axis2Motor->setSpeed( model->m_previousXSpeed );
+                        model->m_axis2Retracted = false;
+                    }
+                    );
+                m_model->m_axis2Status = "Unretracting";
             }
-            return -1;
-        }
-        if( key == key::DELETE )
-        {
-            m_model->m_input = "";
-        }
-        if( key == key::BACKSPACE )
-        {
-            if( ! m_model->m_input.empty() )
+            else
             {
-                m_model->m_input.pop_back();
+                m_model->axis2Retract();
+                m_model->m_axis2Status = "Retracting";
             }
-            return -1;
+            break;
         }
-        if( key == key::MINUS && m_model->m_input.empty() )
-        {
-            m_model->m_input = "-";
-            return -1;
-        }
-    }
-    if(  m_model->m_currentDisplayMode == Mode::Threading )
-    {
-        if( key == key::UP )
+        case Action::Axis1Zero:
         {
-            if( m_model->m_threadPitchIndex == 0 )
+            if( m_model->m_enabledFunction == Mode::Taper )
             {
-                m_model->m_threadPitchIndex = threadPitches.size() - 1;
+                changeMode( action );
             }
-            else
+            m_model->m_axis1Motor->zeroPosition();
+            // Zeroing will invalidate any memorised Z positions, so we clear them
+            for( auto& m : m_model->m_axis1Memory )
             {
-                --m_model->m_threadPitchIndex;
+                m = INF_RIGHT;
             }
-            return -1;
+            break;
         }
-        if( key == key::DOWN )
+        case Action::Axis2Zero:
         {
-            if( m_model->m_threadPitchIndex == threadPitches.size() - 1 )
+            if( m_model->m_enabledFunction == Mode::Taper )
             {
-                m_model->m_threadPitchIndex = 0;
+                changeMode( action );
             }
-            else
+            m_model->m_axis2Motor->zeroPosition();
+            // Zeroing will invalidate any memorised X positions, so we clear them
+            for( auto& m : m_model->m_axis2Memory )
             {
-                ++m_model->m_threadPitchIndex;
+                m = INF_OUT;
             }
-            return -1;
+            break;
         }
-        if( key == key::ESC )
+        case Action::OpenSetup:
         {
-            // Reset motor speed to something sane
-            m_model->m_axis1Motor->setSpeed(
-                m_model->m_config.readDouble( "Axis1SpeedPreset2", 40.0 ) );
-            // fall through...
+            m_model->m_enabledFunction = Mode::None;
+            m_model->m_axis1Motor->setSpeed( 0.8f );
+            m_model->m_axis2Motor->setSpeed( 1.f );
+            changeMode( action );
+            break;
         }
-    }
-    if(  m_model->m_currentDisplayMode == Mode::Axis2RetractSetup )
-    {
-        if( key == key::UP )
+        case Action::OpenThreading:
+        case Action::OpenTaper:
+        case Action::OpenRetractSetup:
+        case Action::OpenRadius:
+        case Action::OpenProfile:
+        case Action::OpenMisalignment:
         {
-            m_model->m_xRetractionDirection = XRetractionDirection::Inwards;
-            return -1;
+            // These all need the X axis
+            if( m_model->m_config.readBool( "DisableAxis2", false ) ) break;
+            changeMode( action );
+            break;
         }
-        if( key == key::DOWN )
+        case Action::OpenHelp:
+        case Action::OpenAxis1GoTo:
+        case Action::OpenAxis2GoTo:
+        case Action::OpenAxis1GoToOffset:
+        case Action::OpenAxis2GoToOffset:
+        case Action::OpenAxis1PositionSetup:
+        case Action::OpenAxis2PositionSetup:
         {
-            m_model->m_xRetractionDirection = XRetractionDirection::Outwards;
-            return -1;
+            changeMode( action );
+            break;
         }
     }
-
-    // Diameter set
-    if( m_model->m_currentDisplayMode == Mode::Axis2PositionSetup &&
-        ( key == key::d || key == key::D ) )
-    {
-        float xPos = 0;
-        try
-        {
-            xPos = - std::abs( std::stof( m_model->m_input ) );
-        }
-        catch( ... ) {}
-        m_model->m_axis2Motor->setPosition( xPos / 2 );
-        // This will invalidate any memorised X positions, so we clear them
-        for( auto& m : m_model->m_axis2Memory )
-        {
-            m = INF_OUT;
-        }
-        m_model->m_currentDisplayMode = Mode::None;
-        m_model->m_xDiameterSet = true;
-        return -1;
-    }
-
-    if( m_model->m_currentDisplayMode != Mode::None && key == key::ENTER )
-    {
-        m_model->acceptInputValue();
-        return -1;
-    }
-    return key;
 }
 
-int Controller::processLeaderKeyModeKeyPress( int keyPress )
+void Controller::changeMode( Action action )
 {
-    if( m_model->m_keyMode == KeyMode::Axis1 ||
-        m_model->m_keyMode == KeyMode::Axis2 )
-    {
-        int bitFlip = 4096; // bit 12
-        if( m_model->m_keyMode == KeyMode::Axis2 )
-        {
-            bitFlip = 8192; // bit 13
-        }
-        return keyPress + bitFlip;
-    }
+    // Where each action goes is in ACTIONS, which the tests check
+    // against TRANSITIONS, so that check covers what we really do
+    const ActionInfo& info = ACTIONS[ toIndex( action ) ];
+    assert( info.changesMode );
+    m_model->changeMode( info.to );
+}
 
-    if( m_model->m_keyMode == KeyMode::Function )
+void Controller::writeLatencyStats()
+{
+    std::ostringstream oss;
+    m_latency->write( oss );
+    MGOLOG( oss.str() );
+    std::string filename = m_model->m_config.read( "LatencyStatsFile", "" );
+    if( ! filename.empty() )
     {
-        switch( keyPress )
+        std::ofstream file( filename );
+        file << oss.str();
+        if( ! file )
         {
-            case key::h:
-            case key::H:
-                keyPress = key::f2h;
-                break;
-            case key::s:
-            case key::S:
-                keyPress = key::f2s;
-                break;
-            case key::t:
-            case key::T:
-                keyPress = key::f2t;
-                break;
-            case key::p:
-            case key::P:
-            case key::FULLSTOP:  // > - looks like a taper
-            case key::COMMA:     // < - looks like a taper
-                keyPress = key::f2p;
-                break;
-            case key::r:
-            case key::R:
-                keyPress = key::f2r;
-                break;
-            case key::o:
-            case key::O:
-                keyPress = key::f2o;
-                break;
-            default:
-                keyPress = key::None;
+            MGOLOG( "Couldn't write latency stats to " << filename );
         }
     }
-    m_model->m_keyMode = KeyMode::None;
-    return keyPress;
 }
 
-int Controller::checkForAxisLeaderKeys( int key )
+void Controller::typeInput( int key )
 {
-    // We determine whether the key pressed is a leader key for
-    // an axis (note the key can be remapped in config) and sets
-    // the model's m_keyMode variable if so. Returns true if one
-    // was pressed, false if not.
-    if( key == static_cast<int>( m_model->m_config.readLong( "Axis1Leader", 122L ) ) )
+    // Only the keys the mode has said can be typed get here
+    std::string& input = m_model->m_input;
+    if( key >= key::ZERO && key <= key::NINE )
     {
-        m_model->m_keyMode = KeyMode::Axis1;
-        return key::None;
+        input += static_cast<char>( key );
+        return;
     }
-    if( key == static_cast<int>( m_model->m_config.readLong( "Axis2Leader", 120L ) ) )
+    // Where the Z,X point being typed starts
+    std::size_t space = input.rfind( ' ' );
+    std::size_t pointStart = space == std::string::npos ? 0 : space + 1;
+    switch( key )
     {
-        m_model->m_keyMode = KeyMode::Axis2;
-        return key::None;
+        case key::FULLSTOP:
+        {
+            // (each number of a Z,X point can have its own)
+            std::size_t separator = input.find_last_of( ", " );
+            std::size_t start = separator == std::string::npos ? 0 : separator + 1;
+            if( input.find( ".", start ) == std::string::npos )
+            {
+                input += '.';
+            }
+            break;
+        }
+        case key::COMMA:
+        {
+            // A point has one, the misalignment measurements two
+            long allowed = m_model->m_currentDisplayMode == Mode::MisalignmentSetup ? 2 : 1;
+            if( std::count( input.begin() + pointStart, input.end(), ',' ) < allowed &&
+                ! input.empty() && input.back() != ',' )
+            {
+                input += ',';
+            }
+            break;
+        }
+        case key::SPACE:
+        {
+            // Only once this point has both numbers
+            std::size_t comma = input.find( ',', pointStart );
+            if( comma != std::string::npos && comma + 1 < input.size() )
+            {
+                input += ' ';
+            }
+            break;
+        }
+        case key::DELETE:
+        {
+            input = "";
+            break;
+        }
+        case key::BACKSPACE:
+        {
+            if( ! input.empty() )
+            {
+                input.pop_back();
+            }
+            break;
+        }
+        case key::MINUS:
+        {
+            // Only at the start of a number
+            if( input.empty() || input.back() == ',' || input.back() == ' ' )
+            {
+                input += '-';
+            }
+            break;
+        }
+        default:
+            break;
     }
-    return key;
 }
 
 } // end namespace
@@ -1,7 +1,12 @@
 #pragma once
 
+#include "commandexecutor.h"
+#include "controlthread.h"
 #include "iview.h"
+#include "keybindings.h"
+#include "latency.h"
 #include "model.h"
+#include "wakeup.h"
 
 #include <memory>
 
@@ -13,18 +18,38 @@ class IView;
 class Controller
 {
 public:
-    explicit Controller( Model* model );
+    Controller( Model* model, LatencyMonitor* latency );
     // run() is the main loop. When this returns,
     // the application can quit.
     void run();
+    // Passes on any keys pressed to be carried out (see handleKey()),
+    // apart from the stop key, which is dealt with straight away
     void processKeyPress();
 private:
     Model* m_model; // non-owning
+    LatencyMonitor* m_latency; // non-owning
+    // What each key does; the axis leaders can be changed in the config
+    KeyBindings m_keys;
     std::unique_ptr<IView> m_view;
-    int checkKeyAllowedForMode( int key );
-    int processModeInputKeys( int key );
-    int processLeaderKeyModeKeyPress( int key );
-    int checkForAxisLeaderKeys( int key );
+    // What the main loop sleeps on between drawing the display. Before
+    // the threads which wake it, so it outlasts them.
+    Wakeup m_wakeup;
+    // Carries out the keys, so the UI doesn't wait for the motors.
+    // Before the control thread, which asks whether it's busy.
+    std::unique_ptr<CommandExecutor> m_executor;
+    // Runs the model's checkStatus(), away from the display
+    std::unique_ptr<ControlThread> m_controlThread;
+    // On the executor's thread, with the model's mutex held
+    void handleKey( const Command& command, LatencyMonitor::Clock::time_point dispatched );
+    // Whether the key stops everything, jumping the queue
+    bool isEmergencyStop( int key ) const;
+    void perform( Action action, int key );
+    // To the mode the action goes to in ACTIONS
+    void changeMode( Action action );
+    // To the log, and the file in the config if there is one
+    void writeLatencyStats();
+    // Edits the value being typed into the current dialog
+    void typeInput( int key );
 };
 
 } // end namespace
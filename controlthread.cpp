@@ -0,0 +1,83 @@
+#include "controlthread.h"
+
+#include "log.h"
+
+#include <cerrno>
+#include <pthread.h>
+#include <time.h>
+
+namespace mgo
+{
+
+namespace
+{
+
+int64_t toMicroseconds( const timespec& ts )
+{
+    return static_cast<int64_t>( ts.tv_sec ) * 1'000'000 + ts.tv_nsec / 1'000;
+}
+
+timespec fromMicroseconds( int64_t microseconds )
+{
+    timespec ts;
+    ts.tv_sec = microseconds / 1'000'000;
+    ts.tv_nsec = ( microseconds % 1'000'000 ) * 1'000;
+    return ts;
+}
+
+int64_t nowMicroseconds()
+{
+    timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return toMicroseconds( ts );
+}
+
+} // end anonymous namespace
+
+ControlThread::ControlThread( uint32_t periodMicroseconds, std::function<void()> tick )
+    : m_periodMicroseconds( periodMicroseconds ),
+      m_tick( std::move( tick ) )
+{
+    m_thread = std::thread( &ControlThread::threadFunction, this );
+    // Below the threads which make steps, which must never wait for us
+    sched_param param;
+    param.sched_priority = sched_get_priority_max( SCHED_FIFO ) - 10;
+    if( pthread_setschedparam( m_thread.native_handle(), SCHED_FIFO, &param ) != 0 )
+    {
+        MGOLOG( "Could not set realtime priority for control thread" );
+    }
+}
+
+ControlThread::~ControlThread()
+{
+    m_quit = true;
+    m_thread.join();
+}
+
+void ControlThread::threadFunction()
+{
+    int64_t due = nowMicroseconds();
+    while( ! m_quit )
+    {
+        int64_t start = nowMicroseconds();
+        m_tick();
+        int64_t end = nowMicroseconds();
+        if( end - start > m_longestTick )
+        {
+            m_longestTick = static_cast<uint32_t>( end - start );
+        }
+        due += m_periodMicroseconds;
+        if( end >= due )
+        {
+            // Overran; carry on from now rather than trying to catch up
+            int64_t missed = ( end - due ) / m_periodMicroseconds + 1;
+            m_overruns += missed;
+            due += missed * m_periodMicroseconds;
+        }
+        timespec ts = fromMicroseconds( due );
+        // Absolute time, so being interrupted doesn't extend the sleep
+        while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr ) == EINTR );
+    }
+}
+
+} // end namespace
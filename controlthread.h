@@ -0,0 +1,51 @@
+#pragma once
+// Runs a function at a fixed rate on a thread of its own (realtime, if
+// we have the privileges), so that the model's safety checks - spindle
+// stopped, RPM too high for threading and so on - happen every
+// millisecond or so whatever the display is doing, rather than once
+// per frame.
+//
+// Ticks are due at fixed times from the start, so a slow one doesn't
+// push the rest back. If one takes longer than the period, the ones it
+// overran are skipped (and counted) rather than run back to back.
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace mgo
+{
+
+class ControlThread
+{
+public:
+    ControlThread( uint32_t periodMicroseconds, std::function<void()> tick );
+    ~ControlThread();
+
+    ControlThread( const ControlThread& ) = delete;
+    ControlThread& operator=( const ControlThread& ) = delete;
+
+    // Ticks skipped because an earlier one was still running
+    uint64_t getOverruns() const
+    {
+        return m_overruns;
+    }
+    // Longest a tick has taken, microseconds
+    uint32_t getLongestTickMicroseconds() const
+    {
+        return m_longestTick;
+    }
+
+private:
+    void threadFunction();
+
+    uint32_t              m_periodMicroseconds;
+    std::function<void()> m_tick;
+    std::atomic<bool>     m_quit{ false };
+    std::atomic<uint64_t> m_overruns{ 0 };
+    std::atomic<uint32_t> m_longestTick{ 0 };
+    std::thread           m_thread;
+};
+
+} // end namespace
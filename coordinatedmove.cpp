@@ -0,0 +1,180 @@
+#include "coordinatedmove.h"
+
+#include "log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <pthread.h>
+
+namespace mgo
+{
+
+namespace
+{
+
+// Longest we wait in one go, so stopping is noticed
+constexpr int32_t MAX_WAIT_MICROSECONDS = 1'000;
+
+// Width of the step pulse
+constexpr long STEP_PULSE_MICROSECONDS = 5;
+
+} // end anonymous namespace
+
+CoordinatedMove::CoordinatedMove( IGpio& gpio, int axis1StepPin, int axis2StepPin )
+    : m_gpio( gpio ),
+      m_axis1StepPin( axis1StepPin ),
+      m_axis2StepPin( axis2StepPin )
+{
+    m_thread = std::thread( &CoordinatedMove::threadFunction, this );
+    sched_param param;
+    param.sched_priority = sched_get_priority_max( SCHED_FIFO );
+    if( pthread_setschedparam( m_thread.native_handle(), SCHED_FIFO, &param ) != 0 )
+    {
+        MGOLOG( "Could not set realtime priority for coordinated moves" );
+    }
+}
+
+CoordinatedMove::~CoordinatedMove()
+{
+    stop();
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_quit = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+void CoordinatedMove::start(
+    long   axis1Steps,
+    long   axis2Steps,
+    double seconds
+    )
+{
+    start(
+        axis1Steps,
+        axis2Steps,
+        steadyTickTimes( std::max( axis1Steps, axis2Steps ), seconds )
+        );
+}
+
+void CoordinatedMove::start(
+    long                  axis1Steps,
+    long                  axis2Steps,
+    std::vector<uint32_t> tickTimes
+    )
+{
+    std::vector<Segment> segments;
+    segments.push_back( { axis1Steps, axis2Steps, std::move( tickTimes ) } );
+    start( std::move( segments ) );
+}
+
+void CoordinatedMove::start( std::vector<Segment> segments )
+{
+    stop();
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_job = std::move( segments );
+        m_axis1Made = 0;
+        m_axis2Made = 0;
+        m_completed = false;
+        m_haveJob = true;
+        m_running = true;
+    }
+    m_cv.notify_all();
+}
+
+std::vector<uint32_t> CoordinatedMove::steadyTickTimes( long ticks, double seconds )
+{
+    // Each tick is due at a fixed time from the start, so waking late
+    // for one doesn't push the rest back
+    std::vector<uint32_t> tickTimes;
+    tickTimes.reserve( ticks );
+    for( long tick = 1; tick <= ticks; ++tick )
+    {
+        tickTimes.push_back(
+            static_cast<uint32_t>( std::llround( tick * seconds * 1'000'000.0 / ticks ) ) );
+    }
+    return tickTimes;
+}
+
+void CoordinatedMove::stop()
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_cancel = true;
+    m_cv.wait( lock, [&](){ return ! m_running; } );
+    m_cancel = false;
+}
+
+CoordinatedMove::Progress CoordinatedMove::getProgress() const
+{
+    // Running first: if it has finished, everything else is final
+    bool running = m_running;
+    return { m_axis1Made, m_axis2Made, m_completed, running };
+}
+
+void CoordinatedMove::threadFunction()
+{
+    for(;;)
+    {
+        std::vector<Segment> segments;
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_cv.wait( lock, [&](){ return m_quit || m_haveJob; } );
+            if( m_quit ) return;
+            segments = std::move( m_job );
+            m_haveJob = false;
+        }
+        m_completed = run( segments );
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_running = false;
+        }
+        m_cv.notify_all();
+    }
+}
+
+bool CoordinatedMove::run( const std::vector<Segment>& segments )
+{
+    uint32_t startTick = m_gpio.getTick();
+    long axis1Made = 0;
+    long axis2Made = 0;
+    for( const auto& segment : segments )
+    {
+        LinearDda dda( segment.axis1Steps, segment.axis2Steps );
+        long ticks = std::min( dda.getTicks(), static_cast<long>( segment.tickTimes.size() ) );
+        for( long tick = 0; tick < ticks; ++tick )
+        {
+            uint32_t due = startTick + segment.tickTimes[ tick ];
+            for(;;)
+            {
+                if( m_cancel ) return false;
+                int32_t remaining = static_cast<int32_t>( due - m_gpio.getTick() );
+                if( remaining <= 0 ) break;
+                m_gpio.delayMicroSeconds( std::min( remaining, MAX_WAIT_MICROSECONDS ) );
+            }
+            bool axis1;
+            bool axis2;
+            dda.tick( axis1, axis2 );
+            if( axis1 ) m_gpio.setStepPin( m_axis1StepPin, PinState::high );
+            if( axis2 ) m_gpio.setStepPin( m_axis2StepPin, PinState::high );
+            m_gpio.delayMicroSeconds( STEP_PULSE_MICROSECONDS );
+            if( axis1 ) m_gpio.setStepPin( m_axis1StepPin, PinState::low );
+            if( axis2 ) m_gpio.setStepPin( m_axis2StepPin, PinState::low );
+            axis1Made += axis1;
+            axis2Made += axis2;
+            m_axis1Made = axis1Made;
+            m_axis2Made = axis2Made;
+        }
+    }
+    long axis1Steps = 0;
+    long axis2Steps = 0;
+    for( const auto& segment : segments )
+    {
+        axis1Steps += segment.axis1Steps;
+        axis2Steps += segment.axis2Steps;
+    }
+    return axis1Made == axis1Steps && axis2Made == axis2Steps;
+}
+
+} // end namespace
@@ -0,0 +1,155 @@
+#pragma once
+// Moves both axes to a point in a straight line. The motors' own threads
+// would each run at their own speed, so a diagonal move would finish one
+// axis before the other and the tool would take a dog-leg. Here one
+// thread steps both from the same timeline: the axis with further to go
+// steps at a steady rate, and a Bresenham accumulator decides which of
+// those ticks the other one steps on, so they finish together.
+//
+// The timeline is either a steady rate, or worked out beforehand (e.g. by
+// the S-curve planner) as the time each tick is due. Several lines can be
+// run back to back as one job, so the tool doesn't stop at the corners.
+//
+// As with the electronic gearbox, direction pins are left alone, so each
+// motor must already have made (at least) one step in the direction it
+// is to go. The motors don't see these steps either, so the move
+// publishes how many it has made as it goes (see getProgress()), for
+// whoever owns the motors to keep their positions up to date.
+
+#include "stepperControl/igpio.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mgo
+{
+
+// The stepping pattern on its own. Each tick, the axis with more steps
+// steps, and the other one steps when its share has built up to a whole
+// step, the last one landing on the final tick.
+class LinearDda
+{
+public:
+    LinearDda( long axis1Steps, long axis2Steps )
+        : m_axis1Steps( axis1Steps ),
+          m_axis2Steps( axis2Steps ),
+          m_ticks( std::max( axis1Steps, axis2Steps ) ),
+          m_minor( std::min( axis1Steps, axis2Steps ) )
+    {}
+
+    long getTicks() const
+    {
+        return m_ticks;
+    }
+
+    // Which axes step on the next tick
+    void tick( bool& axis1, bool& axis2 )
+    {
+        m_accumulator += m_minor;
+        bool minor = m_accumulator >= m_ticks;
+        if( minor )
+        {
+            m_accumulator -= m_ticks;
+        }
+        axis1 = m_axis1Steps >= m_axis2Steps || minor;
+        axis2 = m_axis2Steps > m_axis1Steps || minor;
+    }
+
+private:
+    long m_axis1Steps;
+    long m_axis2Steps;
+    long m_ticks;
+    long m_minor;
+    long m_accumulator{ 0 };
+};
+
+class CoordinatedMove
+{
+public:
+    struct Progress
+    {
+        long axis1Made;
+        long axis2Made;
+        // Only meaningful once it's no longer running: whether all the
+        // steps were made (not if it was stopped)
+        bool completed;
+        bool running;
+    };
+
+    // One line of a job, with the time each of its ticks is due, in
+    // microseconds from the start of the job
+    struct Segment
+    {
+        long                  axis1Steps;
+        long                  axis2Steps;
+        std::vector<uint32_t> tickTimes;
+    };
+
+    CoordinatedMove( IGpio& gpio, int axis1StepPin, int axis2StepPin );
+    ~CoordinatedMove();
+
+    CoordinatedMove( const CoordinatedMove& ) = delete;
+    CoordinatedMove& operator=( const CoordinatedMove& ) = delete;
+
+    // Makes the given number of steps on each axis over the given time.
+    // Returns straight away.
+    void start(
+        long   axis1Steps,
+        long   axis2Steps,
+        double seconds
+        );
+    // As above, with the time each tick is due, in microseconds from the
+    // start. There must be a tick time for each step of the axis with
+    // more steps.
+    void start(
+        long                  axis1Steps,
+        long                  axis2Steps,
+        std::vector<uint32_t> tickTimes
+        );
+    // Makes each line in turn, without stopping in between. Steps made
+    // are totals over all of them.
+    void start( std::vector<Segment> segments );
+
+    // Tick times, from the start, for the given number of ticks spread
+    // evenly over the given time
+    static std::vector<uint32_t> steadyTickTimes( long ticks, double seconds );
+
+    // Stops stepping and waits until it has
+    void stop();
+
+    bool isRunning() const
+    {
+        return m_running;
+    }
+
+    // Any thread, at any time, without waiting for the move's thread
+    Progress getProgress() const;
+
+private:
+    void threadFunction();
+    // Returns whether all the steps were made
+    bool run( const std::vector<Segment>& segments );
+
+    IGpio& m_gpio;
+    int    m_axis1StepPin;
+    int    m_axis2StepPin;
+    std::atomic<bool> m_running{ false };
+    // Progress of the current (or last) move. Completed is stored
+    // before m_running is cleared.
+    std::atomic<long> m_axis1Made{ 0 };
+    std::atomic<long> m_axis2Made{ 0 };
+    std::atomic<bool> m_completed{ false };
+    std::atomic<bool> m_cancel{ false };
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_haveJob{ false };
+    std::vector<Segment> m_job;
+    bool m_quit{ false };
+    std::thread m_thread;
+};
+
+} // end namespace
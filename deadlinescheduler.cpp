@@ -0,0 +1,170 @@
+#include "deadlinescheduler.h"
+
+#include "log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <pthread.h>
+#include <time.h>
+
+namespace mgo
+{
+
+namespace
+{
+
+// Longest we sleep in one go, so cancellation is noticed and the
+// deadline can be refined as new data comes in
+constexpr int32_t MAX_SLEEP_MICROSECONDS = 10'000;
+
+// How often we re-ask for a deadline when none is available yet
+constexpr int32_t RETRY_MICROSECONDS = 1'000;
+
+void sleepMicroseconds( int32_t microseconds )
+{
+    timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    ts.tv_nsec += static_cast<long>( microseconds ) * 1'000;
+    ts.tv_sec  += ts.tv_nsec / 1'000'000'000;
+    ts.tv_nsec %= 1'000'000'000;
+    // Absolute time, so being interrupted doesn't extend the sleep
+    while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr ) == EINTR );
+}
+
+} // end anonymous namespace
+
+DeadlineScheduler::DeadlineScheduler(
+    IGpio&   gpio,
+    uint32_t spinWindowMicroseconds
+    )
+    : m_gpio( gpio ),
+      m_spinWindowMicroseconds( spinWindowMicroseconds )
+{
+    m_thread = std::thread( &DeadlineScheduler::threadFunction, this );
+    // As with the motor threads, we want to run with realtime priority.
+    // This will fail if we're not root (e.g. in a FAKE build), in which
+    // case we just carry on with normal scheduling.
+    sched_param param;
+    param.sched_priority = sched_get_priority_max( SCHED_FIFO );
+    if( pthread_setschedparam( m_thread.native_handle(), SCHED_FIFO, &param ) != 0 )
+    {
+        MGOLOG( "Could not set realtime priority for deadline scheduler" );
+    }
+}
+
+DeadlineScheduler::~DeadlineScheduler()
+{
+    cancelAll();
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_quit = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+}
+
+std::future<bool> DeadlineScheduler::schedule(
+    DeadlineFunction      deadline,
+    std::function<void()> action
+    )
+{
+    std::future<bool> future;
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_requests.push_back(
+            { std::move( deadline ), std::move( action ), {}, m_generation } );
+        future = m_requests.back().promise.get_future();
+    }
+    m_cv.notify_one();
+    return future;
+}
+
+void DeadlineScheduler::cancelAll()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    ++m_generation;
+    for( auto& request : m_requests )
+    {
+        request.promise.set_value( false );
+    }
+    m_requests.clear();
+}
+
+void DeadlineScheduler::threadFunction()
+{
+    for(;;)
+    {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_cv.wait( lock, [&](){ return m_quit || ! m_requests.empty(); } );
+            if( m_quit ) return;
+            request = std::move( m_requests.front() );
+            m_requests.pop_front();
+        }
+        run( request );
+    }
+}
+
+void DeadlineScheduler::run( Request& request )
+{
+    uint32_t targetTick = 0;
+    uint32_t giveUpTick = m_gpio.getTick() + m_giveUpMicroseconds;
+    while( ! request.deadline( targetTick ) )
+    {
+        if( cancelled( request ) )
+        {
+            request.promise.set_value( false );
+            return;
+        }
+        // e.g. the spindle stopped before we had a time to aim for
+        if( static_cast<int32_t>( m_gpio.getTick() - giveUpTick ) >= 0 )
+        {
+            ++m_timedOut;
+            request.promise.set_value( false );
+            return;
+        }
+        sleepMicroseconds( RETRY_MICROSECONDS );
+    }
+
+    // Sleep until we're within the spin window of the deadline
+    for(;;)
+    {
+        int32_t remaining = static_cast<int32_t>( targetTick - m_gpio.getTick() );
+        int32_t sleepFor = remaining - static_cast<int32_t>( m_spinWindowMicroseconds );
+        if( sleepFor <= 0 ) break;
+        sleepMicroseconds( std::min( sleepFor, MAX_SLEEP_MICROSECONDS ) );
+        if( cancelled( request ) )
+        {
+            request.promise.set_value( false );
+            return;
+        }
+        // Keep the old deadline if a new one isn't available
+        uint32_t refinedTick = targetTick;
+        if( request.deadline( refinedTick ) )
+        {
+            targetTick = refinedTick;
+        }
+    }
+
+    // ...and spin for the last few microseconds
+    uint32_t now = m_gpio.getTick();
+    while( static_cast<int32_t>( now - targetTick ) < 0 )
+    {
+        now = m_gpio.getTick();
+    }
+    request.action();
+
+    int32_t error = static_cast<int32_t>( now - targetTick );
+    m_lastError = error;
+    // Compare and store in one go, so a reader never sees the worst
+    // error get better
+    int32_t worst = m_worstError.load();
+    while( std::abs( error ) > std::abs( worst )
+        && ! m_worstError.compare_exchange_weak( worst, error ) );
+    ++m_fired;
+    request.promise.set_value( true );
+}
+
+} // end namespace
@@ -0,0 +1,114 @@
+#pragma once
+// Runs actions at a precise gpio tick on a dedicated (realtime, if we have
+// the privileges) thread, so that callers don't have to sit in a busy loop
+// waiting for the moment to arrive. The thread sleeps until shortly before
+// the deadline and only busy-waits for the last few tens of microseconds.
+
+#include "stepperControl/igpio.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace mgo
+{
+
+class DeadlineScheduler
+{
+public:
+    // Works out the gpio tick at which the action should run. It is called
+    // on the scheduler thread when the request is picked up, and again each
+    // time the thread wakes up before the deadline, so it can refine its
+    // answer with fresher data. Return false if no deadline can be given
+    // yet, and it will be asked again shortly.
+    using DeadlineFunction = std::function<bool( uint32_t& tick )>;
+
+    explicit DeadlineScheduler(
+        IGpio&   gpio,
+        uint32_t spinWindowMicroseconds = 50
+        );
+    ~DeadlineScheduler();
+
+    DeadlineScheduler( const DeadlineScheduler& ) = delete;
+    DeadlineScheduler& operator=( const DeadlineScheduler& ) = delete;
+
+    // Requests are dealt with one at a time, in the order they were
+    // scheduled. The future becomes true once the action has run, or
+    // false if the request was cancelled, or its deadline function gave
+    // no deadline for the give-up time (so it can't hold up the rest).
+    std::future<bool> schedule(
+        DeadlineFunction      deadline,
+        std::function<void()> action
+        );
+
+    // Abandons any queued or in-progress requests that haven't fired yet
+    void cancelAll();
+
+    void setSpinWindowMicroseconds( uint32_t value )
+    {
+        m_spinWindowMicroseconds = value;
+    }
+    void setGiveUpMicroseconds( uint32_t value )
+    {
+        m_giveUpMicroseconds = value;
+    }
+
+    // How late (positive) or early (negative) the last action fired,
+    // and the worst seen so far, in microseconds
+    int32_t getLastErrorMicroseconds() const
+    {
+        return m_lastError;
+    }
+    int32_t getWorstErrorMicroseconds() const
+    {
+        return m_worstError;
+    }
+    // Nothing is logged from the scheduler's thread, as it's realtime
+    // and has the next request to get on with; these are for a summary
+    uint64_t getFired() const
+    {
+        return m_fired;
+    }
+    uint64_t getTimedOut() const
+    {
+        return m_timedOut;
+    }
+
+private:
+    struct Request
+    {
+        DeadlineFunction      deadline;
+        std::function<void()> action;
+        std::promise<bool>    promise;
+        uint64_t              generation;
+    };
+
+    void threadFunction();
+    void run( Request& request );
+    bool cancelled( const Request& request ) const
+    {
+        return request.generation != m_generation;
+    }
+
+    IGpio& m_gpio;
+    std::atomic<uint32_t> m_spinWindowMicroseconds;
+    std::atomic<uint32_t> m_giveUpMicroseconds{ 1'000'000 };
+    std::atomic<int32_t>  m_lastError{ 0 };
+    std::atomic<int32_t>  m_worstError{ 0 };
+    std::atomic<uint64_t> m_fired{ 0 };
+    std::atomic<uint64_t> m_timedOut{ 0 };
+    // Bumped by cancelAll(); requests from an older generation are dropped
+    std::atomic<uint64_t> m_generation{ 0 };
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Request> m_requests;
+    bool m_quit{ false };
+    std::thread m_thread;
+};
+
+} // end namespace
@@ -0,0 +1,256 @@
+#include "electronicgearbox.h"
+
+#include "log.h"
+
+#include <algorithm>
+#include <pthread.h>
+
+namespace mgo
+{
+
+namespace
+{
+
+// If we're this many steps behind where the spindle says we should be,
+// the thread is spoilt anyway, so we stop
+constexpr long MAX_LAG_STEPS = 50;
+
+// Longest we wait in one go, so disengaging is noticed
+constexpr int32_t MAX_WAIT_MICROSECONDS = 1'000;
+
+// ...and the shortest, while a count is due but hasn't reached us
+constexpr int32_t POLL_MICROSECONDS = 20;
+
+// Width of the step pulse
+constexpr long STEP_PULSE_MICROSECONDS = 5;
+
+} // end anonymous namespace
+
+ElectronicGearbox::ElectronicGearbox(
+    IGpio&         gpio,
+    RotaryEncoder& encoder,
+    int            stepPin
+    )
+    : m_gpio( gpio ),
+      m_encoder( encoder ),
+      m_stepPin( stepPin )
+{
+    m_thread = std::thread( &ElectronicGearbox::threadFunction, this );
+    sched_param param;
+    param.sched_priority = sched_get_priority_max( SCHED_FIFO );
+    if( pthread_setschedparam( m_thread.native_handle(), SCHED_FIFO, &param ) != 0 )
+    {
+        MGOLOG( "Could not set realtime priority for electronic gearbox" );
+    }
+}
+
+ElectronicGearbox::~ElectronicGearbox()
+{
+    disengage();
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_quit = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+void ElectronicGearbox::setRatio( int64_t numerator, int64_t divisor )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_numerator = numerator;
+    m_divisor = divisor;
+}
+
+void ElectronicGearbox::setMaxStepsPerSecond( double value )
+{
+    m_minStepInterval = value > 0.0 ? static_cast<uint32_t>( 1'000'000.0 / value ) : 0;
+}
+
+void ElectronicGearbox::setPitchCompensation( PitchCompensation table, double mmPerStep )
+{
+    // Only read by the gearbox thread while engaged
+    disengage();
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_pitchCompensation = std::move( table );
+    m_mmPerStep = mmPerStep;
+}
+
+void ElectronicGearbox::engage(
+    int64_t startCount,
+    long    steps,
+    long    fromStep,
+    int     direction,
+    long    correction
+    )
+{
+    disengage();
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_job = {
+            startCount,
+            steps,
+            m_numerator,
+            m_divisor,
+            fromStep,
+            direction,
+            correction
+            };
+        m_stepsMade = 0;
+        m_correction = correction;
+        m_completed = false;
+        m_haveJob = true;
+        m_engaged = true;
+    }
+    m_cv.notify_all();
+}
+
+void ElectronicGearbox::disengage()
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_cancel = true;
+    m_cv.wait( lock, [&](){ return ! m_engaged; } );
+    m_cancel = false;
+}
+
+ElectronicGearbox::Progress ElectronicGearbox::getProgress() const
+{
+    // Engaged first: if it has finished, everything else is final
+    bool engaged = m_engaged;
+    return { m_stepsMade, m_correction, m_completed, engaged };
+}
+
+void ElectronicGearbox::threadFunction()
+{
+    for(;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_cv.wait( lock, [&](){ return m_quit || m_haveJob; } );
+            if( m_quit ) return;
+            job = std::move( m_job );
+            m_haveJob = false;
+        }
+        bool completed = false;
+        long correction = job.correction;
+        long made = run( job, completed, correction );
+        if( ! completed )
+        {
+            MGOLOG( "Electronic gearbox stopped after " << made << " of "
+                << job.steps << " steps" );
+        }
+        m_correction = correction;
+        m_completed = completed;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_engaged = false;
+        }
+        m_cv.notify_all();
+    }
+}
+
+long ElectronicGearbox::run( const Job& job, bool& completed, long& correction )
+{
+    PitchCompensation::Cursor compensation( m_pitchCompensation, m_mmPerStep, job.fromStep );
+    // As in the encoder, we accumulate the numerator for each count and
+    // carry a step each time we pass the divisor. Step n therefore comes
+    // at exactly startCount + ceil( n * divisor / numerator ).
+    int64_t lastCount = job.startCount;
+    int64_t phase = 0;
+    long owed = 0;
+    long made = 0;
+    uint32_t lastStepTick = m_gpio.getTick() - m_minStepInterval;
+    while( ! m_cancel )
+    {
+        if( made >= job.steps )
+        {
+            completed = true;
+            break;
+        }
+        uint32_t now = m_gpio.getTick();
+        // Steps are only owed for counts the encoder has actually seen.
+        // A step can't be taken back, so we don't make any for where the
+        // tracker thinks the spindle has got to: if it has stopped, so
+        // do we. Only forwards. If the spindle goes back, we wait for it
+        // to come round again to where we were.
+        int64_t count = m_encoder.getPositionCount();
+        while( lastCount < count && owed - made <= MAX_LAG_STEPS )
+        {
+            ++lastCount;
+            phase += job.numerator;
+            while( phase >= job.divisor )
+            {
+                phase -= job.divisor;
+                ++owed;
+            }
+        }
+        if( owed - made > MAX_LAG_STEPS )
+        {
+            MGOLOG( "Electronic gearbox fell behind the spindle after "
+                << made << " steps" );
+            break;
+        }
+        if( owed > made )
+        {
+            int32_t sinceLastStep = static_cast<int32_t>( now - lastStepTick );
+            if( sinceLastStep < static_cast<int32_t>( m_minStepInterval ) )
+            {
+                m_gpio.delayMicroSeconds( m_minStepInterval - sinceLastStep );
+            }
+            lastStepTick = m_gpio.getTick();
+            // Normally one pulse, but two or none where the pitch
+            // correction changes. At most one either way each step, so
+            // any big difference is made up gradually.
+            long wanted = compensation.stepsAt( job.fromStep + ( made + 1 ) * job.direction );
+            long pulses = std::clamp( 1 + ( wanted - correction ) * job.direction, 0L, 2L );
+            correction += ( pulses - 1 ) * job.direction;
+            for( long pulse = 0; pulse < pulses; ++pulse )
+            {
+                if( pulse > 0 )
+                {
+                    m_gpio.delayMicroSeconds(
+                        std::max<long>( m_minStepInterval, STEP_PULSE_MICROSECONDS ) );
+                }
+                step();
+            }
+            if( made == 0 )
+            {
+                double actual;
+                if( m_encoder.getEstimatedCount( lastStepTick, actual ) )
+                {
+                    int64_t ideal = job.startCount +
+                        ( job.divisor + job.numerator - 1 ) / job.numerator;
+                    m_lastStartError = actual - ideal;
+                }
+            }
+            ++made;
+            m_stepsMade = made;
+            continue;
+        }
+        // Wait for the count which gives us the next step. The tracker
+        // only says how long that's likely to be: if it's due, we look
+        // again shortly, and if it can't say (the spindle has stopped),
+        // in a while.
+        int64_t countsToNextStep =
+            ( job.divisor - phase + job.numerator - 1 ) / job.numerator;
+        uint32_t nextTick;
+        int32_t wait = MAX_WAIT_MICROSECONDS;
+        if( m_encoder.tickAtPosition( lastCount + countsToNextStep, nextTick ) )
+        {
+            wait = std::clamp( static_cast<int32_t>( nextTick - now ),
+                POLL_MICROSECONDS, MAX_WAIT_MICROSECONDS );
+        }
+        m_gpio.delayMicroSeconds( wait );
+    }
+    return made;
+}
+
+void ElectronicGearbox::step()
+{
+    m_gpio.setStepPin( m_stepPin, PinState::high );
+    m_gpio.delayMicroSeconds( STEP_PULSE_MICROSECONDS );
+    m_gpio.setStepPin( m_stepPin, PinState::low );
+}
+
+} // end namespace
@@ -0,0 +1,144 @@
+#pragma once
+// Drives the leadscrew straight from the spindle encoder, like the change
+// gears on a manual lathe, rather than by setting the motor to a speed
+// worked out from the rpm. Leadscrew steps per encoder count is an exact
+// integer ratio, so the pitch is exact however much the spindle speed
+// wanders. Steps are made on a thread of its own, for each count the
+// encoder has decoded, never ahead of it, so the carriage stops when the
+// spindle does. The encoder's tracker only tells us how long to sleep
+// before the count giving the next step is likely to come round.
+//
+// While engaged, the gearbox pulses the motor's step pin itself. The
+// direction pin is left as it is, so the motor should already have moved
+// (at least one step) in the required direction, which also takes up
+// any backlash. The motor doesn't see these steps, so the gearbox
+// publishes how many it has made as it goes (see getProgress()), for
+// whoever owns the motor to keep its position up to date.
+//
+// With a pitch compensation table, an extra step is slipped in (or one
+// left out) wherever the correction changes along the way, so a long
+// thread keeps its pitch where the leadscrew doesn't.
+
+#include "pitchcompensation.h"
+#include "rotaryencoder.h"
+#include "stepperControl/igpio.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace mgo
+{
+
+class ElectronicGearbox
+{
+public:
+    struct Progress
+    {
+        // As the motor counts them, without any for pitch compensation
+        long stepsMade;
+        // The rest are only meaningful once it's no longer engaged:
+        // the pitch correction made by the end (see engage()), and
+        // whether all the steps were made (not if it was disengaged or
+        // fell behind the spindle)
+        long correction;
+        bool completed;
+        bool engaged;
+    };
+
+    ElectronicGearbox(
+        IGpio&         gpio,
+        RotaryEncoder& encoder,
+        int            stepPin
+        );
+    ~ElectronicGearbox();
+
+    ElectronicGearbox( const ElectronicGearbox& ) = delete;
+    ElectronicGearbox& operator=( const ElectronicGearbox& ) = delete;
+
+    // Leadscrew steps per encoder count is exactly numerator / divisor.
+    // Takes effect from the next engage().
+    void setRatio( int64_t numerator, int64_t divisor );
+    // The fastest the motor can be stepped. If the spindle asks for more
+    // than this, we fall behind, and give up if it gets too far.
+    void setMaxStepsPerSecond( double value );
+
+    // The table, and the motor's conversion factor to go with it. Takes
+    // effect from the next engage().
+    void setPitchCompensation( PitchCompensation table, double mmPerStep );
+
+    // Starts stepping as the encoder count passes startCount, and stops
+    // once "steps" steps have been made. Returns straight away. For pitch
+    // compensation, we need to know the motor's step and direction, and
+    // the correction (in steps) it has already had there.
+    void engage(
+        int64_t startCount,
+        long    steps,
+        long    fromStep,
+        int     direction,
+        long    correction
+        );
+
+    // Stops stepping and waits until it has
+    void disengage();
+
+    bool isEngaged() const
+    {
+        return m_engaged;
+    }
+
+    // Any thread, at any time, without waiting for the gearbox thread
+    Progress getProgress() const;
+
+    // How far (in encoder counts, positive if late) the spindle was from
+    // where it should have been when the first step of the last
+    // engagement was made. Every pass of a thread should be near zero.
+    double getLastStartErrorCounts() const
+    {
+        return m_lastStartError;
+    }
+
+private:
+    struct Job
+    {
+        int64_t startCount;
+        long    steps;
+        int64_t numerator;
+        int64_t divisor;
+        long    fromStep;
+        int     direction;
+        long    correction;
+    };
+
+    void threadFunction();
+    // Returns the number of steps made, and the correction made by then
+    long run( const Job& job, bool& completed, long& correction );
+    void step();
+
+    IGpio&         m_gpio;
+    RotaryEncoder& m_encoder;
+    int            m_stepPin;
+    int64_t        m_numerator{ 0 };
+    int64_t        m_divisor{ 1 };
+    PitchCompensation m_pitchCompensation;
+    double         m_mmPerStep{ 1.0 };
+    std::atomic<uint32_t> m_minStepInterval{ 0 }; // microseconds
+    std::atomic<bool> m_engaged{ false };
+    // Progress of the current (or last) engagement. The correction and
+    // completed are stored before m_engaged is cleared.
+    std::atomic<long> m_stepsMade{ 0 };
+    std::atomic<long> m_correction{ 0 };
+    std::atomic<bool> m_completed{ false };
+    std::atomic<double> m_lastStartError{ 0.0 };
+    std::atomic<bool> m_cancel{ false };
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_haveJob{ false };
+    Job  m_job;
+    bool m_quit{ false };
+    std::thread m_thread;
+};
+
+} // end namespace
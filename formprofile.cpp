@@ -0,0 +1,197 @@
+#include "formprofile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace mgo
+{
+
+namespace
+{
+
+// Allows for rounding in the numbers people type in
+constexpr double TOLERANCE = 1e-6;
+
+} // end anonymous namespace
+
+std::vector<ProfilePoint> readProfile( std::istream& is )
+{
+    std::vector<ProfilePoint> points;
+    std::string line;
+    int lineNumber = 0;
+    while( std::getline( is, line ) )
+    {
+        ++lineNumber;
+        line = line.substr( 0, line.find( '#' ) );
+        std::replace( line.begin(), line.end(), ',', ' ' );
+        std::istringstream iss( line );
+        std::string first;
+        if( ! ( iss >> first ) ) continue;
+        ProfilePoint point{ 0.0, 0.0, 0.0 };
+        bool ok;
+        if( first == "arc" )
+        {
+            ok = static_cast<bool>( iss >> point.z >> point.x >> point.radius )
+                && point.radius != 0.0;
+        }
+        else
+        {
+            std::istringstream zss( first );
+            ok = static_cast<bool>( zss >> point.z ) && zss.eof()
+                && static_cast<bool>( iss >> point.x );
+        }
+        std::string extra;
+        if( ! ok || iss >> extra )
+        {
+            throw std::runtime_error(
+                "Profile line " + std::to_string( lineNumber ) + " not understood" );
+        }
+        points.push_back( point );
+    }
+    return points;
+}
+
+std::vector<ProfilePoint> readProfileFile( const std::string& filename )
+{
+    std::ifstream ifs( filename );
+    if( ! ifs )
+    {
+        throw std::runtime_error( "Could not open profile " + filename );
+    }
+    return readProfile( ifs );
+}
+
+FormProfile::FormProfile( std::vector<ProfilePoint> points )
+    : m_points( std::move( points ) )
+{
+    if( m_points.size() < 2 )
+    {
+        throw std::runtime_error( "A profile needs at least two points" );
+    }
+    if( m_points.front().radius != 0.0 )
+    {
+        throw std::runtime_error( "A profile can't start with an arc" );
+    }
+    m_zDirection = m_points.back().z > m_points.front().z ? 1 : -1;
+    for( std::size_t n = 1; n < m_points.size(); ++n )
+    {
+        const ProfilePoint& from = m_points[ n - 1 ];
+        const ProfilePoint& to = m_points[ n ];
+        double dz = to.z - from.z;
+        double dx = to.x - from.x;
+        if( dz * m_zDirection <= 0.0 )
+        {
+            throw std::runtime_error(
+                "Profile point " + std::to_string( n + 1 ) + " doesn't carry on along Z" );
+        }
+        Segment segment{ from.z, from.x, to.z, to.x, false, 0.0, 0.0, 0.0, 1.0 };
+        if( to.radius != 0.0 )
+        {
+            // The centre is on the perpendicular bisector of the chord,
+            // on the opposite side to the bulge
+            double chord = std::hypot( dz, dx );
+            double radius = std::abs( to.radius );
+            if( radius < chord / 2.0 - TOLERANCE )
+            {
+                throw std::runtime_error(
+                    "The arc to point " + std::to_string( n + 1 ) + " is too small to get there" );
+            }
+            double h = std::sqrt( std::max( 0.0, radius * radius - chord * chord / 4.0 ) );
+            // Unit normal pointing towards -X
+            double nz = dx * m_zDirection / chord;
+            double nx = -std::abs( dz ) / chord;
+            double side = to.radius > 0.0 ? 1.0 : -1.0;
+            segment.arc = true;
+            segment.zCentre = ( from.z + to.z ) / 2.0 + side * h * nz;
+            segment.xCentre = ( from.x + to.x ) / 2.0 + side * h * nx;
+            segment.radius = radius;
+            segment.side = side;
+            // Both ends must be on the same half of the circle, otherwise
+            // the arc turns back on itself in Z
+            if( side * ( from.x - segment.xCentre ) < -TOLERANCE ||
+                side * ( to.x - segment.xCentre ) < -TOLERANCE )
+            {
+                throw std::runtime_error(
+                    "The arc to point " + std::to_string( n + 1 ) + " turns back along Z" );
+            }
+        }
+        m_segments.push_back( segment );
+    }
+}
+
+double FormProfile::xAt( const Segment& segment, double z ) const
+{
+    if( segment.arc )
+    {
+        double dz = z - segment.zCentre;
+        return segment.xCentre + segment.side *
+            std::sqrt( std::max( 0.0, segment.radius * segment.radius - dz * dz ) );
+    }
+    return segment.xStart + ( segment.xEnd - segment.xStart ) *
+        ( z - segment.zStart ) / ( segment.zEnd - segment.zStart );
+}
+
+void FormProfile::compile( double mmPerStep )
+{
+    m_mmPerStep = mmPerStep;
+    m_offsets.clear();
+    if( m_segments.empty() || mmPerStep <= 0.0 ) return;
+    double zStart = m_points.front().z;
+    double xStart = m_points.front().x;
+    std::size_t steps = static_cast<std::size_t>( std::floor( getLength() / mmPerStep ) );
+    m_offsets.reserve( steps + 1 );
+    // Z only goes one way, so we can move through the segments as we go
+    auto segment = m_segments.begin();
+    for( std::size_t step = 0; step <= steps; ++step )
+    {
+        double z = zStart + m_zDirection * ( step * mmPerStep );
+        while( segment + 1 != m_segments.end() && ( z - segment->zEnd ) * m_zDirection > 0.0 )
+        {
+            ++segment;
+        }
+        m_offsets.push_back( xAt( *segment, z ) - xStart );
+    }
+}
+
+int FormProfile::xDirectionFrom( double z, int zDirection ) const
+{
+    if( m_offsets.empty() ) return 0;
+    long step = std::lround( z * m_zDirection / m_mmPerStep );
+    long last = static_cast<long>( m_offsets.size() ) - 1;
+    step = std::clamp( step, 0L, last );
+    long stepDirection = zDirection * m_zDirection;
+    double here = m_offsets[ step ];
+    for( long n = step + stepDirection; n >= 0 && n <= last; n += stepDirection )
+    {
+        if( m_offsets[ n ] != here )
+        {
+            return m_offsets[ n ] > here ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+double FormProfile::getLength() const
+{
+    if( m_points.empty() ) return 0.0;
+    return std::abs( m_points.back().z - m_points.front().z );
+}
+
+double FormProfile::getDepth() const
+{
+    // Arcs can bulge beyond their ends, so we use the table if we can
+    if( ! m_offsets.empty() )
+    {
+        auto minmax = std::minmax_element( m_offsets.begin(), m_offsets.end() );
+        return *minmax.second - *minmax.first;
+    }
+    if( m_points.empty() ) return 0.0;
+    auto minmax = std::minmax_element( m_points.begin(), m_points.end(),
+        []( const ProfilePoint& a, const ProfilePoint& b ){ return a.x < b.x; } );
+    return minmax.second->x - minmax.first->x;
+}
+
+} // end namespace
@@ -0,0 +1,102 @@
+#pragma once
+// A shape for the cross slide to follow as the carriage moves, so things
+// like ball ends, ogives or a chamfer running into a radius can be cut
+// in one pass. Profiles are read from a text file, one point per line:
+//
+//     # comments start with a hash
+//     Z, X            a straight line from the previous point to here
+//     arc Z, X, R     an arc of radius R from the previous point to here;
+//                     a positive R bulges towards +X, a negative one
+//                     towards -X
+//
+// so a plain CSV of sampled Z,X points works too. Commas are optional.
+// Z must keep going the same way, since X has to be a function of Z. The
+// first point is where the tool is when the profile is started.
+//
+// Before it's followed, the profile is compiled into a table of X for
+// every Z step, so following it is just a lookup.
+
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace mgo
+{
+
+struct ProfilePoint
+{
+    double z;
+    double x;
+    double radius; // of an arc from the previous point, zero for a line
+};
+
+// These throw std::runtime_error, giving the line, if the profile
+// can't be understood
+std::vector<ProfilePoint> readProfile( std::istream& is );
+std::vector<ProfilePoint> readProfileFile( const std::string& filename );
+
+class FormProfile
+{
+public:
+    FormProfile() = default;
+    // Throws std::runtime_error if this isn't something we can follow
+    explicit FormProfile( std::vector<ProfilePoint> points );
+
+    // Builds the lookup table for the given leadscrew step size
+    void compile( double mmPerStep );
+
+    // X relative to the first point, at z mm from the first point (in
+    // either direction). Before the start that's the start, and beyond
+    // the end it's the end.
+    double xOffsetAt( double z ) const
+    {
+        if( m_offsets.empty() ) return 0.0;
+        double along = z * m_zDirection;
+        if( along <= 0.0 ) return 0.0;
+        std::size_t step = static_cast<std::size_t>( along / m_mmPerStep + 0.5 );
+        if( step >= m_offsets.size() ) return m_offsets.back();
+        return m_offsets[ step ];
+    }
+    // Which way X moves first (1 or -1) when the carriage moves from z in
+    // the given direction, or 0 if it doesn't move again
+    int xDirectionFrom( double z, int zDirection ) const;
+
+    bool empty() const
+    {
+        return m_points.empty();
+    }
+    std::size_t getPointCount() const
+    {
+        return m_points.size();
+    }
+    // From the first point to the last in Z, and how far X goes either way
+    double getLength() const;
+    double getDepth() const;
+    double getMmPerStep() const
+    {
+        return m_mmPerStep;
+    }
+
+private:
+    struct Segment
+    {
+        double zStart;
+        double xStart;
+        double zEnd;
+        double xEnd;
+        bool   arc;
+        double zCentre;
+        double xCentre;
+        double radius;  // always positive
+        double side;    // 1 if we're on the +X half of the circle, else -1
+    };
+    double xAt( const Segment& segment, double z ) const;
+
+    std::vector<ProfilePoint> m_points;
+    std::vector<Segment> m_segments;
+    int    m_zDirection{ 1 };
+    double m_mmPerStep{ 1.0 };
+    std::vector<double> m_offsets;
+};
+
+} // end namespace
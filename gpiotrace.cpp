@@ -0,0 +1,111 @@
+#include "gpiotrace.h"
+
+#include "log.h"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace mgo
+{
+
+namespace
+{
+
+constexpr char SIGNATURE[ 8 ] = { 'L', 'C', 'T', 'R', 'A', 'C', 'E', '1' };
+constexpr std::size_t BUFFER_RECORDS = 4'096;
+
+// Producers don't wake the writer (so they never touch a lock); it
+// looks for new records this often
+constexpr auto WRITER_POLL = std::chrono::milliseconds( 2 );
+
+} // end anonymous namespace
+
+TraceWriter::TraceWriter( const std::string& filename )
+    : m_file( filename, std::ios::binary | std::ios::trunc ),
+      m_queue( std::make_unique<Queue>() )
+{
+    if( ! m_file )
+    {
+        throw std::runtime_error( "Could not open trace file " + filename );
+    }
+    m_file.write( SIGNATURE, sizeof( SIGNATURE ) );
+    m_buffer.reserve( BUFFER_RECORDS );
+    m_thread = std::thread( &TraceWriter::threadFunction, this );
+}
+
+TraceWriter::~TraceWriter()
+{
+    m_quit = true;
+    m_thread.join();
+    // Anything which came in after the thread's last look
+    drain();
+    writeBuffer();
+    if( m_dropped > 0 )
+    {
+        MGOLOG( "GPIO trace lost " << m_dropped << " record(s)" );
+    }
+}
+
+void TraceWriter::write( const TraceRecord& record )
+{
+    if( ! m_queue->push( record ) )
+    {
+        m_dropped.fetch_add( 1, std::memory_order_relaxed );
+    }
+}
+
+void TraceWriter::threadFunction()
+{
+    while( ! m_quit )
+    {
+        drain();
+        std::this_thread::sleep_for( WRITER_POLL );
+    }
+}
+
+void TraceWriter::drain()
+{
+    TraceRecord record;
+    while( m_queue->pop( record ) )
+    {
+        m_buffer.push_back( record );
+        if( m_buffer.size() >= BUFFER_RECORDS )
+        {
+            writeBuffer();
+        }
+    }
+}
+
+void TraceWriter::writeBuffer()
+{
+    m_file.write(
+        reinterpret_cast<const char*>( m_buffer.data() ),
+        m_buffer.size() * sizeof( TraceRecord ) );
+    m_file.flush();
+    m_buffer.clear();
+}
+
+std::vector<TraceRecord> readTrace( const std::string& filename )
+{
+    std::ifstream file( filename, std::ios::binary );
+    if( ! file )
+    {
+        throw std::runtime_error( "Could not open trace file " + filename );
+    }
+    char signature[ sizeof( SIGNATURE ) ];
+    if( ! file.read( signature, sizeof( signature ) ) ||
+        std::memcmp( signature, SIGNATURE, sizeof( SIGNATURE ) ) != 0 )
+    {
+        throw std::runtime_error( filename + " is not a trace file" );
+    }
+    std::vector<TraceRecord> records;
+    TraceRecord record;
+    while( file.read( reinterpret_cast<char*>( &record ), sizeof( record ) ) )
+    {
+        records.push_back( record );
+    }
+    return records;
+}
+
+} // end namespace
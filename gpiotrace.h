@@ -0,0 +1,85 @@
+#pragma once
+// A compact binary record of what passed between the program and the GPIO:
+// encoder edges coming in, and step / direction / enable writes going out.
+// Files start with an eight-byte signature, followed by fixed-size records
+// in the order they happened. Written by RecordingGpio, read back by
+// ReplayGpio.
+
+#include "mpscqueue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mgo
+{
+
+enum class TraceEvent : uint8_t
+{
+    EncoderEdge,
+    StepPin,
+    ReversePin,
+    EnablePin
+};
+
+// Eight bytes, so a minute of a 2,000 ppr encoder at 1,000 rpm
+// (8 million edges) is about 64 MB
+struct TraceRecord
+{
+    uint32_t   tick;
+    TraceEvent event;
+    uint8_t    pin;
+    uint8_t    level; // pigpio level for edges, 1 = high for writes
+    uint8_t    unused{ 0 };
+};
+static_assert( sizeof( TraceRecord ) == 8, "trace files depend on the record size" );
+
+class TraceWriter
+{
+public:
+    // Throws if the file can't be opened
+    explicit TraceWriter( const std::string& filename );
+    ~TraceWriter();
+
+    TraceWriter( const TraceWriter& ) = delete;
+    TraceWriter& operator=( const TraceWriter& ) = delete;
+
+    // Safe to call from any thread, including the pigpio callback: it
+    // only puts the record on a lock-free queue. A thread of our own
+    // takes them off and writes them out every few thousand, and the
+    // rest when we're destroyed.
+    void write( const TraceRecord& record );
+
+    // Records lost because the writer thread fell behind
+    uint64_t getDropped() const
+    {
+        return m_dropped;
+    }
+
+private:
+    // Half a second of edges from a 2,000 ppr encoder at 1,000 rpm, to
+    // ride out the disk being slow (it's an SD card, usually)
+    using Queue = MpscQueue<TraceRecord, 65'536>;
+
+    void threadFunction();
+    // Writer thread only
+    void drain();
+    void writeBuffer();
+
+    std::ofstream m_file;
+    // On the heap, as it's a few megabytes
+    std::unique_ptr<Queue> m_queue;
+    std::vector<TraceRecord> m_buffer;
+    std::atomic<uint64_t> m_dropped{ 0 };
+    std::atomic<bool> m_quit{ false };
+    std::thread m_thread;
+};
+
+// Throws if the file can't be read or isn't a trace
+std::vector<TraceRecord> readTrace( const std::string& filename );
+
+} // end namespace
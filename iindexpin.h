@@ -0,0 +1,27 @@
+#pragma once
+// IGpio (from stepperControl) only registers encoder pins in A/B pairs,
+// and registering the encoder's once-per-rev index pin as a "pair" with
+// itself can replace the A/B registration. A gpio which can also watch a
+// single pin offers this interface, and the rotary encoder registers its
+// index pin through it.
+
+#include <cstdint>
+
+namespace mgo
+{
+
+class IIndexPin
+{
+public:
+    // Calls back on every level change of the pin, from the same thread
+    // as the encoder's A/B edges. Returns false if the pin can't be
+    // watched (e.g. nothing underneath us can).
+    virtual bool setIndexPinCallback(
+        int pin,
+        void ( *callback )( int, int, uint32_t, void* ),
+        void* user
+        ) = 0;
+    virtual ~IIndexPin() {}
+};
+
+} // end namespace
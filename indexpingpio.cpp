@@ -0,0 +1,31 @@
+#include "indexpingpio.h"
+
+#ifndef FAKE
+#include <pigpio.h>
+#endif
+
+namespace mgo
+{
+
+bool IndexPinGpio::setIndexPinCallback(
+    int pin,
+    void ( *callback )( int, int, uint32_t, void* ),
+    void* user
+    )
+{
+#ifdef FAKE
+    // The mock doesn't make index pulses
+    (void) pin;
+    (void) callback;
+    (void) user;
+    return false;
+#else
+    // pigpio delivers alerts for every pin from its one alert thread,
+    // so these arrive on the same thread as the A/B edges. Its alert
+    // function has the same signature as ours.
+    if( gpioSetMode( pin, PI_INPUT ) != 0 ) return false;
+    return gpioSetAlertFuncEx( pin, callback, user ) == 0;
+#endif
+}
+
+} // end namespace
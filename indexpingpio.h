@@ -0,0 +1,59 @@
+#pragma once
+// Wraps the hardware gpio, passing everything through unchanged, and adds
+// the ability to watch the encoder's index pin on its own. On the machine
+// that's done with pigpio directly; in a FAKE build there's no index
+// pulse to watch.
+
+#include "iindexpin.h"
+#include "stepperControl/igpio.h"
+
+namespace mgo
+{
+
+class IndexPinGpio : public IGpio, public IIndexPin
+{
+public:
+    explicit IndexPinGpio( IGpio& gpio )
+        : m_gpio( gpio ) {}
+
+    void setStepPin( int pin, PinState state ) override
+    {
+        m_gpio.setStepPin( pin, state );
+    }
+    void setReversePin( int pin, PinState state ) override
+    {
+        m_gpio.setReversePin( pin, state );
+    }
+    void setEnablePin( int pin, PinState state ) override
+    {
+        m_gpio.setEnablePin( pin, state );
+    }
+    void delayMicroSeconds( long usecs ) override
+    {
+        m_gpio.delayMicroSeconds( usecs );
+    }
+    void setRotaryEncoderCallback(
+        int pinA,
+        int pinB,
+        void ( *callback )( int, int, uint32_t, void* ),
+        void* user
+        ) override
+    {
+        m_gpio.setRotaryEncoderCallback( pinA, pinB, callback, user );
+    }
+    uint32_t getTick() override
+    {
+        return m_gpio.getTick();
+    }
+
+    bool setIndexPinCallback(
+        int pin,
+        void ( *callback )( int, int, uint32_t, void* ),
+        void* user
+        ) override;
+
+private:
+    IGpio& m_gpio;
+};
+
+} // end namespace
@@ -2,6 +2,8 @@
 
 #include "model.h"
 
+#include <chrono>
+
 // The "view" object encapsulates the the graphical toolkit being used.
 // Abstracting allows for easier switching of UI libraries used - for
 // instance this program originally used curses as a textual interface
@@ -9,6 +11,14 @@
 namespace mgo
 {
 
+// When a key was taken from the toolkit, and when it had been turned
+// into one of our key codes, for timing how long keys take
+struct InputTimes
+{
+    std::chrono::steady_clock::time_point polled;
+    std::chrono::steady_clock::time_point converted;
+};
+
 class IView
 {
 public:
@@ -16,7 +26,10 @@ public:
     virtual void close() = 0;
     // keypresses should be returned as ASCII codes. Should not block.
     virtual int getInput() = 0;
-    virtual void updateDisplay( const Model& ) = 0;
+    // For the key getInput() last returned
+    virtual InputTimes getInputTimes() const = 0;
+    // Returns false, having drawn nothing, if the model was busy
+    virtual bool updateDisplay( const Model& ) = 0;
     virtual ~IView(){};
 };
 
@@ -0,0 +1,39 @@
+#include "keybindings.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace mgo
+{
+
+KeyBindings::KeyBindings( int axis1Leader, int axis2Leader )
+    : m_keyModeKeys( KEY_MODE_KEYS )
+{
+    // Anything without a slot of its own would share one with every
+    // other such key, and they would all become the leader
+    for( int leader : { axis1Leader, axis2Leader } )
+    {
+        if( keySlot( leader ) >= KEY_CODES )
+        {
+            throw std::runtime_error(
+                "Leader key " + std::to_string( leader ) + " must be from 0 to " +
+                std::to_string( KEY_CODES - 1 ) );
+        }
+    }
+    // A leader key takes over whatever the key did, and the default
+    // leader then does nothing in particular (i.e. stops everything,
+    // as any other key with no meaning does)
+    KeyTable& normal = m_keyModeKeys[ toIndex( KeyMode::None ) ];
+    if( axis1Leader != key::z )
+    {
+        normal[ keySlot( key::z ) ] = Action::StopAll;
+    }
+    if( axis2Leader != key::x )
+    {
+        normal[ keySlot( key::x ) ] = Action::StopAll;
+    }
+    normal[ keySlot( axis1Leader ) ] = Action::Axis1Leader;
+    normal[ keySlot( axis2Leader ) ] = Action::Axis2Leader;
+}
+
+} // end namespace
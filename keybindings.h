@@ -0,0 +1,539 @@
+#pragma once
+// What every key does, in every mode, as tables built at compile time
+// rather than switches which each test the mode again.
+//
+// There are two levels. The mode (i.e. which dialog is on the screen)
+// gets first look at a key: typing a number in, say, or ignoring a key
+// which makes no sense there. Anything it passes on goes to the key
+// mode - normal, or waiting for the second key after a leader (Z, X or
+// F2) - which says what the key does.
+//
+// Finding what a key does is therefore an array index or two, and a new
+// mode or action is a new table entry rather than a case in each of
+// several switches. The test suite goes through every key in every mode
+// to check the tables are complete and agree with the transitions
+// declared below.
+
+#include "keycodes.h"
+#include "model.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+namespace mgo
+{
+
+enum class Action : uint8_t
+{
+    Pass,           // (modes only) leave it to the key mode
+    Ignore,
+    Type,           // part of the value being typed in
+    Accept,
+    Cancel,
+    CancelThreading,
+    ThreadPitchPrevious,
+    ThreadPitchNext,
+    RetractInwards,
+    RetractOutwards,
+    SetDiameter,
+    StopAll,
+    Quit,
+    Shutdown,
+    LatencyStats,
+    FunctionLeader,
+    Axis1Leader,
+    Axis2Leader,
+    Axis1PreviousPosition,
+    RepeatLastRelativeMove,
+    NextThreadStart,
+    ThreadingCycle,
+    Axis1SpeedUp,
+    Axis1SpeedDown,
+    Axis2SpeedUp,
+    Axis2SpeedDown,
+    Axis1SpeedPreset1,
+    Axis1SpeedPreset2,
+    Axis1SpeedPreset3,
+    Axis1SpeedPreset4,
+    Axis1SpeedPreset5,
+    Axis2SpeedPreset1,
+    Axis2SpeedPreset2,
+    Axis2SpeedPreset3,
+    Axis2SpeedPreset4,
+    Axis2SpeedPreset5,
+    Axis1MoveLeft,
+    Axis1MoveRight,
+    Axis2MoveIn,
+    Axis2MoveOut,
+    Axis1NudgeLeft,
+    Axis1NudgeLeftFine,
+    Axis1NudgeRight,
+    Axis1NudgeRightFine,
+    Axis2NudgeIn,
+    Axis2NudgeInFine,
+    Axis2NudgeOut,
+    Axis2NudgeOutFine,
+    Memorise,
+    Axis1Memorise,
+    Axis2Memorise,
+    PreviousMemory,
+    NextMemory,
+    Axis1ReturnToMemory,
+    Axis2ReturnToMemory,
+    Axis1FastReturn,
+    Axis2FastReturn,
+    Retract,
+    Axis1Zero,
+    Axis2Zero,
+    OpenHelp,
+    OpenSetup,
+    OpenThreading,
+    OpenTaper,
+    OpenRetractSetup,
+    OpenRadius,
+    OpenProfile,
+    OpenMisalignment,
+    OpenAxis1GoTo,
+    OpenAxis2GoTo,
+    OpenAxis1GoToOffset,
+    OpenAxis2GoToOffset,
+    OpenAxis1PositionSetup,
+    OpenAxis2PositionSetup,
+    Count
+};
+
+constexpr std::size_t ACTION_COUNT = static_cast<std::size_t>( Action::Count );
+// (Mode::MisalignmentSetup is the last)
+constexpr std::size_t MODE_COUNT = static_cast<std::size_t>( Mode::MisalignmentSetup ) + 1;
+constexpr std::size_t KEY_MODE_COUNT = static_cast<std::size_t>( KeyMode::Function ) + 1;
+
+constexpr std::size_t toIndex( Action action )
+{
+    return static_cast<std::size_t>( action );
+}
+constexpr std::size_t toIndex( Mode mode )
+{
+    return static_cast<std::size_t>( mode );
+}
+constexpr std::size_t toIndex( KeyMode keyMode )
+{
+    return static_cast<std::size_t>( keyMode );
+}
+
+struct ActionInfo
+{
+    Action      action;
+    const char* name;
+    // Whether it changes the mode, and if so to what
+    bool        changesMode;
+    Mode        to;
+};
+
+constexpr std::array<ActionInfo, ACTION_COUNT> ACTIONS{ {
+    { Action::Pass,                   "pass",                   false, Mode::None },
+    { Action::Ignore,                 "ignore",                 false, Mode::None },
+    { Action::Type,                   "type",                   false, Mode::None },
+    { Action::Accept,                 "accept",                 true,  Mode::None },
+    { Action::Cancel,                 "cancel",                 true,  Mode::None },
+    { Action::CancelThreading,        "cancel threading",       true,  Mode::None },
+    { Action::ThreadPitchPrevious,    "previous thread pitch",  false, Mode::None },
+    { Action::ThreadPitchNext,        "next thread pitch",      false, Mode::None },
+    { Action::RetractInwards,         "retract inwards",        false, Mode::None },
+    { Action::RetractOutwards,        "retract outwards",       false, Mode::None },
+    { Action::SetDiameter,            "set diameter",           true,  Mode::None },
+    { Action::StopAll,                "stop all",               false, Mode::None },
+    { Action::Quit,                   "quit",                   false, Mode::None },
+    { Action::Shutdown,               "shutdown",               false, Mode::None },
+    { Action::LatencyStats,           "latency stats",          false, Mode::None },
+    { Action::FunctionLeader,         "function leader",        false, Mode::None },
+    { Action::Axis1Leader,            "Z leader",               false, Mode::None },
+    { Action::Axis2Leader,            "X leader",               false, Mode::None },
+    { Action::Axis1PreviousPosition,  "Z previous position",    false, Mode::None },
+    { Action::RepeatLastRelativeMove, "repeat relative move",   false, Mode::None },
+    { Action::NextThreadStart,        "next thread start",      false, Mode::None },
+    { Action::ThreadingCycle,         "threading cycle",        false, Mode::None },
+    { Action::Axis1SpeedUp,           "Z speed up",             false, Mode::None },
+    { Action::Axis1SpeedDown,         "Z speed down",           false, Mode::None },
+    { Action::Axis2SpeedUp,           "X speed up",             false, Mode::None },
+    { Action::Axis2SpeedDown,         "X speed down",           false, Mode::None },
+    { Action::Axis1SpeedPreset1,      "Z speed preset 1",       false, Mode::None },
+    { Action::Axis1SpeedPreset2,      "Z speed preset 2",       false, Mode::None },
+    { Action::Axis1SpeedPreset3,      "Z speed preset 3",       false, Mode::None },
+    { Action::Axis1SpeedPreset4,      "Z speed preset 4",       false, Mode::None },
+    { Action::Axis1SpeedPreset5,      "Z speed preset 5",       false, Mode::None },
+    { Action::Axis2SpeedPreset1,      "X speed preset 1",       false, Mode::None },
+    { Action::Axis2SpeedPreset2,      "X speed preset 2",       false, Mode::None },
+    { Action::Axis2SpeedPreset3,      "X speed preset 3",       false, Mode::None },
+    { Action::Axis2SpeedPreset4,      "X speed preset 4",       false, Mode::None },
+    { Action::Axis2SpeedPreset5,      "X speed preset 5",       false, Mode::None },
+    { Action::Axis1MoveLeft,          "Z move left",            false, Mode::None },
+    { Action::Axis1MoveRight,         "Z move right",           false, Mode::None },
+    { Action::Axis2MoveIn,            "X move in",              false, Mode::None },
+    { Action::Axis2MoveOut,           "X move out",             false, Mode::None },
+    { Action::Axis1NudgeLeft,         "Z nudge left",           false, Mode::None },
+    { Action::Axis1NudgeLeftFine,     "Z nudge left (fine)",    false, Mode::None },
+    { Action::Axis1NudgeRight,        "Z nudge right",          false, Mode::None },
+    { Action::Axis1NudgeRightFine,    "Z nudge right (fine)",   false, Mode::None },
+    { Action::Axis2NudgeIn,           "X nudge in",             false, Mode::None },
+    { Action::Axis2NudgeInFine,       "X nudge in (fine)",      false, Mode::None },
+    { Action::Axis2NudgeOut,          "X nudge out",            false, Mode::None },
+    { Action::Axis2NudgeOutFine,      "X nudge out (fine)",     false, Mode::None },
+    { Action::Memorise,               "memorise",               false, Mode::None },
+    { Action::Axis1Memorise,          "Z memorise",             false, Mode::None },
+    { Action::Axis2Memorise,          "X memorise",             false, Mode::None },
+    { Action::PreviousMemory,         "previous memory",        false, Mode::None },
+    { Action::NextMemory,             "next memory",            false, Mode::None },
+    { Action::Axis1ReturnToMemory,    "Z return to memory",     false, Mode::None },
+    { Action::Axis2ReturnToMemory,    "X return to memory",     false, Mode::None },
+    { Action::Axis1FastReturn,        "Z fast return",          false, Mode::None },
+    { Action::Axis2FastReturn,        "X fast return",          false, Mode::None },
+    { Action::Retract,                "retract",                false, Mode::None },
+    // (leaves taper mode, as the angle was from the old zero)
+    { Action::Axis1Zero,              "Z zero",                 true,  Mode::None },
+    { Action::Axis2Zero,              "X zero",                 true,  Mode::None },
+    { Action::OpenHelp,               "help",                   true,  Mode::Help },
+    { Action::OpenSetup,              "setup",                  true,  Mode::Setup },
+    { Action::OpenThreading,          "threading",              true,  Mode::Threading },
+    { Action::OpenTaper,              "taper",                  true,  Mode::Taper },
+    { Action::OpenRetractSetup,       "retract setup",          true,  Mode::Axis2RetractSetup },
+    { Action::OpenRadius,             "radius",                 true,  Mode::Radius },
+    { Action::OpenProfile,            "profile",                true,  Mode::Profile },
+    { Action::OpenMisalignment,       "misalignment",           true,  Mode::MisalignmentSetup },
+    { Action::OpenAxis1GoTo,          "Z go to",                true,  Mode::Axis1GoTo },
+    { Action::OpenAxis2GoTo,          "X go to",                true,  Mode::Axis2GoTo },
+    { Action::OpenAxis1GoToOffset,    "Z go to offset",         true,  Mode::Axis1GoToOffset },
+    { Action::OpenAxis2GoToOffset,    "X go to offset",         true,  Mode::Axis2GoToOffset },
+    { Action::OpenAxis1PositionSetup, "Z position setup",       true,  Mode::Axis1PositionSetup },
+    { Action::OpenAxis2PositionSetup, "X position setup",       true,  Mode::Axis2PositionSetup }
+} };
+
+namespace detail
+{
+
+constexpr bool actionsInOrder()
+{
+    for( std::size_t n = 0; n < ACTION_COUNT; ++n )
+    {
+        if( toIndex( ACTIONS[ n ].action ) != n ) return false;
+    }
+    return true;
+}
+
+} // end namespace detail
+
+static_assert( detail::actionsInOrder(), "ACTIONS must be in the same order as Action" );
+
+// The modes each mode can go to. Dialogs are modal: the only way out
+// is back to normal. Normal and help (which passes every key on) can
+// open any of them.
+constexpr uint32_t modeBit( Mode mode )
+{
+    return 1u << toIndex( mode );
+}
+constexpr uint32_t ANY_MODE = ( 1u << MODE_COUNT ) - 1;
+
+constexpr std::array<uint32_t, MODE_COUNT> TRANSITIONS{ {
+    ANY_MODE,               // None
+    ANY_MODE,               // Help
+    modeBit( Mode::None ),  // Setup
+    modeBit( Mode::None ),  // Threading
+    modeBit( Mode::None ),  // Taper
+    modeBit( Mode::None ),  // Axis2RetractSetup
+    modeBit( Mode::None ),  // Axis1PositionSetup
+    modeBit( Mode::None ),  // Axis2PositionSetup
+    modeBit( Mode::None ),  // Axis1GoTo
+    modeBit( Mode::None ),  // Axis2GoTo
+    modeBit( Mode::None ),  // Axis1GoToOffset
+    modeBit( Mode::None ),  // Axis2GoToOffset
+    modeBit( Mode::None ),  // Radius
+    modeBit( Mode::None ),  // Profile
+    modeBit( Mode::None )   // MisalignmentSetup
+} };
+
+// Each table has a slot for every key code below this, one for Ctrl-Q,
+// and one for anything else
+constexpr std::size_t KEY_CODES = 512;
+constexpr std::size_t CTRL_Q_SLOT = KEY_CODES;
+constexpr std::size_t OTHER_KEY_SLOT = KEY_CODES + 1;
+constexpr std::size_t KEY_SLOTS = KEY_CODES + 2;
+
+constexpr std::size_t keySlot( int key )
+{
+    if( key >= 0 && key < static_cast<int>( KEY_CODES ) )
+    {
+        return static_cast<std::size_t>( key );
+    }
+    return key == key::CtrlQ ? CTRL_Q_SLOT : OTHER_KEY_SLOT;
+}
+
+using KeyTable = std::array<Action, KEY_SLOTS>;
+
+namespace detail
+{
+
+constexpr KeyTable filled( Action action )
+{
+    KeyTable table{};
+    for( auto& entry : table )
+    {
+        entry = action;
+    }
+    return table;
+}
+
+constexpr void bind( KeyTable& table, std::initializer_list<int> keys, Action action )
+{
+    for( int key : keys )
+    {
+        table[ keySlot( key ) ] = action;
+    }
+}
+
+constexpr void bindDigits( KeyTable& table, Action action )
+{
+    for( int key = key::ZERO; key <= key::NINE; ++key )
+    {
+        table[ keySlot( key ) ] = action;
+    }
+}
+
+constexpr KeyTable modeKeys( Mode mode )
+{
+    if( mode == Mode::None )
+    {
+        return filled( Action::Pass );
+    }
+    // Help is shown over normal running, so everything works as usual
+    KeyTable table = filled( mode == Mode::Help ? Action::Pass : Action::Ignore );
+    bind( table, { key::ESC, key::CtrlQ }, Action::Pass );
+    bind( table, { key::ENTER }, Action::Accept );
+    switch( mode )
+    {
+        case Mode::None:
+        case Mode::Help:
+            break;
+        case Mode::Setup:
+            // Moves at the setup speed
+            bind( table, { key::LEFT, key::RIGHT, key::UP, key::DOWN, key::SPACE },
+                Action::Pass );
+            break;
+        case Mode::Threading:
+            bind( table, { key::UP }, Action::ThreadPitchPrevious );
+            bind( table, { key::DOWN }, Action::ThreadPitchNext );
+            // Number of starts
+            bindDigits( table, Action::Type );
+            bind( table, { key::BACKSPACE, key::DELETE }, Action::Type );
+            bind( table, { key::ESC }, Action::CancelThreading );
+            break;
+        case Mode::Axis2RetractSetup:
+            bind( table, { key::UP }, Action::RetractInwards );
+            bind( table, { key::DOWN }, Action::RetractOutwards );
+            break;
+        case Mode::Profile:
+            // Nothing to type in; Enter starts it from here
+            break;
+        case Mode::Axis2PositionSetup:
+            bindDigits( table, Action::Type );
+            bind( table, { key::FULLSTOP, key::BACKSPACE, key::DELETE, key::MINUS },
+                Action::Type );
+            bind( table, { key::d, key::D }, Action::SetDiameter );
+            break;
+        case Mode::Axis1GoTo:
+        case Mode::Axis2GoTo:
+            bindDigits( table, Action::Type );
+            // A comma gives a point to go to on both axes, and a space
+            // separates several to go through one after the other
+            bind( table, { key::FULLSTOP, key::BACKSPACE, key::DELETE, key::MINUS,
+                key::COMMA, key::SPACE }, Action::Type );
+            break;
+        case Mode::MisalignmentSetup:
+            bindDigits( table, Action::Type );
+            // Commas separate the measurements for working it out
+            bind( table, { key::FULLSTOP, key::BACKSPACE, key::DELETE, key::MINUS,
+                key::COMMA }, Action::Type );
+            break;
+        case Mode::Axis1PositionSetup:
+        case Mode::Taper:
+        case Mode::Axis1GoToOffset:
+        case Mode::Axis2GoToOffset:
+        case Mode::Radius:
+            bindDigits( table, Action::Type );
+            bind( table, { key::FULLSTOP, key::BACKSPACE, key::DELETE, key::MINUS },
+                Action::Type );
+            break;
+    }
+    return table;
+}
+
+constexpr KeyTable normalKeys()
+{
+    // e.g. space bar to stop all motors
+    KeyTable table = filled( Action::StopAll );
+    bind( table, { key::F2 }, Action::FunctionLeader );
+    // The defaults; see KeyBindings for other ones
+    bind( table, { key::z }, Action::Axis1Leader );
+    bind( table, { key::x }, Action::Axis2Leader );
+    bind( table, { key::CtrlQ }, Action::Quit );
+    bind( table, { key::ASTERISK }, Action::Shutdown );
+    bind( table, { key::ESC }, Action::Cancel );
+    bind( table, { key::F1 }, Action::OpenHelp );
+    bind( table, { key::F12 }, Action::LatencyStats );
+    bind( table, { key::l, key::L }, Action::Axis1PreviousPosition );
+    bind( table, { key::FULLSTOP }, Action::RepeatLastRelativeMove );
+    bind( table, { key::n, key::N }, Action::NextThreadStart );
+    bind( table, { key::c, key::C }, Action::ThreadingCycle );
+    bind( table, { key::EQUALS }, Action::Axis1SpeedUp ); // (i.e. plus)
+    bind( table, { key::MINUS }, Action::Axis1SpeedDown );
+    bind( table, { key::w }, Action::Axis2NudgeIn );
+    bind( table, { key::W }, Action::Axis2NudgeInFine ); // extra fine with shift
+    bind( table, { key::s }, Action::Axis2NudgeOut );
+    bind( table, { key::S }, Action::Axis2NudgeOutFine );
+    bind( table, { key::a }, Action::Axis1NudgeLeft );
+    bind( table, { key::A }, Action::Axis1NudgeLeftFine );
+    bind( table, { key::d }, Action::Axis1NudgeRight );
+    bind( table, { key::D }, Action::Axis1NudgeRightFine );
+    bind( table, { key::m, key::M }, Action::Memorise );
+    bind( table, { key::ENTER }, Action::Axis1ReturnToMemory );
+    bind( table, { key::UP }, Action::Axis2MoveIn );
+    bind( table, { key::DOWN }, Action::Axis2MoveOut );
+    bind( table, { key::LEFT }, Action::Axis1MoveLeft );
+    bind( table, { key::RIGHT }, Action::Axis1MoveRight );
+    bind( table, { key::LBRACKET }, Action::PreviousMemory );
+    bind( table, { key::RBRACKET }, Action::NextMemory );
+    // Speed presets for Z with number keys 1-5, and X with 6-0
+    bind( table, { key::ONE }, Action::Axis1SpeedPreset1 );
+    bind( table, { key::TWO }, Action::Axis1SpeedPreset2 );
+    bind( table, { key::THREE }, Action::Axis1SpeedPreset3 );
+    bind( table, { key::FOUR }, Action::Axis1SpeedPreset4 );
+    bind( table, { key::FIVE }, Action::Axis1SpeedPreset5 );
+    bind( table, { key::SIX }, Action::Axis2SpeedPreset1 );
+    bind( table, { key::SEVEN }, Action::Axis2SpeedPreset2 );
+    bind( table, { key::EIGHT }, Action::Axis2SpeedPreset3 );
+    bind( table, { key::NINE }, Action::Axis2SpeedPreset4 );
+    bind( table, { key::ZERO }, Action::Axis2SpeedPreset5 );
+    bind( table, { key::f, key::F }, Action::Axis1FastReturn );
+    bind( table, { key::r, key::R }, Action::Retract );
+    return table;
+}
+
+// After the Z leader
+constexpr KeyTable axis1Keys()
+{
+    KeyTable table = filled( Action::StopAll );
+    bind( table, { key::z }, Action::Axis1Zero );
+    bind( table, { key::m }, Action::Axis1Memorise );
+    bind( table, { key::g }, Action::OpenAxis1GoTo );
+    bind( table, { key::r }, Action::OpenAxis1GoToOffset );
+    bind( table, { key::s }, Action::OpenAxis1PositionSetup );
+    bind( table, { key::f }, Action::Axis1FastReturn );
+    bind( table, { key::ENTER }, Action::Axis1ReturnToMemory );
+    bind( table, { key::MINUS }, Action::Axis1SpeedDown );
+    bind( table, { key::EQUALS }, Action::Axis1SpeedUp );
+    bind( table, { key::ONE }, Action::Axis1SpeedPreset1 );
+    bind( table, { key::TWO }, Action::Axis1SpeedPreset2 );
+    bind( table, { key::THREE }, Action::Axis1SpeedPreset3 );
+    bind( table, { key::FOUR }, Action::Axis1SpeedPreset4 );
+    bind( table, { key::FIVE }, Action::Axis1SpeedPreset5 );
+    return table;
+}
+
+// After the X leader
+constexpr KeyTable axis2Keys()
+{
+    KeyTable table = filled( Action::StopAll );
+    bind( table, { key::z }, Action::Axis2Zero );
+    bind( table, { key::m }, Action::Axis2Memorise );
+    bind( table, { key::g }, Action::OpenAxis2GoTo );
+    bind( table, { key::r }, Action::OpenAxis2GoToOffset );
+    bind( table, { key::s }, Action::OpenAxis2PositionSetup );
+    bind( table, { key::f }, Action::Axis2FastReturn );
+    bind( table, { key::ENTER }, Action::Axis2ReturnToMemory );
+    bind( table, { key::MINUS }, Action::Axis2SpeedDown );
+    bind( table, { key::EQUALS }, Action::Axis2SpeedUp );
+    bind( table, { key::ONE }, Action::Axis2SpeedPreset1 );
+    bind( table, { key::TWO }, Action::Axis2SpeedPreset2 );
+    bind( table, { key::THREE }, Action::Axis2SpeedPreset3 );
+    bind( table, { key::FOUR }, Action::Axis2SpeedPreset4 );
+    bind( table, { key::FIVE }, Action::Axis2SpeedPreset5 );
+    return table;
+}
+
+// After F2
+constexpr KeyTable functionKeys()
+{
+    KeyTable table = filled( Action::Ignore );
+    bind( table, { key::h, key::H }, Action::OpenHelp );
+    bind( table, { key::s, key::S }, Action::OpenSetup );
+    bind( table, { key::t, key::T }, Action::OpenThreading );
+    // > and < look like a taper
+    bind( table, { key::p, key::P, key::FULLSTOP, key::COMMA }, Action::OpenTaper );
+    bind( table, { key::r, key::R }, Action::OpenRetractSetup );
+    bind( table, { key::o, key::O }, Action::OpenRadius );
+    bind( table, { key::f, key::F }, Action::OpenProfile );
+    bind( table, { key::m, key::M }, Action::OpenMisalignment );
+    return table;
+}
+
+constexpr std::array<KeyTable, MODE_COUNT> allModeKeys()
+{
+    std::array<KeyTable, MODE_COUNT> tables{};
+    for( std::size_t mode = 0; mode < MODE_COUNT; ++mode )
+    {
+        tables[ mode ] = modeKeys( static_cast<Mode>( mode ) );
+    }
+    return tables;
+}
+
+constexpr KeyTable xMovementKeys()
+{
+    KeyTable table = filled( Action::Pass );
+    bind( table, { key::UP, key::DOWN, key::W, key::w, key::s, key::S }, Action::Ignore );
+    return table;
+}
+
+} // end namespace detail
+
+constexpr std::array<KeyTable, MODE_COUNT> MODE_KEYS = detail::allModeKeys();
+
+// In the same order as KeyMode
+constexpr std::array<KeyTable, KEY_MODE_COUNT> KEY_MODE_KEYS{ {
+    detail::normalKeys(),
+    detail::axis1Keys(),
+    detail::axis2Keys(),
+    detail::functionKeys()
+} };
+
+// While X is retracted, these are ignored whatever the mode
+constexpr KeyTable RETRACTED_KEYS = detail::xMovementKeys();
+
+// The tables, with the axis leader keys as configured
+class KeyBindings
+{
+public:
+    // Throws if a leader key is outside the tables' own key codes
+    explicit KeyBindings( int axis1Leader = key::z, int axis2Leader = key::x );
+
+    // What the mode does with the key. Anything but Action::Pass is
+    // the end of it.
+    Action modeAction( Mode mode, bool retracted, int key ) const
+    {
+        std::size_t slot = keySlot( key );
+        if( retracted && RETRACTED_KEYS[ slot ] == Action::Ignore )
+        {
+            return Action::Ignore;
+        }
+        return MODE_KEYS[ toIndex( mode ) ][ slot ];
+    }
+    // What the key does, if the mode passes it on
+    Action keyModeAction( KeyMode keyMode, int key ) const
+    {
+        return m_keyModeKeys[ toIndex( keyMode ) ][ keySlot( key ) ];
+    }
+
+private:
+    std::array<KeyTable, KEY_MODE_COUNT> m_keyModeKeys;
+};
+
+} // end namespace
@@ -0,0 +1,220 @@
+#include "latency.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace mgo
+{
+
+namespace
+{
+
+uint32_t microsecondsBetween(
+    LatencyMonitor::Clock::time_point from,
+    LatencyMonitor::Clock::time_point to
+    )
+{
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>( to - from ).count();
+    if( us < 0 ) return 0;
+    if( us > UINT32_MAX ) return UINT32_MAX;
+    return static_cast<uint32_t>( us );
+}
+
+} // end anonymous namespace
+
+const char* latencyStageName( LatencyStage stage )
+{
+    switch( stage )
+    {
+        case LatencyStage::Polled:       return "polled";
+        case LatencyStage::Converted:    return "converted";
+        case LatencyStage::Dispatched:   return "dispatched";
+        case LatencyStage::ModelCalled:  return "model called";
+        case LatencyStage::MotorStarted: return "motor started";
+        case LatencyStage::FirstStep:    return "first step";
+        case LatencyStage::Count:        break;
+    }
+    return "?";
+}
+
+void LatencyHistogram::add( uint32_t microseconds )
+{
+    // The smallest power of two it's no more than
+    std::size_t bucket = 0;
+    while( bucket < BUCKETS - 1 && ( 1ull << bucket ) < microseconds )
+    {
+        ++bucket;
+    }
+    ++m_buckets[ bucket ];
+    ++m_count;
+    m_total += microseconds;
+    if( microseconds > m_max )
+    {
+        m_max = microseconds;
+    }
+}
+
+uint32_t LatencyHistogram::getPercentile( double fraction ) const
+{
+    if( m_count == 0 ) return 0;
+    uint64_t wanted = static_cast<uint64_t>( std::ceil( fraction * m_count ) );
+    uint64_t soFar = 0;
+    for( std::size_t bucket = 0; bucket < BUCKETS - 1; ++bucket )
+    {
+        soFar += m_buckets[ bucket ];
+        if( soFar >= wanted && soFar > 0 )
+        {
+            return std::min( static_cast<uint32_t>( 1ull << bucket ), m_max );
+        }
+    }
+    return m_max;
+}
+
+void LatencyMonitor::begin(
+    Action action,
+    Clock::time_point polled,
+    Clock::time_point converted,
+    Clock::time_point dispatched,
+    bool motorsRunning
+    )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    if( m_active )
+    {
+        finishLocked();
+    }
+    m_active = true;
+    m_action = action;
+    m_motorsWereRunning = motorsRunning;
+    m_modelReturned = false;
+    m_reached.fill( false );
+    m_times[ toIndex( LatencyStage::Polled ) ] = polled;
+    m_times[ toIndex( LatencyStage::Converted ) ] = converted;
+    m_times[ toIndex( LatencyStage::Dispatched ) ] = dispatched;
+    m_reached[ toIndex( LatencyStage::Polled ) ] = true;
+    m_reached[ toIndex( LatencyStage::Converted ) ] = true;
+    m_reached[ toIndex( LatencyStage::Dispatched ) ] = true;
+    // Watching from here, as the model may start a motor and then wait
+    // for it before it returns. If the motors are already going, their
+    // steps aren't this key's.
+    m_awaitingMotor = ! motorsRunning;
+}
+
+void LatencyMonitor::modelWaiting( Clock::time_point now )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    if( ! m_active || m_reached[ toIndex( LatencyStage::ModelCalled ) ] ) return;
+    m_times[ toIndex( LatencyStage::ModelCalled ) ] = now;
+    m_reached[ toIndex( LatencyStage::ModelCalled ) ] = true;
+}
+
+void LatencyMonitor::modelCalled( bool motorsRunning, Clock::time_point now )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    if( ! m_active ) return;
+    m_modelReturned = true;
+    // Unless it was already had before a wait for the motors
+    if( ! m_reached[ toIndex( LatencyStage::ModelCalled ) ] )
+    {
+        m_times[ toIndex( LatencyStage::ModelCalled ) ] = now;
+        m_reached[ toIndex( LatencyStage::ModelCalled ) ] = true;
+    }
+    if( m_motorsWereRunning || ! motorsRunning ||
+        m_reached[ toIndex( LatencyStage::FirstStep ) ] )
+    {
+        // Nothing started, or it has already stepped, so nothing more
+        // to wait for
+        finishLocked();
+    }
+}
+
+void LatencyMonitor::motorActivity( bool step, Clock::time_point now )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    if( ! m_active || ! m_awaitingMotor ) return;
+    if( ! m_reached[ toIndex( LatencyStage::MotorStarted ) ] )
+    {
+        m_times[ toIndex( LatencyStage::MotorStarted ) ] = now;
+        m_reached[ toIndex( LatencyStage::MotorStarted ) ] = true;
+    }
+    if( step )
+    {
+        m_times[ toIndex( LatencyStage::FirstStep ) ] = now;
+        m_reached[ toIndex( LatencyStage::FirstStep ) ] = true;
+        // If the model hasn't returned yet (it's waiting for the motor,
+        // say), modelCalled() finishes it off
+        if( m_modelReturned )
+        {
+            finishLocked();
+        }
+        else
+        {
+            m_awaitingMotor = false;
+        }
+    }
+}
+
+void LatencyMonitor::tick( Clock::time_point now )
+{
+    if( ! m_awaitingMotor.load( std::memory_order_relaxed ) ) return;
+    std::lock_guard<std::mutex> lock( m_mutex );
+    if( m_active && now - m_times[ toIndex( LatencyStage::Polled ) ] > MOTOR_TIMEOUT )
+    {
+        finishLocked();
+    }
+}
+
+void LatencyMonitor::finishLocked()
+{
+    auto& histograms = m_histograms[ toIndex( m_action ) ];
+    Clock::time_point polled = m_times[ toIndex( LatencyStage::Polled ) ];
+    for( std::size_t stage = 0; stage < LATENCY_STAGE_COUNT; ++stage )
+    {
+        if( m_reached[ stage ] )
+        {
+            histograms[ stage ].add( microsecondsBetween( polled, m_times[ stage ] ) );
+        }
+    }
+    m_active = false;
+    m_awaitingMotor = false;
+}
+
+void LatencyMonitor::write( std::ostream& os ) const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    os << "Key latency, microseconds after the key was polled"
+          " (median / 90% / 99% / max):\n";
+    for( std::size_t action = 0; action < ACTION_COUNT; ++action )
+    {
+        const auto& histograms = m_histograms[ action ];
+        uint64_t keys = histograms[ toIndex( LatencyStage::Polled ) ].getCount();
+        if( keys == 0 ) continue;
+        os << "  " << ACTIONS[ action ].name << ": " << keys << ( keys == 1 ? " key\n" : " keys\n" );
+        // (polled is always nought)
+        for( std::size_t stage = 1; stage < LATENCY_STAGE_COUNT; ++stage )
+        {
+            const LatencyHistogram& histogram = histograms[ stage ];
+            if( histogram.getCount() == 0 ) continue;
+            os << "    " << std::left << std::setw( 14 )
+               << latencyStageName( static_cast<LatencyStage>( stage ) ) << std::right
+               << std::setw( 8 ) << histogram.getPercentile( 0.5 ) << " /"
+               << std::setw( 8 ) << histogram.getPercentile( 0.9 ) << " /"
+               << std::setw( 8 ) << histogram.getPercentile( 0.99 ) << " /"
+               << std::setw( 8 ) << histogram.getMax();
+            if( histogram.getCount() != keys )
+            {
+                os << "  (" << histogram.getCount() << " of them)";
+            }
+            os << "\n";
+        }
+    }
+}
+
+LatencyHistogram LatencyMonitor::getHistogram( Action action, LatencyStage stage ) const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_histograms[ toIndex( action ) ][ toIndex( stage ) ];
+}
+
+} // end namespace
@@ -0,0 +1,151 @@
+#pragma once
+// How long each key takes to get from the keyboard to the motor, broken
+// down by where the time goes. A key is timed at each stage it passes
+// through: taken from the toolkit, converted to our key code, picked up
+// by the command executor, handed to the model (with its mutex), the
+// motor's thread starting work (its first GPIO write), and its first
+// step pulse. For each action, and each stage, we keep a histogram of
+// the time since the key was taken from the toolkit.
+//
+// The model can start a motor and then wait for it before it returns.
+// The time taken to get that far counts as the model being called, and
+// the wait itself doesn't.
+//
+// Only one key is followed at a time, which is all there is in
+// practice: the next one finishes it off if it hasn't finished itself.
+// A key which doesn't start a motor from rest (typing a number, or
+// nudging one which is already going) finishes once the model has had
+// it.
+
+#include "keybindings.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+
+namespace mgo
+{
+
+enum class LatencyStage : uint8_t
+{
+    Polled,
+    Converted,
+    Dispatched,
+    ModelCalled,
+    MotorStarted,
+    FirstStep,
+    Count
+};
+
+constexpr std::size_t LATENCY_STAGE_COUNT = static_cast<std::size_t>( LatencyStage::Count );
+
+constexpr std::size_t toIndex( LatencyStage stage )
+{
+    return static_cast<std::size_t>( stage );
+}
+
+const char* latencyStageName( LatencyStage stage );
+
+// Power-of-two buckets in microseconds: the first is up to 1 us, the
+// last everything from about a second up
+class LatencyHistogram
+{
+public:
+    static constexpr std::size_t BUCKETS = 22;
+
+    void add( uint32_t microseconds );
+
+    uint64_t getCount() const
+    {
+        return m_count;
+    }
+    uint32_t getMax() const
+    {
+        return m_max;
+    }
+    uint32_t getMean() const
+    {
+        return m_count == 0 ? 0 : static_cast<uint32_t>( m_total / m_count );
+    }
+    // The top of the bucket the given fraction (0 to 1) of the samples
+    // are in or below, so the answer is within a factor of two. Never
+    // more than the largest sample.
+    uint32_t getPercentile( double fraction ) const;
+    uint64_t getBucket( std::size_t bucket ) const
+    {
+        return m_buckets.at( bucket );
+    }
+
+private:
+    std::array<uint64_t, BUCKETS> m_buckets{};
+    uint64_t m_count{ 0 };
+    uint64_t m_total{ 0 };
+    uint32_t m_max{ 0 };
+};
+
+class LatencyMonitor
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // How long we wait for the motor to step before giving up on it; the
+    // stages so far are still counted
+    static constexpr auto MOTOR_TIMEOUT = std::chrono::seconds( 1 );
+
+    // On the executor's thread, with the model's mutex held, once we
+    // know what the key does. If another key is still being followed,
+    // it's finished off.
+    void begin(
+        Action action,
+        Clock::time_point polled,
+        Clock::time_point converted,
+        Clock::time_point dispatched,
+        bool motorsRunning
+        );
+    // When the model, part way through a key, starts waiting for a
+    // motor. Counts as the model having been called, if it hasn't been.
+    void modelWaiting( Clock::time_point now = Clock::now() );
+    // Once the model has been told what to do, still with its mutex
+    void modelCalled( bool motorsRunning, Clock::time_point now = Clock::now() );
+    // From the motor threads, on every pin they write, so it has to be
+    // cheap when nothing is waiting. The first write of any kind is the
+    // motor's thread starting work; then we wait for a step.
+    void motorWrite( bool step )
+    {
+        if( m_awaitingMotor.load( std::memory_order_relaxed ) )
+        {
+            motorActivity( step, Clock::now() );
+        }
+    }
+    // Any thread, every so often. Finishes the key if the motor has
+    // had long enough.
+    void tick( Clock::time_point now = Clock::now() );
+
+    // A table of every action with any keys timed, and for each stage,
+    // how long after the key was polled it got there
+    void write( std::ostream& os ) const;
+
+    LatencyHistogram getHistogram( Action action, LatencyStage stage ) const;
+
+private:
+    void motorActivity( bool step, Clock::time_point now );
+    void finishLocked();
+
+    mutable std::mutex m_mutex;
+    // The key being followed
+    bool m_active{ false };
+    bool m_motorsWereRunning{ false };
+    bool m_modelReturned{ false };
+    Action m_action{ Action::Ignore };
+    std::array<Clock::time_point, LATENCY_STAGE_COUNT> m_times{};
+    std::array<bool, LATENCY_STAGE_COUNT> m_reached{};
+    std::atomic<bool> m_awaitingMotor{ false };
+
+    std::array<std::array<LatencyHistogram, LATENCY_STAGE_COUNT>, ACTION_COUNT> m_histograms{};
+};
+
+} // end namespace
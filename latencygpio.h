@@ -0,0 +1,66 @@
+#pragma once
+// Sits between the motors and the GPIO, passing everything through
+// unchanged but telling the LatencyMonitor when a motor writes a pin, so
+// a key can be timed to its first step pulse.
+
+#include "iindexpin.h"
+#include "latency.h"
+#include "stepperControl/igpio.h"
+
+namespace mgo
+{
+
+class LatencyGpio : public IGpio, public IIndexPin
+{
+public:
+    LatencyGpio( IGpio& gpio, LatencyMonitor& monitor )
+        : m_gpio( gpio ), m_monitor( monitor ) {}
+
+    void setStepPin( int pin, PinState state ) override
+    {
+        m_gpio.setStepPin( pin, state );
+        m_monitor.motorWrite( state == PinState::high );
+    }
+    void setReversePin( int pin, PinState state ) override
+    {
+        m_gpio.setReversePin( pin, state );
+        m_monitor.motorWrite( false );
+    }
+    void setEnablePin( int pin, PinState state ) override
+    {
+        m_gpio.setEnablePin( pin, state );
+        m_monitor.motorWrite( false );
+    }
+    void delayMicroSeconds( long usecs ) override
+    {
+        m_gpio.delayMicroSeconds( usecs );
+    }
+    void setRotaryEncoderCallback(
+        int pinA,
+        int pinB,
+        void ( *callback )( int, int, uint32_t, void* ),
+        void* user
+        ) override
+    {
+        m_gpio.setRotaryEncoderCallback( pinA, pinB, callback, user );
+    }
+    uint32_t getTick() override
+    {
+        return m_gpio.getTick();
+    }
+    bool setIndexPinCallback(
+        int pin,
+        void ( *callback )( int, int, uint32_t, void* ),
+        void* user
+        ) override
+    {
+        IIndexPin* indexPin = dynamic_cast<IIndexPin*>( &m_gpio );
+        return indexPin != nullptr && indexPin->setIndexPinCallback( pin, callback, user );
+    }
+
+private:
+    IGpio& m_gpio;
+    LatencyMonitor& m_monitor;
+};
+
+} // end namespace
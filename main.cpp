@@ -8,8 +8,12 @@
 #include "log.h"
 #include "model.h"
 #include "configreader.h"
+#include "indexpingpio.h"
+#include "latencygpio.h"
+#include "recordinggpio.h"
 
 #include <iostream>
+#include <memory>
 
 int main( int argc, char* argv[] )
 {
@@ -36,9 +40,28 @@ int main( int argc, char* argv[] )
         }
 
         mgo::ConfigReader config( configFile );
-        mgo::Model model( gpio, config );
 
-        mgo::Controller controller( &model );
+        // Lets the encoder watch its index pin separately from A and B
+        mgo::IndexPinGpio indexGpio( gpio );
+
+        // Optionally capture everything going to and from the GPIO,
+        // so problems seen on the machine can be replayed later
+        std::unique_ptr<mgo::RecordingGpio> recordingGpio;
+        std::string traceFile = config.read( "GpioTraceFile", "" );
+        if( ! traceFile.empty() )
+        {
+            recordingGpio = std::make_unique<mgo::RecordingGpio>( indexGpio, traceFile );
+            MGOLOG( "Recording GPIO trace to " << traceFile );
+        }
+        mgo::IGpio& tracedGpio = recordingGpio ?
+            static_cast<mgo::IGpio&>( *recordingGpio ) : indexGpio;
+        // Watches for the motors' first step after a key, for timing
+        // how long keys take; F12 shows the results
+        mgo::LatencyMonitor latency;
+        mgo::LatencyGpio modelGpio( tracedGpio, latency );
+        mgo::Model model( modelGpio, config );
+
+        mgo::Controller controller( &model, &latency );
         controller.run();
 
         return 0;
@@ -0,0 +1,25 @@
+#include "misalignment.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace mgo
+{
+
+double misalignmentCorrectionAngle(
+    double chuckEndDiameter,
+    double tailEndDiameter,
+    double distance
+    )
+{
+    if( distance <= 0.0 )
+    {
+        throw std::runtime_error( "Distance between measurements must be more than zero" );
+    }
+    // Bigger at the chuck end means the tool has to come in as it gets
+    // there. Half the difference, as it's a diameter.
+    double radiusError = ( chuckEndDiameter - tailEndDiameter ) / 2.0;
+    return -std::atan( radiusError / distance ) * 180.0 / 3.14159265359;
+}
+
+} // end namespace
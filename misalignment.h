@@ -0,0 +1,20 @@
+#pragma once
+// Works out the misalignment correction angle from a test cut. Turn a
+// plain bar, measure its diameter in two places, and the difference
+// over the distance between them is the taper the lathe cuts. The
+// correction is the angle which takes that back out, in the same sense
+// as LatheMisalignmentCorrectionTaper: negative moves the tool inwards
+// as it approaches the chuck.
+
+namespace mgo
+{
+
+// The angle (degrees) to add to whatever correction the test cut was
+// made with. Throws if the distance isn't positive.
+double misalignmentCorrectionAngle(
+    double chuckEndDiameter,
+    double tailEndDiameter,
+    double distance             // between the two, mm
+    );
+
+} // end namespace
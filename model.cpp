@@ -1,9 +1,13 @@
 #include "model.h"
+#include "misalignment.h"
 #include "threadpitches.h"  // for ThreadPitch, threadPitches
 
 #include "fmt/format.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <numeric>
 #include <sstream>
 
 namespace
@@ -23,6 +27,31 @@ std::string convertToString( double number, int decimalPlaces )
     return oss.str();
 }
 
+// For "go to" input such as "12.5,3" (Z then X), or several of those
+// separated by spaces
+bool parsePoints( const std::string& input, std::vector<std::pair<double, double>>& points )
+{
+    std::istringstream iss( input );
+    std::string point;
+    points.clear();
+    while( iss >> point )
+    {
+        std::size_t comma = point.find( ',' );
+        if( comma == std::string::npos ) return false;
+        try
+        {
+            points.emplace_back(
+                std::stod( point.substr( 0, comma ) ),
+                std::stod( point.substr( comma + 1 ) ) );
+        }
+        catch( ... )
+        {
+            return false;
+        }
+    }
+    return ! points.empty();
+}
+
 } // anonymous namepace
 
 namespace mgo
@@ -65,9 +94,74 @@ void Model::initialise()
         m_config.readLong(  "RotaryEncoderGpioPinA", 23 ),
         m_config.readLong(  "RotaryEncoderGpioPinB", 24 ),
         m_config.readLong(  "RotaryEncoderPulsesPerRev", 2'000 ),
-        m_config.readDouble( "RotaryEncoderGearingNumerator", 35.0 ) /
-            m_config.readDouble( "RotaryEncoderGearingDivisor", 30.0 )
+        m_config.readLong(  "RotaryEncoderGearingNumerator", 35 ),
+        m_config.readLong(  "RotaryEncoderGearingDivisor", 30 ),
+        m_config.readLong(  "RotaryEncoderGpioPinIndex", 0 )
         );
+    m_rotaryEncoder->getScheduler().setSpinWindowMicroseconds(
+        m_config.readLong( "SchedulerSpinWindowMicroseconds", 50 ) );
+    m_rotaryEncoder->getScheduler().setGiveUpMicroseconds(
+        m_config.readLong( "SchedulerGiveUpMicroseconds", 1'000'000 ) );
+    m_rotaryEncoder->setRpmWindow(
+        m_config.readLong( "RotaryEncoderRpmWindowEdges", 64 ),
+        m_config.readLong( "RotaryEncoderRpmWindowMicroseconds", 20'000 ) );
+    m_rotaryEncoder->setRpmFilter(
+        m_config.read( "RotaryEncoderRpmFilter", "trimmed" ) == "median" ?
+            RpmFilter::Median : RpmFilter::TrimmedMean );
+
+    m_axis1PitchCompensation = loadPitchCompensation( "Axis1" );
+    m_axis2PitchCompensation = loadPitchCompensation( "Axis2" );
+
+    if( m_config.readBool( "ThreadingElectronicGearbox", true ) )
+    {
+        m_gearbox = std::make_unique<mgo::ElectronicGearbox>(
+            m_gpio,
+            *m_rotaryEncoder,
+            m_config.readLong( "Axis1GpioStepPin", 8 )
+            );
+        m_gearbox->setMaxStepsPerSecond(
+            std::abs( maxZSpeed / 60.0 / axis1ConversionFactor ) );
+        m_gearbox->setPitchCompensation( m_axis1PitchCompensation, axis1ConversionFactor );
+    }
+
+    if( ! m_config.readBool( "DisableAxis2", false ) )
+    {
+        m_coordinatedMove = std::make_unique<mgo::CoordinatedMove>(
+            m_gpio,
+            m_config.readLong( "Axis1GpioStepPin", 8 ),
+            m_config.readLong( "Axis2GpioStepPin", 20 )
+            );
+    }
+    m_motionQueue.setJunctionDeviation( m_config.readDouble( "JunctionDeviation", 0.01 ) );
+    m_axis1MaxMotorSpeed = m_config.readDouble( "Axis1MaxMotorSpeed", 700.0 );
+    m_axis1SpeedPreset2 = m_config.readDouble( "Axis1SpeedPreset2", 40.0 );
+    m_axis2SpeedPreset2 = m_config.readDouble( "Axis2SpeedPreset2", 20.0 );
+    if( ! m_config.readBool( "DisableAxis2", false ) )
+    {
+        m_misalignmentCorrection =
+            m_config.readDouble( "LatheMisalignmentCorrectionTaper", 0.0 );
+    }
+
+    std::string droopReaction = m_config.read( "SpindleDroopReaction", "none" );
+    if( droopReaction == "hold" )         m_droopReaction = DroopReaction::FeedHold;
+    else if( droopReaction == "retract" ) m_droopReaction = DroopReaction::RetractX;
+    else if( droopReaction == "stop" )    m_droopReaction = DroopReaction::StopAll;
+    else                                  m_droopReaction = DroopReaction::None;
+    if( m_droopReaction != DroopReaction::None )
+    {
+        m_spindleMonitor = std::make_unique<mgo::SpindleMonitor>(
+            m_gpio,
+            *m_rotaryEncoder,
+            [ this ](){ return reactToSpindleDroop(); },
+            m_config.readLong( "SpindleMonitorPollMicroseconds", 1'000 ),
+            m_config.readLong( "SpindleDroopEdgeLatencyMicroseconds", 2'000 )
+            );
+        m_spindleMonitor->configure(
+            m_config.readDouble( "SpindleDroopPercent", 20.0 ),
+            m_config.readLong( "SpindleDroopWindowMicroseconds", 5'000 ),
+            m_config.readDouble( "SpindleDroopMinimumRpm", 30.0 )
+            );
+    }
 
     // We need to ensure that the motors are in a known position with regard to
     // backlash - which means moving them initially by the amount of
@@ -93,6 +187,24 @@ void Model::initialise()
 
 void Model::checkStatus()
 {
+    // To tell whether anything the operator would notice has changed.
+    // The text is compared with what we last said about (below), rather
+    // than copied every tick.
+    const bool zWasRunning = m_zWasRunning;
+    const bool xWasRunning = m_xWasRunning;
+
+    // Nothing here waits for a motor: we're on the control thread, with
+    // the model locked. Stopped motors are seen to stop on a later tick.
+    uint32_t emergencyStops = m_emergencyStops;
+    if( emergencyStops != m_emergencyStopsTidied )
+    {
+        // The motors have already been stopped; this forgets what they
+        // were going to do next. Nothing is started again until the
+        // controller says it's finished with the stop (see
+        // emergencyStopHandled()).
+        m_emergencyStopsTidied = emergencyStops;
+        stopAllMotors( false );
+    }
     float chuckRpm = m_rotaryEncoder->getRpm();
     #ifndef FAKE
     if( m_spindleWasRunning && chuckRpm < 30.f )
@@ -102,45 +214,155 @@ void Model::checkStatus()
         // has turned it off because of some issue.
         // This won't stop the motors being started again even
         // if the chuck isn't moving.
-        stopAllMotors();
+        stopAllMotors( false );
     }
     #endif
     m_spindleWasRunning = chuckRpm > 30.f;
 
+    if( m_spindleDroopTripped.exchange( false ) )
+    {
+        // The motors have already been stopped; this forgets what they
+        // were going to do next
+        m_spindleDroopWarning = true;
+        m_axis1StartPending = false;
+        m_motionRuns.clear();
+        m_motionRunStepped = false;
+        // Stopped on the way, not finished
+        runWhenStopped( m_axis1WhenStopped, false );
+        if( ! m_axis2Motor->isRunning() )
+        {
+            runWhenStopped( m_axis2WhenStopped, false );
+        }
+        if( m_threadingStage != ThreadingCycleStage::Idle )
+        {
+            threadingCycleAbort( "spindle slowed" );
+        }
+        if( m_droopReaction == DroopReaction::RetractX && ! m_axis2Retracted )
+        {
+            // Once X has come to a stop, below
+            m_axis2RetractPending = true;
+            m_axis2Status = "Retracting";
+        }
+    }
+
+    // So the display, the memories and anything deciding what to do
+    // next all see where the gearbox (or a coordinated move) has taken
+    // the carriage
+    followGearbox();
+    followCoordinatedMove();
+
     if( m_enabledFunction == Mode::Threading )
     {
         // We are cutting threads, so the stepper motor's speed
         // is dependent on the spindle's RPM and the thread pitch.
-        float pitch = threadPitches.at( m_threadPitchIndex ).pitchMm;
-        // because my stepper motor / leadscrew does one mm per
-        // revolution, there is a direct correlation between spindle
-        // rpm and stepper motor rpm for a 1mm thread pitch.
-        float speed = pitch * m_rotaryEncoder->getRpm();
-        double maxZSpeed = m_config.readDouble( "Axis1MaxMotorSpeed", 700.0 );
-        if( speed > maxZSpeed * 0.8 )
+        // With the electronic gearbox the speed isn't used to drive the
+        // leadscrew, but we still stop if it would be too fast.
+        float speed = threadingZSpeed();
+        if( speed > m_axis1MaxMotorSpeed * 0.8 )
         {
+            if( m_threadingStage != ThreadingCycleStage::Idle )
+            {
+                threadingCycleAbort( "RPM too high" );
+            }
+            gearboxDisengage();
             m_axis1Motor->stop();
-            m_axis1Motor->wait();
             m_warning = "RPM too high for threading";
         }
-        else
+        else if( ! m_spindleDroopWarning && ! m_threadStartWarning )
         {
             m_warning = "";
         }
-        m_axis1Motor->setSpeed( speed );
+        // The threading cycle makes its other moves at its own speed
+        if( m_threadingStage == ThreadingCycleStage::Idle ||
+            m_threadingStage == ThreadingCycleStage::Cutting )
+        {
+            m_axis1Motor->setSpeed( speed );
+        }
+    }
+    if( m_spindleDroopWarning )
+    {
+        m_warning = "Spindle slowed suddenly - motion stopped";
     }
     if( m_xDiameterSet )
     {
-        m_generalStatus = fmt::format("Diameter: {: .3f} mm",
-            std::abs( m_axis2Motor->getPosition() * 2 ) );
+        long step = m_axis2Motor->getCurrentStep();
+        if( step != m_diameterStep || m_diameterStatus.empty() )
+        {
+            m_diameterStep = step;
+            m_diameterStatus = fmt::format("Diameter: {: .3f} mm",
+                std::abs( m_axis2Motor->getPosition( step ) * 2 ) );
+        }
+        if( m_generalStatus != m_diameterStatus )
+        {
+            m_generalStatus = m_diameterStatus;
+        }
+    }
+    if( ! m_threadingStatus.empty() )
+    {
+        m_generalStatus = m_threadingStatus;
     }
-    if ( ! m_axis2Motor->isRunning() )
+    if ( ! m_axis2Motor->isRunning() &&
+         ! ( m_coordinatedMove && m_coordinatedMove->isRunning() ) )
     {
         m_axis2Status = "stopped";
     }
-    if ( ! m_axis1Motor->isRunning() )
+    // A key that's part way through something, waiting for a motor with
+    // the model unlocked (see waitForMotor()), decides what happens once
+    // it has stopped. Until it's back, only the checks above are made.
+    if( ! m_waitingForMotor )
+    {
+        checkAxes();
+    }
+
+    bool wasMoving = m_moving;
+    m_moving = chuckRpm > 0.f || axis1IsRunning() || axis2IsRunning();
+    if( m_onChanged &&
+        ( wasMoving != m_moving ||
+          zWasRunning != m_zWasRunning || xWasRunning != m_xWasRunning ||
+          m_notifiedAxis1Status != m_axis1Status || m_notifiedAxis2Status != m_axis2Status ||
+          m_notifiedGeneralStatus != m_generalStatus || m_notifiedWarning != m_warning ) )
+    {
+        // Only copied when they've changed
+        m_notifiedAxis1Status = m_axis1Status;
+        m_notifiedAxis2Status = m_axis2Status;
+        m_notifiedGeneralStatus = m_generalStatus;
+        m_notifiedWarning = m_warning;
+        m_onChanged();
+    }
+}
+
+void Model::checkAxes()
+{
+    if( m_axis1Start.valid() &&
+        m_axis1Start.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready &&
+        ! m_axis1Start.get() && m_axis1StartPending )
+    {
+        // The scheduler gave up waiting for the spindle to reach the
+        // start angle (it has stopped, say), so the move never started
+        m_axis1StartPending = false;
+        m_threadStartWarning = true;
+        m_warning = "Spindle didn't reach the thread start";
+        runWhenStopped( m_axis1WhenStopped, false );
+    }
+    bool axis1Stopped = ! axis1IsRunning();
+    if ( axis1Stopped )
     {
         m_axis1Status = "stopped";
+        if( ( xFollowsZ() || m_misalignmentCorrection != 0.0 ) && m_zWasRunning )
+        {
+            axis2SynchroniseOff();
+        }
+    }
+    if( axis1Stopped && m_zWasRunning && ! emergencyStopped() &&
+        pitchCompensationTopUp(
+            *m_axis1Motor, m_axis1PitchCompensation, m_axis1PitchCorrection ) )
+    {
+        // Making up the pitch correction starts the motor again for a
+        // step or two, and it hasn't really stopped until that's done
+        axis1Stopped = false;
+    }
+    if ( axis1Stopped )
+    {
         if( m_zWasRunning )
         {
             // We see that axis1 has stopped. We save the position
@@ -148,43 +370,50 @@ void Model::checkStatus()
             // explicitly having saved it.
             m_axis1PreviousPositions.push( m_axis1Motor->getPosition() );
         }
-        if( m_axis1FastReturning )
-        {
-            m_axis1Motor->setSpeed( m_previousZSpeed );
-            m_axis1FastReturning = false;
-        }
-        if( ( m_enabledFunction == Mode::Taper || m_enabledFunction == Mode::Radius )
-              && m_zWasRunning )
-        {
-            axis2SynchroniseOff();
-        }
         if( m_zWasRunning && m_axis1Motor->getRpm() >= 100.0 )
         {
             // We don't allow faster speeds to "stick" to avoid accidental
             // fast motion after a long fast movement
-            m_axis1Motor->setSpeed(
-                m_config.readDouble( "Axis1SpeedPreset2", 40.0 ) );
+            m_axis1Motor->setSpeed( m_axis1SpeedPreset2 );
         }
         m_zWasRunning = false;
+        // Last, as these may start it again. Not if it has been stopped
+        // by the stop key, which hasn't been dealt with yet.
+        runWhenStopped( m_axis1WhenStopped, ! emergencyStopped() );
     }
     else
     {
-        m_zWasRunning = true;
-    }
-
-    if ( ! m_axis2Motor->isRunning() )
-    {
-        if( m_fastRetracting )
+        if( ! m_zWasRunning && m_spindleDroopWarning )
         {
-            m_axis2Motor->setSpeed( m_previousXSpeed );
-            m_fastRetracting = false;
-            m_axis2Retracted = false;
+            // The operator has carried on, so the warning has been seen
+            m_spindleDroopWarning = false;
+            m_warning = "";
         }
-        if( m_axis2FastReturning )
+        if( ! m_zWasRunning && m_threadStartWarning )
         {
-            m_axis2Motor->setSpeed( m_previousXSpeed );
-            m_axis2FastReturning = false;
+            m_threadStartWarning = false;
+            m_warning = "";
+        }
+        if( ! m_zWasRunning && m_threadingStage == ThreadingCycleStage::Idle )
+        {
+            // Something else is moving now, so the last cycle's
+            // summary no longer applies
+            m_threadingStatus = "";
         }
+        m_zWasRunning = true;
+    }
+
+    bool axis2Stopped = ! m_axis2Motor->isRunning();
+    // As for Z (but not while it might be following Z)
+    if( axis2Stopped && m_xWasRunning && ! emergencyStopped() &&
+        ( ! axis1IsRunning() || ! xFollowsZ() ) &&
+        pitchCompensationTopUp(
+            *m_axis2Motor, m_axis2PitchCompensation, m_axis2PitchCorrection ) )
+    {
+        axis2Stopped = false;
+    }
+    if ( axis2Stopped )
+    {
         if( ! ( m_enabledFunction == Mode::Taper ) &&
                 m_xWasRunning &&
                 m_axis2Motor->getSpeed() >= 80.0
@@ -192,15 +421,51 @@ void Model::checkStatus()
         {
             // We don't allow faster speeds to "stick" to avoid accidental
             // fast motion after a long fast movement
-            m_axis2Motor->setSpeed(
-                m_config.readDouble( "Axis2SpeedPreset2", 20.0 ) );
+            m_axis2Motor->setSpeed( m_axis2SpeedPreset2 );
         }
         m_xWasRunning = false;
+        if( m_axis2RetractPending )
+        {
+            // The spindle slowed, and X has now stopped, so we pull the
+            // tool out of the work
+            m_axis2RetractPending = false;
+            if( ! emergencyStopped() )
+            {
+                axis2Retract();
+            }
+        }
+        if( ! axis2IsRunning() )
+        {
+            runWhenStopped( m_axis2WhenStopped, ! emergencyStopped() );
+        }
     }
     else
     {
         m_xWasRunning = true;
     }
+
+    if( m_gearboxEngagePending && ! m_axis1StartPending )
+    {
+        // Stopped before it got going
+        m_gearboxEngagePending = false;
+    }
+    // Nothing is started until the stop key has been dealt with
+    if( ! emergencyStopped() )
+    {
+        if( m_gearboxEngagePending && ! m_axis1Motor->isRunning() )
+        {
+            gearboxEngage();
+        }
+        if( m_threadingStage != ThreadingCycleStage::Idle )
+        {
+            threadingCycleStep();
+        }
+        if( ! m_motionRuns.empty() && ! m_coordinatedMove->isRunning() &&
+            ! m_axis1Motor->isRunning() && ! m_axis2Motor->isRunning() )
+        {
+            startNextMotionRun();
+        }
+    }
 }
 
 
@@ -208,7 +473,8 @@ void Model::changeMode( Mode mode )
 {
     stopAllMotors();
     axis2SynchroniseOff();
-    if( mode == Mode::Threading || mode == Mode::Taper || mode == Mode::Radius )
+    if( mode == Mode::Threading || mode == Mode::Taper || mode == Mode::Radius ||
+        mode == Mode::Profile )
     {
         // We do not want motor speed ramping on tapering or threading
         m_axis1Motor->enableRamping( false );
@@ -222,6 +488,9 @@ void Model::changeMode( Mode mode )
         m_axis2Motor->setSpeed( m_taperPreviousXSpeed );
     }
     m_warning = "";
+    m_spindleDroopWarning = false;
+    m_threadStartWarning = false;
+    m_threadingStatus = "";
     m_currentDisplayMode = mode;
     m_enabledFunction = mode;
     m_input="";
@@ -243,6 +512,22 @@ void Model::changeMode( Mode mode )
         m_input = convertToString( m_axis2LastRelativeMove, 3 );
     }
 
+    if( mode == Mode::Threading && m_threadStarts > 1 )
+    {
+        m_input = std::to_string( m_threadStarts );
+    }
+
+    if( mode == Mode::Profile )
+    {
+        axis1SetSpeed( 10.0 );
+        loadFormProfile();
+    }
+
+    if( mode == Mode::MisalignmentSetup && m_misalignmentCorrection != 0.0 )
+    {
+        m_input = convertToString( m_misalignmentCorrection, 4 );
+    }
+
     if( mode == Mode::Radius )
     {
         axis1SetSpeed( 10.0 );
@@ -253,18 +538,74 @@ void Model::changeMode( Mode mode )
     }
 }
 
-void Model::stopAllMotors()
+void Model::stopAllMotors( bool waitForMotors )
 {
+    // Don't let a pending threading start fire after we've stopped
+    m_rotaryEncoder->cancelCallbacks();
+    m_axis1StartPending = false;
+    m_axis2RetractPending = false;
+    m_threadingStage = ThreadingCycleStage::Idle;
+    gearboxDisengage();
+    coordinatedMoveStop();
     m_axis1Motor->stop();
     m_axis2Motor->stop();
-    m_axis1Motor->wait();
-    m_axis2Motor->wait();
+    if( waitForMotors )
+    {
+        waitForMotor( *m_axis1Motor );
+        waitForMotor( *m_axis2Motor );
+    }
     m_axis1Status = "stopped";
     m_axis2Status = "stopped";
+    runWhenStopped( m_axis1WhenStopped, false );
+    runWhenStopped( m_axis2WhenStopped, false );
+}
+
+void Model::emergencyStop()
+{
+    // The flag first, so checkStatus() doesn't start anything else
+    // once these have stopped
+    ++m_emergencyStops;
+    m_rotaryEncoder->cancelCallbacks();
+    m_axis1StartPending = false;
+    if( m_gearbox )
+    {
+        m_gearbox->disengage();
+    }
+    if( m_coordinatedMove )
+    {
+        m_coordinatedMove->stop();
+    }
+    m_axis1Motor->stop();
+    m_axis2Motor->stop();
+}
+
+void Model::emergencyStopHandled()
+{
+    // Only the ones we've tidied up after; another may have come in since
+    m_emergencyStopsCleared = m_emergencyStopsTidied;
+}
+
+void Model::waitForMotor( StepperMotor& motor )
+{
+    if( ! m_mutex.heldByThisThread() )
+    {
+        motor.wait();
+        return;
+    }
+    if( m_onMotorWait && motor.isRunning() )
+    {
+        m_onMotorWait();
+    }
+    m_waitingForMotor = true;
+    m_mutex.unlock();
+    motor.wait();
+    m_mutex.lock();
+    m_waitingForMotor = false;
 }
 
 void Model::takeUpZBacklash( ZDirection direction )
 {
+    if( emergencyStopped() ) return;
     axis1Stop();
     if( direction == ZDirection::Right )
     {
@@ -274,7 +615,7 @@ void Model::takeUpZBacklash( ZDirection direction )
     {
         m_axis1Motor->goToStep( m_axis1Motor->getCurrentStep() + 1 );
     }
-    m_axis1Motor->wait();
+    waitForMotor( *m_axis1Motor );
 }
 
 void Model::startSynchronisedXMotorForTaper( ZDirection direction )
@@ -282,11 +623,14 @@ void Model::startSynchronisedXMotorForTaper( ZDirection direction )
     // Make sure X isn't already running first
     axis2SynchroniseOff();
     m_axis2Motor->stop();
-    m_axis2Motor->wait();
+    waitForMotor( *m_axis2Motor );
 
+    // The lathe's own misalignment is corrected on top of the taper
+    double angleConversion = std::tan( m_taperAngle * DEG_TO_RAD ) +
+        std::tan( m_misalignmentCorrection * DEG_TO_RAD );
     int stepAdd = -1;
-    if( ( direction == ZDirection::Left  && m_taperAngle < 0.0 ) ||
-        ( direction == ZDirection::Right && m_taperAngle > 0.0 ) )
+    if( ( direction == ZDirection::Left  && angleConversion < 0.0 ) ||
+        ( direction == ZDirection::Right && angleConversion > 0.0 ) )
     {
         stepAdd = 1;
     }
@@ -294,8 +638,35 @@ void Model::startSynchronisedXMotorForTaper( ZDirection direction )
     // up any backlash first.
     m_axis2Motor->setSpeed( 100.0 );
     m_axis2Motor->goToStep( m_axis2Motor->getCurrentStep() + stepAdd );
-    m_axis2Motor->wait();
-    double angleConversion = std::tan( m_taperAngle * DEG_TO_RAD );
+    waitForMotor( *m_axis2Motor );
+    m_axis2Motor->synchroniseOn(
+        m_axis1Motor.get(),
+        [ angleConversion ]( double zPosDelta, double )
+            {
+                return zPosDelta * angleConversion;
+            }
+        );
+    m_axis2Synchronised = true;
+}
+
+void Model::startSynchronisedXMotorForMisalignment( ZDirection direction )
+{
+    // As taper mode, but only by the correction. If X is already on its
+    // way somewhere, it's left to it.
+    if( m_misalignmentCorrection == 0.0 || m_axis2Motor->isRunning() ) return;
+    axis2SynchroniseOff();
+    double angleConversion = std::tan( m_misalignmentCorrection * DEG_TO_RAD );
+    int stepAdd = -1;
+    if( ( direction == ZDirection::Left  && angleConversion < 0.0 ) ||
+        ( direction == ZDirection::Right && angleConversion > 0.0 ) )
+    {
+        stepAdd = 1;
+    }
+    double previousSpeed = m_axis2Motor->getSpeed();
+    m_axis2Motor->setSpeed( 100.0 );
+    m_axis2Motor->goToStep( m_axis2Motor->getCurrentStep() + stepAdd );
+    waitForMotor( *m_axis2Motor );
+    m_axis2Motor->setSpeed( previousSpeed );
     m_axis2Motor->synchroniseOn(
         m_axis1Motor.get(),
         [ angleConversion ]( double zPosDelta, double )
@@ -303,61 +674,197 @@ void Model::startSynchronisedXMotorForTaper( ZDirection direction )
                 return zPosDelta * angleConversion;
             }
         );
+    m_axis2Synchronised = true;
 }
 
 void Model::startSynchronisedXMotorForRadius(ZDirection direction)
 {
     // To cut a radius, we need a defined start point for both
-    // axes. We do this by assuming zero is the start point for
-    // both (the change mode screen tells the user to zero out,
-    // such that the tool is on the outermost apex of the radius).
-    // We can then determine at any time whene axis2 should be
-    // in relation to axis1.
+    // axes. This is where the tool was when the radius was entered
+    // (the change mode screen tells the user to put the tool on
+    // the outermost apex of the radius), or zero if it was set
+    // some other way. We can then determine at any time where
+    // axis2 should be in relation to axis1.
 
     axis2SynchroniseOff();
     m_axis2Motor->stop();
-    m_axis2Motor->wait();
+    waitForMotor( *m_axis2Motor );
 
+    // A negative radius is concave, so X goes the other way
+    double sign = m_radius < 0.0 ? -1.0 : 1.0;
     int stepAdd = 1;
     if( direction == ZDirection::Left )
     {
         stepAdd = -1;
     }
+    if( sign < 0.0 )
+    {
+        stepAdd = -stepAdd;
+    }
     // As this is called just before the Z motor starts moving, we take
     // up any backlash first.
     m_axis2Motor->setSpeed( 100.0 );
     m_axis2Motor->goToStep( m_axis2Motor->getCurrentStep() + stepAdd );
-    m_axis2Motor->wait();
-    double radius = m_radius;
+    waitForMotor( *m_axis2Motor );
+
+    // The follower is called for every Z step, so the curve is worked
+    // out once here rather than each time
+    double radius = std::abs( m_radius );
+    double mmPerStep = std::abs( m_axis1Motor->getConversionFactor() );
+    if( m_radiusProfile.getRadius() != radius || m_radiusProfile.getMmPerStep() != mmPerStep )
+    {
+        m_radiusProfile = RadiusProfile( radius, mmPerStep );
+    }
+    const RadiusProfile* profile = &m_radiusProfile;
+    double zOrigin = m_radiusZOrigin;
+    double xOrigin = m_radiusXOrigin;
+    double correction = std::tan( m_misalignmentCorrection * DEG_TO_RAD );
+    m_axis2Motor->synchroniseOn(
+        m_axis1Motor.get(),
+        [ profile, sign, zOrigin, xOrigin, correction ]( double /*zPosDelta*/, double zCurrentPos )
+            {
+                // Note, we only cut a radius if z is beyond the apex.
+                // We return where X should be, not how far it should
+                // move: the profile's offset from the X origin, plus
+                // whatever the misalignment correction adds.
+                return xOrigin + sign * profile->xOffsetAt( zCurrentPos - zOrigin ) +
+                    ( zCurrentPos - zOrigin ) * correction;
+            },
+            true // always use zero as sync start pos
+        );
+    m_axis2Synchronised = true;
+}
+
+void Model::startSynchronisedXMotorForProfile( ZDirection direction )
+{
+    // As with a radius, the profile is followed from where the tool was
+    // when it was started (i.e. its first point)
+    axis2SynchroniseOff();
+    m_axis2Motor->stop();
+    waitForMotor( *m_axis2Motor );
+    if( m_formProfile.empty() ) return;
+
+    double mmPerStep = std::abs( m_axis1Motor->getConversionFactor() );
+    if( m_formProfile.getMmPerStep() != mmPerStep )
+    {
+        m_formProfile.compile( mmPerStep );
+    }
+    double zOrigin = m_formProfileZOrigin;
+    double xOrigin = m_formProfileXOrigin;
+    // Z steps run the opposite way to the position if the conversion
+    // factor is negative
+    int zDirection = direction == ZDirection::Left ? 1 : -1;
+    if( m_axis1Motor->getConversionFactor() < 0.0 )
+    {
+        zDirection = -zDirection;
+    }
+    // As this is called just before the Z motor starts moving, we take
+    // up any backlash in the way X will go first
+    int xDirection = m_formProfile.xDirectionFrom(
+        m_axis1Motor->getPosition() - zOrigin, zDirection );
+    if( m_axis2Motor->getConversionFactor() < 0.0 )
+    {
+        xDirection = -xDirection;
+    }
+    m_axis2Motor->setSpeed( 100.0 );
+    if( xDirection != 0 )
+    {
+        m_axis2Motor->goToStep( m_axis2Motor->getCurrentStep() + xDirection );
+        waitForMotor( *m_axis2Motor );
+    }
+    const FormProfile* profile = &m_formProfile;
+    double correction = std::tan( m_misalignmentCorrection * DEG_TO_RAD );
     m_axis2Motor->synchroniseOn(
         m_axis1Motor.get(),
-        [ radius ]( double /*zPosDelta*/, double zCurrentPos )
+        [ profile, zOrigin, xOrigin, correction ]( double /*zPosDelta*/, double zCurrentPos )
             {
-                // Note, we only cut a radius if z is positive.
-                //
-                // To solve for X, given Z, we can use Pythagoras
-                // as we have a right angle with known hypoteneuse
-                // (i.e. the radius): z^2 + x^2 = r^2, so
-                // sqrt( r^2 - z^2 ) = our x position
-
-                if( zCurrentPos <= 0 ) return 0.0;
-                if( zCurrentPos > radius ) return radius;
-                double xPos = std::sqrt( radius * radius - zCurrentPos * zCurrentPos );
-                // We need to return a delta
-                return radius - xPos;
+                return xOrigin + profile->xOffsetAt( zCurrentPos - zOrigin ) +
+                    ( zCurrentPos - zOrigin ) * correction;
             },
             true // always use zero as sync start pos
         );
+    m_axis2Synchronised = true;
+}
+
+void Model::loadFormProfile()
+{
+    std::string filename = m_config.read( "FormProfileFile", "profile.txt" );
+    try
+    {
+        m_formProfile = FormProfile( readProfileFile( filename ) );
+        m_formProfile.compile( std::abs( m_axis1Motor->getConversionFactor() ) );
+        m_formProfileStatus = fmt::format( "{}: {} points, {:.3f} mm long, {:.3f} mm deep",
+            filename, m_formProfile.getPointCount(), m_formProfile.getLength(),
+            m_formProfile.getDepth() );
+    }
+    catch( const std::exception& e )
+    {
+        m_formProfile = FormProfile();
+        m_formProfileStatus = e.what();
+    }
+}
+
+void Model::axis1WhenStopped( StoppedFunction whenStopped )
+{
+    if( whenStopped )
+    {
+        m_axis1WhenStopped.push_back( std::move( whenStopped ) );
+    }
 }
 
-void Model::axis1GoToStep( long step )
+void Model::axis2WhenStopped( StoppedFunction whenStopped )
 {
+    if( whenStopped )
+    {
+        m_axis2WhenStopped.push_back( std::move( whenStopped ) );
+    }
+}
+
+void Model::runWhenStopped( std::vector<StoppedFunction>& functions, bool completed )
+{
+    // Taken out first, as they may well start another move with
+    // something of its own to wait for it
+    std::vector<StoppedFunction> due;
+    due.swap( functions );
+    for( auto& function : due )
+    {
+        function( completed );
+    }
+}
+
+bool Model::startBlocked( StoppedFunction& whenStopped )
+{
+    if( ! emergencyStopped() ) return false;
+    if( whenStopped )
+    {
+        whenStopped( false );
+    }
+    return true;
+}
+
+void Model::axis1GoToStep( long step, StoppedFunction whenStopped )
+{
+    if( startBlocked( whenStopped ) ) return;
     axis1CheckForSynchronisation( step );
-    if( m_enabledFunction == Mode::Threading )
+    if( m_enabledFunction == Mode::Threading && m_gearbox )
+    {
+        axis1GearboxGoToStep( step );
+    }
+    else if( m_enabledFunction == Mode::Threading )
     {
-       m_rotaryEncoder->callbackAtZeroDegrees([&]()
+        // This returns straight away; the motor is started from the
+        // scheduler thread when the chuck reaches the current start angle
+        m_axis1StartPending = true;
+        m_axis1Start = m_rotaryEncoder->callbackAtDegrees( threadStartAngle(), [ this, step ]()
             {
-                m_axis1Motor->goToStep( step );
+                // (the stop key cancels this, but may come in as it runs)
+                if( ! emergencyStopped() )
+                {
+                    m_axis1Motor->goToStep( step );
+                    m_threadingStartTick = m_gpio.getTick();
+                    m_threadingStarted = true;
+                }
+                m_axis1StartPending = false;
             }
             );
     }
@@ -365,16 +872,29 @@ void Model::axis1GoToStep( long step )
     {
         m_axis1Motor->goToStep( step );
     }
+    axis1WhenStopped( std::move( whenStopped ) );
 }
 
-void Model::axis1GoToPosition( double pos )
+void Model::axis1GoToPosition( double pos, StoppedFunction whenStopped )
 {
+    if( startBlocked( whenStopped ) ) return;
     axis1CheckForSynchronisation( pos / m_axis1Motor->getConversionFactor() );
-    if( m_enabledFunction == Mode::Threading )
+    if( m_enabledFunction == Mode::Threading && m_gearbox )
+    {
+        axis1GearboxGoToStep( std::lround( pos / m_axis1Motor->getConversionFactor() ) );
+    }
+    else if( m_enabledFunction == Mode::Threading )
     {
-        m_rotaryEncoder->callbackAtZeroDegrees([&]()
+        m_axis1StartPending = true;
+        m_axis1Start = m_rotaryEncoder->callbackAtDegrees( threadStartAngle(), [ this, pos ]()
             {
-                m_axis1Motor->goToPosition( pos );
+                if( ! emergencyStopped() )
+                {
+                    m_axis1Motor->goToPosition( pos );
+                    m_threadingStartTick = m_gpio.getTick();
+                    m_threadingStarted = true;
+                }
+                m_axis1StartPending = false;
             }
             );
     }
@@ -383,17 +903,18 @@ void Model::axis1GoToPosition( double pos )
         m_axis1Motor->goToPosition( pos );
     }
     m_axis1Status = fmt::format( "Going to {}", pos );
+    axis1WhenStopped( std::move( whenStopped ) );
 }
 
-void Model::axis1GoToOffset( double offset )
+void Model::axis1GoToOffset( double offset, StoppedFunction whenStopped )
 {
     m_axis1LastRelativeMove = offset;
     m_lastRelativeMoveAxis = Axis::Axis1;
-    axis1GoToPosition( m_axis1Motor->getPosition() + offset );
+    axis1GoToPosition( m_axis1Motor->getPosition() + offset, std::move( whenStopped ) );
     m_axis1Status = fmt::format( "To offset {}", offset );
 }
 
-void Model::axis1GoToPreviousPosition()
+void Model::axis1GoToPreviousPosition( StoppedFunction whenStopped )
 {
     axis1Stop();
     while( ! m_axis1PreviousPositions.empty()
@@ -401,20 +922,23 @@ void Model::axis1GoToPreviousPosition()
     {
         if( m_axis1PreviousPositions.size() == 1 )
         {
+            axis1WhenStopped( std::move( whenStopped ) );
             return;
         }
         m_axis1PreviousPositions.pop();
     }
     if( m_axis1PreviousPositions.empty() )
     {
+        axis1WhenStopped( std::move( whenStopped ) );
         return;
     }
-    axis1GoToPosition( m_axis1PreviousPositions.top() );
+    axis1GoToPosition( m_axis1PreviousPositions.top(), std::move( whenStopped ) );
     m_axis1PreviousPositions.pop();
 }
 
 void Model::axis1CheckForSynchronisation( ZDirection direction )
 {
+    if( emergencyStopped() ) return;
     if( m_enabledFunction == Mode::Taper )
     {
         takeUpZBacklash( direction );
@@ -425,12 +949,20 @@ void Model::axis1CheckForSynchronisation( ZDirection direction )
         takeUpZBacklash( direction );
         startSynchronisedXMotorForRadius( direction );
     }
+    else if( m_enabledFunction == Mode::Profile )
+    {
+        takeUpZBacklash( direction );
+        startSynchronisedXMotorForProfile( direction );
+    }
+    else if( m_enabledFunction != Mode::Threading )
+    {
+        startSynchronisedXMotorForMisalignment( direction );
+    }
 }
 
 void Model::axis1CheckForSynchronisation( long step )
 {
-    if( m_enabledFunction != Mode::Taper  &&
-        m_enabledFunction != Mode::Radius )
+    if( ! xFollowsZ() && m_misalignmentCorrection == 0.0 )
     {
         return;
     }
@@ -446,27 +978,24 @@ void Model::axis1CheckForSynchronisation( long step )
     axis1CheckForSynchronisation( direction );
 }
 
-void Model::axis1GoToCurrentMemory()
+void Model::axis1GoToCurrentMemory( StoppedFunction whenStopped )
 {
-    if( m_axis1Memory.at( m_currentMemory ) == INF_RIGHT ) return;
-    if( m_axis1Memory.at( m_currentMemory ) == m_axis1Motor->getCurrentStep() ) return;
-    axis1Stop();
-    m_axis1Status = "returning";
-    axis1CheckForSynchronisation( m_axis1Memory.at( m_currentMemory ) );
-    // If threading, we need to start at the same point each time - we
-    // wait for zero degrees on the chuck before starting:
-    if( m_enabledFunction == Mode::Threading )
+    if( m_axis1Memory.at( m_currentMemory ) == INF_RIGHT ||
+        m_axis1Memory.at( m_currentMemory ) == m_axis1Motor->getCurrentStep() )
     {
-        m_rotaryEncoder->callbackAtZeroDegrees([&]()
-            {
-                axis1GoToStep( m_axis1Memory.at( m_currentMemory ) );
-            }
-            );
+        axis1WhenStopped( std::move( whenStopped ) );
+        return;
     }
-    else
+    axis1Stop();
+    m_axis1Status = "returning";
+    if( queuedAxisGoToStep( Axis::Axis1, m_axis1Memory.at( m_currentMemory ), whenStopped ) )
     {
-        axis1GoToStep( m_axis1Memory.at( m_currentMemory ) );
+        return;
     }
+    axis1CheckForSynchronisation( m_axis1Memory.at( m_currentMemory ) );
+    // If threading, axis1GoToStep waits for the chuck to reach the start
+    // angle before starting, so we start at the same point each time
+    axis1GoToStep( m_axis1Memory.at( m_currentMemory ), std::move( whenStopped ) );
 }
 
 void Model::axis1Nudge( long nudgeAmount )
@@ -476,30 +1005,326 @@ void Model::axis1Nudge( long nudgeAmount )
         nudgeAmount = -nudgeAmount;
     }
     m_axis1Motor->stop();
-    m_axis1Motor->wait();
+    waitForMotor( *m_axis1Motor );
     axis1GoToStep( m_axis1Motor->getCurrentStep() + nudgeAmount );
-    m_axis1Motor->wait();
+    waitForMotor( *m_axis1Motor );
 }
 
-void Model::axis2GoToPosition( double pos )
+void Model::axis2GoToStep( long step, StoppedFunction whenStopped )
 {
+    if( startBlocked( whenStopped ) ) return;
+    m_axis2Motor->goToStep( step );
+    axis2WhenStopped( std::move( whenStopped ) );
+}
+
+void Model::axis2GoToPosition( double pos, StoppedFunction whenStopped )
+{
+    if( startBlocked( whenStopped ) ) return;
     m_axis2Motor->goToPosition( pos );
     m_axis2Status = fmt::format( "Going to {}", pos );
+    axis2WhenStopped( std::move( whenStopped ) );
 }
 
-void Model::axis2GoToOffset( double offset )
+void Model::axis2GoToOffset( double offset, StoppedFunction whenStopped )
 {
     m_axis2LastRelativeMove = offset;
     m_lastRelativeMoveAxis = Axis::Axis2;
-    axis2GoToPosition( m_axis2Motor->getPosition() + offset );
+    axis2GoToPosition( m_axis2Motor->getPosition() + offset, std::move( whenStopped ) );
     m_axis2Status = fmt::format( "To offset {}", offset );
 }
 
+void Model::goToPositionCoordinated( double axis1Pos, double axis2Pos )
+{
+    if( ! m_coordinatedMove || axesLinked() )
+    {
+        // Tapering and the like already tie X to Z. Otherwise the line is
+        // followed whether or not there are S-curve limits: without them,
+        // at a steady rate (see coordinatedLimits()).
+        axis1GoToPosition( axis1Pos );
+        axis2GoToPosition( axis2Pos );
+        return;
+    }
+    m_motionQueue.clear();
+    queuePositionCoordinated( axis1Pos, axis2Pos );
+    runQueuedMoves();
+    m_axis1Status = fmt::format( "Going to {}, {}", axis1Pos, axis2Pos );
+    m_axis2Status = m_axis1Status;
+}
+
+void Model::goToPositionsCoordinated( const std::vector<std::pair<double, double>>& points )
+{
+    if( points.size() == 1 || ! m_coordinatedMove || axesLinked() )
+    {
+        goToPositionCoordinated( points.back().first, points.back().second );
+        return;
+    }
+    m_motionQueue.clear();
+    for( const auto& point : points )
+    {
+        queuePositionCoordinated( point.first, point.second );
+    }
+    runQueuedMoves();
+    m_axis1Status = fmt::format( "Going through {} points", points.size() );
+    m_axis2Status = m_axis1Status;
+}
+
+void Model::queuePositionCoordinated( double axis1Pos, double axis2Pos )
+{
+    m_motionQueue.add(
+        std::lround( axis1Pos / m_axis1Motor->getConversionFactor() ),
+        std::lround( axis2Pos / m_axis2Motor->getConversionFactor() ),
+        m_axis1Motor->getSpeed()
+        );
+}
+
+void Model::runQueuedMoves()
+{
+    if( ! m_coordinatedMove || axesLinked() || emergencyStopped() )
+    {
+        m_motionQueue.clear();
+        return;
+    }
+    stopAllMotors();
+    if( m_misalignmentCorrection != 0.0 )
+    {
+        // X moves by the correction for every step Z makes
+        m_motionQueue.skew(
+            m_axis1Motor->getCurrentStep(),
+            std::tan( m_misalignmentCorrection * DEG_TO_RAD ) *
+                m_axis1Motor->getConversionFactor() / m_axis2Motor->getConversionFactor() );
+    }
+    auto runs = m_motionQueue.plan(
+        m_axis1Motor->getCurrentStep(),
+        m_axis2Motor->getCurrentStep(),
+        std::abs( m_axis1Motor->getConversionFactor() ),
+        std::abs( m_axis2Motor->getConversionFactor() ),
+        [ this ]( double axis1Mm, double axis2Mm, double feed )
+            {
+                return coordinatedLimits( axis1Mm, axis2Mm, feed );
+            }
+        );
+    m_motionRuns.assign(
+        std::make_move_iterator( runs.begin() ), std::make_move_iterator( runs.end() ) );
+    m_motionRunStepped = false;
+    startNextMotionRun();
+}
+
+bool Model::axis1RapidToStep( long step )
+{
+    if( ! m_coordinatedMove || axesLinked() ) return false;
+    // The move would start and stop at full speed without both
+    if( ! sCurveConfigured( "Axis1" ) ) return false;
+    // X is left where it is, so mustn't be on its way somewhere
+    if( m_axis2Motor->isRunning() ) return false;
+    moveCoordinated(
+        step,
+        m_axis2Motor->getCurrentStep(),
+        m_config.readDouble( "Axis1MaxMotorSpeed", 1'000.0 )
+        );
+    return true;
+}
+
+void Model::moveCoordinated( long axis1Target, long axis2Target, double feed )
+{
+    m_motionQueue.clear();
+    m_motionQueue.add( axis1Target, axis2Target, feed );
+    runQueuedMoves();
+}
+
+bool Model::queuedAxisGoToStep( Axis axis, long step, StoppedFunction& whenStopped )
+{
+    if( ! m_coordinatedMove || axesLinked() || emergencyStopped() ) return false;
+    StepperMotor& motor = axis == Axis::Axis1 ? *m_axis1Motor : *m_axis2Motor;
+    StepperMotor& other = axis == Axis::Axis1 ? *m_axis2Motor : *m_axis1Motor;
+    if( ! sCurveConfigured( axis == Axis::Axis1 ? "Axis1" : "Axis2" ) ) return false;
+    // The other axis stays where it is, so mustn't be on its way somewhere
+    if( other.isRunning() ) return false;
+    if( axis == Axis::Axis1 )
+    {
+        moveCoordinated( step, m_axis2Motor->getCurrentStep(), motor.getSpeed() );
+    }
+    else
+    {
+        moveCoordinated( m_axis1Motor->getCurrentStep(), step, motor.getSpeed() );
+    }
+    // Either way, as axis1IsRunning() covers the whole of a queued move
+    // (and X's own check only looks at its motor)
+    axis1WhenStopped( std::move( whenStopped ) );
+    return true;
+}
+
+bool Model::sCurveConfigured( const std::string& axis )
+{
+    return m_config.readDouble( axis + "MaxAccel", 0.0 ) > 0.0 &&
+        m_config.readDouble( axis + "MaxJerk", 0.0 ) > 0.0;
+}
+
+MotionLimits Model::coordinatedLimits( double axis1Mm, double axis2Mm, double feed )
+{
+    // The feed rate is along the line, but neither motor may go faster
+    // (or, with an S-curve, accelerate or jerk harder) than it's allowed
+    // to. An axis moving a fraction f of the line's length only sees f of
+    // the line's speed.
+    double length = std::hypot( axis1Mm, axis2Mm );
+    MotionLimits limits{ feed / 60.0, 0.0, 0.0 };
+    bool sCurve = true;
+    auto limitBy = [ & ]( double mm, const std::string& axis )
+        {
+            if( mm == 0.0 ) return;
+            double scale = length / mm;
+            double accel = m_config.readDouble( axis + "MaxAccel", 0.0 ) * scale;
+            double jerk = m_config.readDouble( axis + "MaxJerk", 0.0 ) * scale;
+            limits.maxVelocity = std::min( limits.maxVelocity,
+                m_config.readDouble( axis + "MaxMotorSpeed", 1'000.0 ) / 60.0 * scale );
+            sCurve = sCurve && accel > 0.0 && jerk > 0.0;
+            limits.maxAcceleration = limits.maxAcceleration == 0.0 ?
+                accel : std::min( limits.maxAcceleration, accel );
+            limits.maxJerk = limits.maxJerk == 0.0 ? jerk : std::min( limits.maxJerk, jerk );
+        };
+    limitBy( axis1Mm, "Axis1" );
+    limitBy( axis2Mm, "Axis2" );
+    if( ! sCurve )
+    {
+        // A steady speed, and no blending
+        limits.maxAcceleration = 0.0;
+        limits.maxJerk = 0.0;
+    }
+    return limits;
+}
+
+void Model::startNextMotionRun()
+{
+    // The last run may only just have finished
+    followCoordinatedMove();
+    if( m_motionRuns.empty() || emergencyStopped() ) return;
+
+    // Neither axis changes direction within a run
+    int axis1Direction = 0;
+    int axis2Direction = 0;
+    for( const auto& segment : m_motionRuns.front() )
+    {
+        if( axis1Direction == 0 )
+        {
+            axis1Direction = segment.axis1Steps > 0 ? 1 : ( segment.axis1Steps < 0 ? -1 : 0 );
+        }
+        if( axis2Direction == 0 )
+        {
+            axis2Direction = segment.axis2Steps > 0 ? 1 : ( segment.axis2Steps < 0 ? -1 : 0 );
+        }
+    }
+    if( ! m_motionRunStepped )
+    {
+        // One step the right way under the motors' own control takes up
+        // any backlash and sets their direction pins, which the move
+        // leaves alone. We don't wait for it here: checkStatus() calls us
+        // again once both motors have stopped, and the move starts then.
+        m_axis1Motor->goToStep( m_axis1Motor->getCurrentStep() + axis1Direction );
+        m_axis2Motor->goToStep( m_axis2Motor->getCurrentStep() + axis2Direction );
+        m_motionRunStepped = true;
+        return;
+    }
+    if( m_axis1Motor->isRunning() || m_axis2Motor->isRunning() ) return;
+    std::vector<MotionSegment> run = std::move( m_motionRuns.front() );
+    m_motionRuns.pop_front();
+    m_motionRunStepped = false;
+    long axis1Start = m_axis1Motor->getCurrentStep();
+    long axis2Start = m_axis2Motor->getCurrentStep();
+
+    // That step comes off the first segment to move each axis
+    bool axis1Owed = axis1Direction != 0;
+    bool axis2Owed = axis2Direction != 0;
+    std::vector<CoordinatedMove::Segment> segments;
+    double runTime = 0.0;
+    for( const auto& segment : run )
+    {
+        long axis1Steps = std::abs( segment.axis1Steps );
+        long axis2Steps = std::abs( segment.axis2Steps );
+        if( axis1Owed && axis1Steps > 0 )
+        {
+            --axis1Steps;
+            axis1Owed = false;
+        }
+        if( axis2Owed && axis2Steps > 0 )
+        {
+            --axis2Steps;
+            axis2Owed = false;
+        }
+        long ticks = std::max( axis1Steps, axis2Steps );
+        if( ticks == 0 ) continue;
+        std::vector<uint32_t> tickTimes;
+        double seconds;
+        if( segment.limits.maxAcceleration > 0.0 )
+        {
+            // The planner works in ticks of the axis with further to go
+            double ticksPerMm = ticks / segment.length;
+            MotionLimits limits{
+                segment.limits.maxVelocity * ticksPerMm,
+                segment.limits.maxAcceleration * ticksPerMm,
+                segment.limits.maxJerk * ticksPerMm
+                };
+            SCurveProfile profile(
+                ticks,
+                segment.entryVelocity * ticksPerMm,
+                segment.exitVelocity * ticksPerMm,
+                limits
+                );
+            tickTimes = profile.stepTimes( ticks );
+            seconds = profile.getDuration();
+        }
+        else
+        {
+            seconds = segment.length / segment.limits.maxVelocity;
+            tickTimes = CoordinatedMove::steadyTickTimes( ticks, seconds );
+        }
+        uint32_t offset = static_cast<uint32_t>( std::llround( runTime * 1'000'000.0 ) );
+        for( auto& time : tickTimes )
+        {
+            time += offset;
+        }
+        runTime += seconds;
+        segments.push_back( { axis1Steps, axis2Steps, std::move( tickTimes ) } );
+    }
+    if( segments.empty() ) return;
+
+    m_coordinatedMove->start( std::move( segments ) );
+    m_coordinatedAxis1Start = axis1Start;
+    m_coordinatedAxis2Start = axis2Start;
+    m_coordinatedAxis1Direction = axis1Direction;
+    m_coordinatedAxis2Direction = axis2Direction;
+    m_coordinatedFollowing = true;
+}
+
+void Model::coordinatedMoveStop()
+{
+    m_motionRuns.clear();
+    m_motionRunStepped = false;
+    if( m_coordinatedMove )
+    {
+        m_coordinatedMove->stop();
+        followCoordinatedMove();
+    }
+}
+
+void Model::followCoordinatedMove()
+{
+    if( ! m_coordinatedFollowing ) return;
+    CoordinatedMove::Progress progress = m_coordinatedMove->getProgress();
+    // The motors didn't see those steps, so we tell them where they are
+    m_axis1Motor->setPosition( m_axis1Motor->getPosition(
+        m_coordinatedAxis1Start + progress.axis1Made * m_coordinatedAxis1Direction ) );
+    m_axis2Motor->setPosition( m_axis2Motor->getPosition(
+        m_coordinatedAxis2Start + progress.axis2Made * m_coordinatedAxis2Direction ) );
+    if( ! progress.running )
+    {
+        m_coordinatedFollowing = false;
+    }
+}
+
 void Model::axis1MoveLeft()
 {
     // Issuing the same command (i.e. pressing the same key)
     // when it is already running will cause the motor to stop
-    if ( m_axis1Motor->isRunning() )
+    if ( axis1IsRunning() )
     {
         axis1Stop();
         return;
@@ -519,7 +1344,7 @@ void Model::axis1MoveRight()
 {
     // Issuing the same command (i.e. pressing the same key)
     // when it is already running will cause the motor to stop
-    if ( m_axis1Motor->isRunning() )
+    if ( axis1IsRunning() )
     {
         axis1Stop();
         return;
@@ -542,18 +1367,23 @@ void Model::axis1SetSpeed(double speed)
 
 void Model::axis1Wait()
 {
-    m_axis1Motor->wait();
+    waitForMotor( *m_axis1Motor );
 }
 
 void Model::axis2Wait()
 {
-    m_axis2Motor->wait();
+    waitForMotor( *m_axis2Motor );
 }
 
 void Model::axis1Stop()
 {
+    m_rotaryEncoder->cancelCallbacks();
+    m_axis1StartPending = false;
+    gearboxDisengage();
+    coordinatedMoveStop();
     m_axis1Motor->stop();
-    m_axis1Motor->wait();
+    waitForMotor( *m_axis1Motor );
+    runWhenStopped( m_axis1WhenStopped, false );
 }
 
 void Model::axis2SetSpeed(double speed)
@@ -563,21 +1393,88 @@ void Model::axis2SetSpeed(double speed)
 
 void Model::axis2Stop()
 {
+    coordinatedMoveStop();
     m_axis2Motor->stop();
-    m_axis2Motor->wait();
+    waitForMotor( *m_axis2Motor );
+    runWhenStopped( m_axis2WhenStopped, false );
 }
 
 void Model::axis2SynchroniseOff()
 {
     m_axis2Motor->synchroniseOff();
+    m_axis2Synchronised = false;
+}
+
+void Model::axis2Retract()
+{
+    if( emergencyStopped() ) return;
+    m_xOldPosition = m_axis2Motor->getCurrentStep();
+    m_previousXSpeed = m_axis2Motor->getSpeed();
+    m_axis2Motor->setSpeed( 100.0 );
+    int direction = -1;
+    if( m_xRetractionDirection == XRetractionDirection::Inwards )
+    {
+        direction = 1;
+    }
+    long stepsForRetraction =
+        2.0 / std::abs( m_axis2Motor->getConversionFactor() );
+    m_axis2Motor->goToStep(
+        m_axis2Motor->getCurrentStep() + stepsForRetraction * direction );
+    m_axis2Retracted = true;
+}
+
+bool Model::reactToSpindleDroop()
+{
+    // This runs on the spindle monitor thread without m_mutex, so (as
+    // with emergencyStop()) we only stop the motors and their threads
+    // here. Everything else, including the retract, is done by
+    // checkStatus() when it sees m_spindleDroopTripped.
+    if( m_droopReaction == DroopReaction::None )
+    {
+        return false;
+    }
+    bool zMoving = m_axis1Motor->isRunning() || m_axis1StartPending ||
+        ( m_gearbox && m_gearbox->isEngaged() ) ||
+        ( m_coordinatedMove && m_coordinatedMove->isRunning() );
+    bool xFollowing = m_axis2Synchronised;
+    if( ! zMoving && ! ( xFollowing && m_axis2Motor->isRunning() ) )
+    {
+        // Not cutting, e.g. the operator has just switched the spindle off
+        return false;
+    }
+    m_rotaryEncoder->cancelCallbacks();
+    if( m_gearbox )
+    {
+        m_gearbox->disengage();
+    }
+    if( m_coordinatedMove )
+    {
+        m_coordinatedMove->stop();
+    }
+    m_axis1Motor->stop();
+    // A hold only stops X if it's moving with Z
+    if( xFollowing || m_droopReaction != DroopReaction::FeedHold )
+    {
+        m_axis2Motor->stop();
+    }
+    m_spindleDroopTripped = true;
+    return true;
 }
 
 void Model::repeatLastRelativeMove()
 {
+    StoppedFunction none;
     if( m_lastRelativeMoveAxis == Axis::Axis1 )
     {
         if( m_axis1LastRelativeMove != 0.0 )
         {
+            long step = std::lround( ( m_axis1Motor->getPosition() + m_axis1LastRelativeMove ) /
+                m_axis1Motor->getConversionFactor() );
+            if( queuedAxisGoToStep( Axis::Axis1, step, none ) )
+            {
+                m_axis1Status = fmt::format( "To offset {}", m_axis1LastRelativeMove );
+                return;
+            }
             axis1GoToOffset( m_axis1LastRelativeMove );
         }
     }
@@ -585,11 +1482,424 @@ void Model::repeatLastRelativeMove()
     {
         if( m_axis2LastRelativeMove != 0.0 )
         {
+            long step = std::lround( ( m_axis2Motor->getPosition() + m_axis2LastRelativeMove ) /
+                m_axis2Motor->getConversionFactor() );
+            if( queuedAxisGoToStep( Axis::Axis2, step, none ) )
+            {
+                m_axis2Status = fmt::format( "To offset {}", m_axis2LastRelativeMove );
+                return;
+            }
             axis2GoToOffset( m_axis2LastRelativeMove );
         }
     }
 }
 
+void Model::threadingNextStart()
+{
+    m_threadStart = ( m_threadStart + 1 ) % m_threadStarts;
+    m_generalStatus = fmt::format( "Thread start {} of {}", m_threadStart + 1, m_threadStarts );
+}
+
+double Model::threadStartAngle() const
+{
+    return 360.0 * m_threadStart / m_threadStarts;
+}
+
+void Model::threadingGearboxRatio( int64_t& numerator, int64_t& divisor ) const
+{
+    // Steps per count = lead / mm per step / counts per spindle rev.
+    // Pitches are taken to the nearest nanometre and the conversion
+    // factor to 1/1000 of its configured terms, which is exact for
+    // everything in the pitch table and any sensible config.
+    auto multiply = [ &numerator, &divisor ]( int64_t n, int64_t d )
+        {
+            // Cancel as we go, to keep the numbers small
+            int64_t g = std::gcd( n, d );
+            n /= g;
+            d /= g;
+            int64_t a = std::gcd( numerator, d );
+            int64_t b = std::gcd( n, divisor );
+            numerator = ( numerator / a ) * ( n / b );
+            divisor   = ( divisor / b ) * ( d / a );
+        };
+    numerator = std::llround( threadPitches.at( m_threadPitchIndex ).pitchMm * 1'000'000.0 )
+        * m_threadStarts;
+    divisor = 1'000'000;
+    int64_t g = std::gcd( numerator, divisor );
+    numerator /= g;
+    divisor /= g;
+    multiply(
+        std::llround( m_config.readDouble( "Axis1ConversionDivisor", 1'000.0 ) * 1'000.0 ),
+        std::llround( std::abs( m_config.readDouble( "Axis1ConversionNumerator", -1.0 ) ) * 1'000.0 )
+        );
+    multiply(
+        m_rotaryEncoder->getCountsPerRevDivisor(),
+        m_rotaryEncoder->getCountsPerRevNumerator()
+        );
+}
+
+void Model::axis1GearboxGoToStep( long step )
+{
+    // Rather than setting the motor's speed from the rpm and hoping, the
+    // carriage is driven straight from the encoder counts, so the pitch
+    // is exact whatever the spindle does
+    gearboxDisengage();
+    long current = m_axis1Motor->getCurrentStep();
+    if( step == current ) return;
+    int direction = step > current ? 1 : -1;
+    // One step the right way under the motor's own control takes up any
+    // backlash and sets its direction pin, which the gearbox leaves alone.
+    // We don't wait for it: checkStatus() engages the gearbox once it's
+    // made it. Until then, the start is pending, and whatever cancels
+    // that cancels this too.
+    m_axis1Motor->goToStep( current + direction );
+    m_gearboxTargetStep = step;
+    m_gearboxEngagePending = true;
+    m_axis1StartPending = true;
+}
+
+void Model::gearboxEngage()
+{
+    m_gearboxEngagePending = false;
+    m_axis1StartPending = false;
+    if( emergencyStopped() ) return;
+    long step = m_gearboxTargetStep;
+    long startStep = m_axis1Motor->getCurrentStep();
+    int direction = step > startStep ? 1 : -1;
+    // INF_LEFT / INF_RIGHT are the extremes of an int, so take care
+    long steps = static_cast<long>( std::min<int64_t>(
+        std::abs( static_cast<int64_t>( step ) - startStep ),
+        std::numeric_limits<long>::max() ) );
+    if( steps == 0 ) return;
+    int64_t startCount = 0;
+    if( ! m_rotaryEncoder->nextCountAtDegrees( threadStartAngle(), 2'000, startCount ) )
+    {
+        m_warning = "Spindle not turning";
+        return;
+    }
+    int64_t numerator;
+    int64_t divisor;
+    threadingGearboxRatio( numerator, divisor );
+    m_gearbox->setRatio( numerator, divisor );
+    m_gearbox->engage( startCount, steps, startStep, direction, m_axis1PitchCorrection );
+    m_gearboxStartStep = startStep;
+    m_gearboxDirection = direction;
+    m_gearboxFollowing = true;
+}
+
+void Model::gearboxDisengage()
+{
+    if( m_gearbox )
+    {
+        m_gearbox->disengage();
+        followGearbox();
+    }
+}
+
+void Model::followGearbox()
+{
+    if( ! m_gearboxFollowing ) return;
+    ElectronicGearbox::Progress progress = m_gearbox->getProgress();
+    // The motor doesn't see the gearbox's steps, so we tell it where it
+    // has got to. Here rather than on the gearbox thread, as everything
+    // else that moves the motor does so with m_mutex held.
+    m_axis1Motor->setPosition( m_axis1Motor->getPosition(
+        m_gearboxStartStep + progress.stepsMade * m_gearboxDirection ) );
+    if( ! progress.engaged )
+    {
+        m_axis1PitchCorrection = progress.correction;
+        m_gearboxFollowing = false;
+    }
+}
+
+PitchCompensation Model::loadPitchCompensation( const std::string& axis )
+{
+    std::string filename = m_config.read( axis + "PitchCompensationFile", "" );
+    if( filename.empty() ) return PitchCompensation();
+    try
+    {
+        return PitchCompensation( readPitchCompensationFile( filename ) );
+    }
+    catch( const std::exception& e )
+    {
+        MGOLOG( e.what() );
+        m_warning = e.what();
+        return PitchCompensation();
+    }
+}
+
+bool Model::pitchCompensationTopUp(
+    StepperMotor&            motor,
+    const PitchCompensation& table,
+    long&                    correction
+    )
+{
+    if( table.empty() ) return false;
+    long current = motor.getCurrentStep();
+    long wanted = table.stepsAt( motor.getPosition( current ) );
+    int direction = motor.getDirection() == Direction::forward ? 1 : -1;
+    // Going back would mean taking up the backlash, so that waits until
+    // it next stops having gone the other way
+    long steps = ( wanted - correction ) * direction;
+    if( steps <= 0 ) return false;
+    // It isn't really anywhere else, so we tell it it's that many steps
+    // short and send it back to where it was. That way there's nothing to
+    // put right afterwards, and we needn't wait for it. If it's stopped
+    // on the way, it's still right about where it is, and the rest is
+    // made up next time.
+    motor.setPosition( motor.getPosition( current - steps * direction ) );
+    motor.goToStep( current );
+    correction = wanted;
+    return true;
+}
+
+bool Model::xFollowsZ() const
+{
+    return m_enabledFunction == Mode::Taper || m_enabledFunction == Mode::Radius ||
+        m_enabledFunction == Mode::Profile;
+}
+
+bool Model::axesLinked() const
+{
+    // Not just "any function on": changeMode() sets m_enabledFunction for
+    // the go to modes themselves, so that would turn every Z,X off
+    return xFollowsZ() || m_enabledFunction == Mode::Threading;
+}
+
+bool Model::axis1IsRunning() const
+{
+    return m_axis1Motor->isRunning() || m_axis1StartPending ||
+        ( m_gearbox && m_gearbox->isEngaged() ) ||
+        ( m_coordinatedMove && m_coordinatedMove->isRunning() ) ||
+        ! m_motionRuns.empty();
+}
+
+bool Model::axis2IsRunning() const
+{
+    return m_axis2Motor->isRunning() ||
+        ( m_coordinatedMove && m_coordinatedMove->isRunning() ) ||
+        ! m_motionRuns.empty();
+}
+
+float Model::threadingZSpeed() const
+{
+    // Because my stepper motor / leadscrew does one mm per
+    // revolution, there is a direct correlation between spindle
+    // rpm and stepper motor rpm for a 1mm thread pitch.
+    // For a multi-start thread, the carriage has to move by the
+    // lead (i.e. pitch x starts) per revolution.
+    float pitch = threadPitches.at( m_threadPitchIndex ).pitchMm;
+    return pitch * m_threadStarts * m_rotaryEncoder->getRpm();
+}
+
+void Model::threadingCycleStart()
+{
+    if( emergencyStopped() ) return;
+    if( m_enabledFunction != Mode::Threading ) return;
+    if( m_threadingStage != ThreadingCycleStage::Idle ) return;
+    if( axis1IsRunning() || m_axis2Motor->isRunning() ) return;
+    long zEnd = m_axis1Memory.at( m_currentMemory );
+    if( zEnd == INF_RIGHT || zEnd == m_axis1Motor->getCurrentStep() )
+    {
+        m_threadingStatus = "Memorise the end of the thread first";
+        return;
+    }
+    // The retraction direction tells us whether it's an inside thread
+    bool male = m_xRetractionDirection == XRetractionDirection::Outwards;
+    const ThreadPitch& tp = threadPitches.at( m_threadPitchIndex );
+    m_threadingPasses = planThreadingPasses(
+        male ? tp.cutDepthMale : tp.cutDepthFemale,
+        INFEED,
+        SIDEFEED,
+        m_config.readLong( "ThreadingSpringPasses", 2 )
+        );
+    if( m_threadingPasses.empty() ) return;
+    m_threadingPass = 0;
+    m_threadingPaused = false;
+    m_threadingPhaseErrors.clear();
+    m_threadingZStart = m_axis1Motor->getCurrentStep();
+    m_threadingZEnd = zEnd;
+    m_threadingXStart = m_axis2Motor->getCurrentStep();
+    // Retracting outwards is a negative step (see axis2Retract)
+    m_threadingInfeedDirection = male ? 1 : -1;
+    m_threadingPreviousXSpeed = m_axis2Motor->getSpeed();
+    MGOLOG( "Threading cycle: " << tp.name << ", " << m_threadingPasses.size()
+        << " passes" );
+    // Start by backing off, so every pass starts the same way
+    m_axis2Motor->setSpeed( 100.0 );
+    m_axis2Motor->goToStep( m_threadingXStart - m_threadingInfeedDirection *
+        std::lround( 2.0 / std::abs( m_axis2Motor->getConversionFactor() ) ) );
+    m_threadingStage = ThreadingCycleStage::Retract;
+}
+
+void Model::threadingCyclePause()
+{
+    if( m_threadingStage == ThreadingCycleStage::Idle ) return;
+    m_threadingPaused = ! m_threadingPaused;
+    if( m_threadingPaused )
+    {
+        m_threadingStatus = fmt::format( "Pausing after pass {}", m_threadingPass + 1 );
+    }
+}
+
+void Model::threadingCycleStep()
+{
+    if( emergencyStopped() ) return;
+    if( m_threadingStarted && m_threadingStage == ThreadingCycleStage::Cutting )
+    {
+        sampleThreadingStart();
+    }
+    if( axis1IsRunning() || m_axis2Motor->isRunning() ) return;
+    double xStepsPerMm = 1.0 / std::abs( m_axis2Motor->getConversionFactor() );
+    double zStepsPerMm = 1.0 / std::abs( m_axis1Motor->getConversionFactor() );
+    int zDirection = m_threadingZEnd > m_threadingZStart ? 1 : -1;
+    switch( m_threadingStage )
+    {
+        case ThreadingCycleStage::Idle:
+            break;
+        case ThreadingCycleStage::Retract:
+        {
+            m_axis1Motor->enableRamping( true );
+            m_axis1Motor->setSpeed( m_config.readDouble( "Axis1SpeedPreset4", 250.0 ) );
+            if( m_threadingPass >= m_threadingPasses.size() )
+            {
+                m_axis1Motor->goToStep( m_threadingZStart );
+                m_threadingStage = ThreadingCycleStage::Returning;
+                break;
+            }
+            if( m_threadingPaused )
+            {
+                m_threadingStatus = fmt::format(
+                    "Paused before pass {} of {}, C to carry on",
+                    m_threadingPass + 1, m_threadingPasses.size() );
+                break;
+            }
+            const ThreadingPass& pass = m_threadingPasses.at( m_threadingPass );
+            m_threadingStatus = fmt::format(
+                "{} {} of {}, depth {:.3f} mm",
+                pass.spring ? "Spring pass" : "Pass",
+                m_threadingPass + 1, m_threadingPasses.size(), pass.depth );
+            // The sidefeed goes the way we cut, so the tool follows
+            // the leading flank in
+            m_axis1Motor->goToStep( m_threadingZStart +
+                zDirection * std::lround( pass.sidefeed * zStepsPerMm ) );
+            m_threadingStage = ThreadingCycleStage::ToStart;
+            break;
+        }
+        case ThreadingCycleStage::ToStart:
+        {
+            const ThreadingPass& pass = m_threadingPasses.at( m_threadingPass );
+            m_axis2Motor->setSpeed( 100.0 );
+            m_axis2Motor->goToStep( m_threadingXStart +
+                m_threadingInfeedDirection * std::lround( pass.depth * xStepsPerMm ) );
+            m_threadingStage = ThreadingCycleStage::Infeed;
+            break;
+        }
+        case ThreadingCycleStage::Infeed:
+            // No ramping while threading (see changeMode)
+            m_axis1Motor->enableRamping( false );
+            m_axis1Motor->setSpeed( threadingZSpeed() );
+            m_threadingStarted = false;
+            m_threadingStartError = std::numeric_limits<double>::quiet_NaN();
+            m_threadingStage = ThreadingCycleStage::Cutting;
+            axis1GoToStep( m_threadingZEnd );
+            break;
+        case ThreadingCycleStage::Cutting:
+        {
+            if( m_axis1Motor->getCurrentStep() != m_threadingZEnd )
+            {
+                threadingCycleAbort( "pass didn't finish" );
+                break;
+            }
+            // How far round the spindle was from where it should have
+            // been when the carriage started
+            double error;
+            if( m_gearbox )
+            {
+                error = m_gearbox->getLastStartErrorCounts() * 360.0 *
+                    m_rotaryEncoder->getCountsPerRevDivisor() /
+                    m_rotaryEncoder->getCountsPerRevNumerator();
+            }
+            else
+            {
+                error = m_threadingStartError;
+            }
+            m_threadingPhaseErrors.push_back( error );
+            ++m_threadingPass;
+            m_axis2Motor->setSpeed( 100.0 );
+            m_axis2Motor->goToStep( m_threadingXStart -
+                m_threadingInfeedDirection * std::lround( 2.0 * xStepsPerMm ) );
+            m_threadingStage = ThreadingCycleStage::Retract;
+            break;
+        }
+        case ThreadingCycleStage::Returning:
+        {
+            m_axis1Motor->enableRamping( false );
+            m_axis2Motor->setSpeed( m_threadingPreviousXSpeed );
+            double worst = 0.0;
+            double lowest = std::numeric_limits<double>::infinity();
+            double highest = - lowest;
+            for( std::size_t n = 0; n < m_threadingPhaseErrors.size(); ++n )
+            {
+                double error = m_threadingPhaseErrors[ n ];
+                if( std::isnan( error ) )
+                {
+                    // The spindle couldn't be placed when the pass started
+                    MGOLOG( "Threading pass " << n + 1 << ": depth "
+                        << m_threadingPasses.at( n ).depth << " mm, phase error unknown" );
+                    continue;
+                }
+                MGOLOG( "Threading pass " << n + 1 << ": depth "
+                    << m_threadingPasses.at( n ).depth << " mm, phase error "
+                    << error << " degrees" );
+                worst = std::max( worst, std::abs( error ) );
+                lowest = std::min( lowest, error );
+                highest = std::max( highest, error );
+            }
+            if( lowest > highest )
+            {
+                lowest = highest = 0.0;
+            }
+            // The spread is what matters: if every pass is out by the
+            // same amount, they are all in the same groove
+            m_threadingStatus = fmt::format(
+                "Thread done, {} passes. Phase error max {:.2f}°, spread {:.2f}°",
+                m_threadingPhaseErrors.size(), worst, highest - lowest );
+            m_threadingStage = ThreadingCycleStage::Idle;
+            break;
+        }
+    }
+}
+
+void Model::sampleThreadingStart()
+{
+    // The scheduler starts the motor the advance ahead of the start
+    // angle, to allow for it getting going, so that's when the carriage
+    // really starts. We wait until then, so the tracker has edges on
+    // both sides rather than guessing ahead.
+    uint32_t startTick = m_threadingStartTick + static_cast<uint32_t>(
+        m_rotaryEncoder->getAdvanceValueMicroseconds() );
+    if( static_cast<int32_t>( m_gpio.getTick() - startTick ) < 0 ) return;
+    m_threadingStarted = false;
+    SpindleState state = m_rotaryEncoder->getSpindleStateAt( startTick );
+    if( ! state.valid ) return;
+    // How far past the start angle the spindle had got (negative if it
+    // hadn't got there yet), one way or the other round
+    double error = std::fmod( state.angleDegrees - threadStartAngle(), 360.0 );
+    if( error >= 180.0 ) error -= 360.0;
+    if( error < -180.0 ) error += 360.0;
+    m_threadingStartError = error;
+}
+
+void Model::threadingCycleAbort( const std::string& reason )
+{
+    MGOLOG( "Threading cycle stopped at pass " << m_threadingPass + 1 << ": " << reason );
+    m_threadingStatus = fmt::format( "Threading stopped at pass {}: {}",
+        m_threadingPass + 1, reason );
+    m_threadingStage = ThreadingCycleStage::Idle;
+    m_axis1Motor->enableRamping( false );
+}
+
 void Model::acceptInputValue()
 {
     double inputValue = 0.0;
@@ -627,7 +1937,12 @@ void Model::acceptInputValue()
         }
         case Mode::Axis1GoTo:
         {
-            if( valid )
+            std::vector<std::pair<double, double>> points;
+            if( parsePoints( m_input, points ) )
+            {
+                goToPositionsCoordinated( points );
+            }
+            else if( valid )
             {
                 axis1GoToPosition( inputValue );
             }
@@ -635,7 +1950,12 @@ void Model::acceptInputValue()
         }
         case Mode::Axis2GoTo:
         {
-            if( valid )
+            std::vector<std::pair<double, double>> points;
+            if( parsePoints( m_input, points ) )
+            {
+                goToPositionsCoordinated( points );
+            }
+            else if( valid )
             {
                 axis2GoToPosition( inputValue );
             }
@@ -665,9 +1985,61 @@ void Model::acceptInputValue()
         case Mode::Radius:
         {
             m_radius = inputValue;
+            // The tool is on the apex now
+            m_radiusZOrigin = m_axis1Motor->getPosition();
+            m_radiusXOrigin = m_axis2Motor->getPosition();
+            break;
+        }
+        case Mode::Profile:
+        {
+            // The tool is on the first point now
+            m_formProfileZOrigin = m_axis1Motor->getPosition();
+            m_formProfileXOrigin = m_axis2Motor->getPosition();
+            break;
+        }
+        case Mode::Threading:
+        {
+            // The input here is the number of starts
+            if( valid && inputValue >= 1.0 && inputValue <= 12.0 )
+            {
+                m_threadStarts = static_cast<int>( inputValue );
+                m_threadStart = 0;
+            }
+            break;
+        }
+        case Mode::MisalignmentSetup:
+        {
+            // Either the angle itself, or "chuck end diameter, tail end
+            // diameter, distance between them" measured on a test cut
+            std::vector<double> numbers;
+            std::istringstream iss( m_input );
+            std::string number;
+            try
+            {
+                while( std::getline( iss, number, ',' ) )
+                {
+                    numbers.push_back( std::stod( number ) );
+                }
+                if( numbers.size() == 1 )
+                {
+                    m_misalignmentCorrection = numbers[ 0 ];
+                }
+                else if( numbers.size() == 3 )
+                {
+                    m_misalignmentCorrection += misalignmentCorrectionAngle(
+                        numbers[ 0 ], numbers[ 1 ], numbers[ 2 ] );
+                }
+            }
+            catch( const std::runtime_error& e )
+            {
+                m_warning = e.what();
+            }
+            catch( ... ) {}
             break;
         }
         case Mode::Axis2RetractSetup:
+        case Mode::Help:
+        case Mode::Setup:
             // no processing required for these modes
             break;
         default:
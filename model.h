@@ -1,13 +1,29 @@
 #pragma once
 
 #include "configreader.h"
+#include "coordinatedmove.h"
+#include "electronicgearbox.h"
+#include "formprofile.h"
+#include "motionplanner.h"
+#include "motionqueue.h"
+#include "pitchcompensation.h"
+#include "prioritymutex.h"
+#include "radiusprofile.h"
 #include "rotaryencoder.h"
+#include "spindlemonitor.h"
 #include "stepperControl/steppermotor.h"
+#include "threadingcycle.h"
 
+#include <atomic>
 #include <cmath>
+#include <deque>
+#include <functional>
+#include <future>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <stack>
+#include <utility>
 #include <vector>
 
 // "Model", i.e. program state data
@@ -45,7 +61,9 @@ enum class Mode
     Axis2GoTo,
     Axis1GoToOffset,
     Axis2GoToOffset,
-    Radius
+    Radius,
+    Profile,
+    MisalignmentSetup
 };
 
 // "Key Modes" allow for two-key actions, a bit like vim.
@@ -80,6 +98,28 @@ enum class Axis
     Axis2
 };
 
+// What to do if the spindle suddenly slows down mid-cut
+enum class DroopReaction
+{
+    None,
+    FeedHold,   // stop the carriage (and any X motion tied to it)
+    RetractX,   // as above, then pull the tool out
+    StopAll     // stop both axes
+};
+
+// Where the automatic threading cycle has got to. Each pass goes
+// Retract -> ToStart -> Infeed -> Cutting, and once all are done the
+// carriage goes back to where it started.
+enum class ThreadingCycleStage
+{
+    Idle,
+    Retract,    // X out clear of the work
+    ToStart,    // Z to the start, offset by this pass's sidefeed
+    Infeed,     // X in to this pass's depth
+    Cutting,    // Z along the thread, in step with the spindle
+    Returning   // Z back to the start after the last pass
+};
+
 class Model
 {
 public:
@@ -89,25 +129,138 @@ public:
 
     void initialise();
 
-    // This should be repeatedly called from the run loop
+    // Held by whoever is using the model: the control thread while it
+    // checks the status, and the UI while it handles a key or takes what
+    // it needs for the display. The control thread is realtime, so this
+    // passes its priority on to whoever has the lock when it wants it.
+    // Nothing that waits for a motor should be done with it held.
+    mutable PriorityMutex m_mutex;
+
+    // This is called repeatedly from the control thread (see
+    // controlthread.h), with m_mutex held
     void checkStatus();
+    // The part of checkStatus() which acts on an axis having stopped,
+    // and starts whatever comes next
+    void checkAxes();
+    // Called by checkStatus() when something on the display has changed
+    // by itself (an axis has stopped, say), so the display needn't wait
+    // for its next refresh. Positions and the rpm, which change all the
+    // time, aren't included.
+    std::function<void()> m_onChanged;
+    // Called by waitForMotor() when a key is about to wait for a motor
+    // which is still going, so the key's timing can leave the wait out
+    std::function<void()> m_onMotorWait;
+    // Whether the spindle or either axis is moving, as of the last
+    // checkStatus(). If not, the display only needs drawing on a change.
+    std::atomic<bool> m_moving{ false };
     void changeMode( Mode mode );
-    void stopAllMotors();
+    // Stops everything, and forgets what it was going to do next. The
+    // control thread doesn't wait for the motors to come to a halt; it
+    // sees them stop on a later tick.
+    void stopAllMotors( bool waitForMotors = true );
+    // Stops everything now, from any thread, without m_mutex - so it
+    // doesn't wait for whatever the model is in the middle of. Only the
+    // motors and their step threads are touched here; the rest is
+    // tidied up by the next checkStatus(). Nothing can be started until
+    // emergencyStopHandled().
+    void emergencyStop();
+    // Any thread. Whether there's been a stop key which hasn't yet been
+    // handled, in which case nothing is started.
+    bool emergencyStopped() const
+    {
+        return m_emergencyStops != m_emergencyStopsCleared;
+    }
+    // With m_mutex held. Lets things start again after the stop key, once
+    // checkStatus() has tidied up after it. The controller calls this once
+    // nothing it was doing when the key came in is still going (it may
+    // have been waiting for a motor, with the model unlocked, and would
+    // otherwise carry on afterwards).
+    void emergencyStopHandled();
+    // Waits for the motor to stop. If this thread has the model locked
+    // (a key being handled, say), it's unlocked meanwhile, so the display
+    // and the control thread aren't held up by it.
+    void waitForMotor( StepperMotor& motor );
     void takeUpZBacklash( ZDirection direction );
     void startSynchronisedXMotorForTaper(  ZDirection direction );
     void startSynchronisedXMotorForRadius( ZDirection direction );
+    void startSynchronisedXMotorForProfile( ZDirection direction );
+    // With no function tying X to Z, X still follows it by the lathe
+    // misalignment correction (if there is one)
+    void startSynchronisedXMotorForMisalignment( ZDirection direction );
+    // Taper, radius and form profile modes move X as Z moves
+    bool xFollowsZ() const;
+    // Whether the mode we're in already ties the axes together, so a
+    // two-axis move has to be made as two separate ones
+    bool axesLinked() const;
+    // Reads the profile named in the config, leaving a description
+    // (or what was wrong with it) in m_formProfileStatus
+    void loadFormProfile();
 
-    void axis1GoToStep( long step );
-    void axis1GoToPosition( double pos );
-    void axis1GoToOffset( double pos );
-    void axis1GoToPreviousPosition();
+    // Called once an axis has stopped. "completed" is false if it was
+    // stopped on the way (by axis1Stop(), the stop key, the spindle and
+    // so on), when anything more than tidying up - starting another
+    // move, say - shouldn't be done. Runs with m_mutex held, on the
+    // control thread when it finds the axis has got there, or on
+    // whichever thread stopped it.
+    using StoppedFunction = std::function<void( bool completed )>;
+    // Whether nothing can be started because of the stop key, in which
+    // case whenStopped (if any) is told the move didn't get there
+    bool startBlocked( StoppedFunction& whenStopped );
+    // For a move started some other way, given straight after starting it
+    void axis1WhenStopped( StoppedFunction whenStopped );
+    void axis2WhenStopped( StoppedFunction whenStopped );
+    // Calls, and forgets, those waiting
+    void runWhenStopped( std::vector<StoppedFunction>& functions, bool completed );
+
+    // The moves return straight away; whenStopped, if given, is called
+    // when they're done (including straight away if there's nowhere to
+    // go)
+    void axis1GoToStep( long step, StoppedFunction whenStopped = {} );
+    void axis1GoToPosition( double pos, StoppedFunction whenStopped = {} );
+    void axis1GoToOffset( double pos, StoppedFunction whenStopped = {} );
+    void axis1GoToPreviousPosition( StoppedFunction whenStopped = {} );
     void axis1CheckForSynchronisation( ZDirection direction );
     void axis1CheckForSynchronisation( long step );
-    void axis1GoToCurrentMemory();
+    void axis1GoToCurrentMemory( StoppedFunction whenStopped = {} );
     void axis1Nudge( long nudgeAmount );
 
-    void axis2GoToPosition( double pos );
-    void axis2GoToOffset( double pos );
+    void axis2GoToStep( long step, StoppedFunction whenStopped = {} );
+    void axis2GoToPosition( double pos, StoppedFunction whenStopped = {} );
+    void axis2GoToOffset( double pos, StoppedFunction whenStopped = {} );
+    // Moves both axes in a straight line, finishing together, with the
+    // Z speed setting as the feed rate along the line. Without S-curve
+    // limits for both axes, it goes at that rate all the way.
+    void goToPositionCoordinated( double axis1Pos, double axis2Pos );
+    // Adds a point to go to after the ones before it. Nothing moves until
+    // runQueuedMoves(), which goes through them all, blending the corners
+    // rather than stopping at each.
+    void queuePositionCoordinated( double axis1Pos, double axis2Pos );
+    // Queues them all and runs them
+    void goToPositionsCoordinated( const std::vector<std::pair<double, double>>& points );
+    void runQueuedMoves();
+    // A fast Z move planned with an S-curve (see motionplanner.h) to
+    // the configured acceleration and jerk. Returns false, having done
+    // nothing, if those aren't configured or a function is enabled.
+    bool axis1RapidToStep( long step );
+    // Moves both axes to the given steps together, at the given feed rate
+    // (mm/min along the line), with an S-curve if limits are configured
+    void moveCoordinated( long axis1Target, long axis2Target, double feed );
+    // Moves one axis to the given step through the motion queue, so it
+    // follows an S-curve like the moves above. Returns false, having done
+    // nothing, if a function ties the axes together, the other axis is
+    // busy, or this one has no S-curve limits (its own ramping is better
+    // than a steady rate then).
+    bool queuedAxisGoToStep( Axis axis, long step, StoppedFunction& whenStopped );
+    // Limits along a line which moves the axes these distances (mm)
+    MotionLimits coordinatedLimits( double axis1Mm, double axis2Mm, double feed );
+    // Whether the axis ("Axis1" or "Axis2") has both an acceleration and
+    // a jerk limit, so a move planned for it can follow an S-curve
+    bool sCurveConfigured( const std::string& axis );
+    // Starts the next run of queued moves, once the last has finished.
+    // This takes two calls: the first has the motors make a step of
+    // their own, and the second (once they have) starts the run.
+    void startNextMotionRun();
+    void coordinatedMoveStop();
 
     void axis1MoveLeft();
     void axis1MoveRight();
@@ -119,9 +272,71 @@ public:
     void axis2Wait();
     void axis2Stop();
     void axis2SynchroniseOff();
+    // Moves X 2mm away from the work in the configured direction,
+    // remembering where to come back to
+    void axis2Retract();
+
+    // Called from the spindle monitor thread, without m_mutex, when the
+    // spindle slows sharply. Only stops the motors; checkStatus() does
+    // the rest. Returns false if nothing was moving.
+    bool reactToSpindleDroop();
 
     void repeatLastRelativeMove();
 
+    // For multi-start threads, each start begins 360/N degrees
+    // round from the previous one
+    void   threadingNextStart();
+    double threadStartAngle() const;
+    // Leadscrew steps per encoder count for the current thread, exactly
+    // numerator / divisor
+    void threadingGearboxRatio( int64_t& numerator, int64_t& divisor ) const;
+    // Cuts a thread to the given step using the electronic gearbox,
+    // starting at the current start angle. The motor first makes a step
+    // of its own, and the gearbox is engaged once it has (by checkStatus(),
+    // calling gearboxEngage()).
+    void axis1GearboxGoToStep( long step );
+    void gearboxEngage();
+    // Disengages the gearbox (if there is one) and brings the motor up
+    // to date with where it got to
+    void gearboxDisengage();
+    // Tells the Z motor about the steps the gearbox has made so far and,
+    // once it has finished, takes its pitch correction. From checkStatus()
+    // and wherever the gearbox is disengaged, with m_mutex held.
+    void followGearbox();
+    // As followGearbox(), for the steps a coordinated move has made
+    void followCoordinatedMove();
+    // Reads the axis' pitch compensation table, if it has one
+    PitchCompensation loadPitchCompensation( const std::string& axis );
+    // After the motor has moved under its own control, makes up the pitch
+    // correction at where it stopped, if it can without turning round.
+    // Returns true if it has started the motor to do so.
+    bool pitchCompensationTopUp(
+        StepperMotor&            motor,
+        const PitchCompensation& table,
+        long&                    correction
+        );
+    // Whether the leadscrew is moving, under its own steam or the gearbox's,
+    // or is waiting for the spindle to come round to start a thread
+    bool axis1IsRunning() const;
+    // Likewise X, on its own or in a coordinated move
+    bool axis2IsRunning() const;
+    // The carriage speed which gives the current thread at the current rpm
+    float threadingZSpeed() const;
+
+    // Cuts the whole thread, pass by pass, from where the tool is now (just
+    // touching the work) to the current Z memory. Pausing takes effect
+    // once the pass under way has finished and X has retracted.
+    void threadingCycleStart();
+    void threadingCyclePause();
+    // Moves the cycle on to its next stage once everything has stopped.
+    // Called from checkStatus().
+    void threadingCycleStep();
+    void threadingCycleAbort( const std::string& reason );
+    // Without the gearbox: where the spindle was, relative to the start
+    // angle, when the carriage started cutting. Called from
+    // threadingCycleStep() once a start has been made.
+    void sampleThreadingStart();
+
     // This is called when the user presses ENTER when
     // inputting a mode parameter (e.g. taper angle)
     void acceptInputValue();
@@ -137,22 +352,51 @@ public:
     std::vector<long> m_axis2Memory{ INF_RIGHT, INF_RIGHT, INF_RIGHT, INF_RIGHT };
     std::size_t m_currentMemory{ 0 };
     std::size_t m_threadPitchIndex{ 0 };
+    int         m_threadStarts{ 1 };
+    int         m_threadStart{ 0 }; // the one being cut, zero-based
     std::string m_generalStatus{ "Press F1 for help" };
     std::string m_axis1Status{ "stopped" };
     std::string m_axis2Status{ "stopped" };
     std::string m_warning;
     std::string m_input; // general-purpose string for user-entered data
-    bool        m_quit{ false };
-    bool        m_shutdown{ false };
-    float       m_previousZSpeed{ 40.f };
+    std::atomic<bool> m_quit{ false };
+    std::atomic<bool> m_shutdown{ false };
+    // Until they get there, when the speed is put back
     bool        m_axis1FastReturning{ false };
     bool        m_axis2FastReturning{ false };
-    int         m_keyPressed{ 0 };
     double      m_taperAngle{ 0.0 };
-    double      m_radius{ 0.0 };
+    // Degrees, as a taper angle, applied to every Z move on top of
+    // whatever else is going on
+    double      m_misalignmentCorrection{ 0.0 };
+    PitchCompensation m_axis1PitchCompensation;
+    PitchCompensation m_axis2PitchCompensation;
+    // The steps each motor has had, beyond those it has counted, for
+    // pitch compensation
+    long        m_axis1PitchCorrection{ 0 };
+    // Where the gearbox started from, and which way it's going, while
+    // its steps still need passing on to the motor
+    bool        m_gearboxFollowing{ false };
+    // Set while the motor makes the step before the gearbox takes over
+    // (see axis1GearboxGoToStep()), with where the gearbox is to go
+    bool        m_gearboxEngagePending{ false };
+    long        m_gearboxTargetStep{ 0 };
+    long        m_gearboxStartStep{ 0 };
+    int         m_gearboxDirection{ 1 };
+    long        m_axis2PitchCorrection{ 0 };
+    double      m_radius{ 0.0 }; // negative for concave
+    // Where the apex of the radius is
+    double      m_radiusZOrigin{ 0.0 };
+    double      m_radiusXOrigin{ 0.0 };
+    RadiusProfile m_radiusProfile;
+    FormProfile m_formProfile;
+    std::string m_formProfileStatus;
+    // Where the first point of the profile is
+    double      m_formProfileZOrigin{ 0.0 };
+    double      m_formProfileXOrigin{ 0.0 };
     float       m_taperPreviousXSpeed{ 40.f };
-    // Stores the current function displayed on the screen:
-    Mode        m_currentDisplayMode{ Mode::None };
+    // Stores the current function displayed on the screen. The UI
+    // reads this without m_mutex, to decide what a key means.
+    std::atomic<Mode> m_currentDisplayMode{ Mode::None };
     // Stores current function, i.e. whether tapering or threading is on
     // we use the same enum class as "mode"
     Mode        m_enabledFunction{ Mode::None };
@@ -161,23 +405,107 @@ public:
     // Used to store position to return to after retract:
     long        m_xOldPosition;
     bool        m_axis2Retracted{ false };
+    // Set when the spindle slows with the retract reaction; X is
+    // retracted once it has stopped
+    bool        m_axis2RetractPending{ false };
     float       m_previousXSpeed{ 40.f };
-    bool        m_fastRetracting{ false };
 
     bool        m_zWasRunning{ false };
     bool        m_xWasRunning{ false };
     bool        m_spindleWasRunning{ false };
+    DroopReaction m_droopReaction{ DroopReaction::None };
+    // Set by the monitor thread, picked up by checkStatus()
+    std::atomic<bool> m_spindleDroopTripped{ false };
+    // Counts of the stop key: pressed (by emergencyStop()), tidied up
+    // after (by checkStatus()) and finished with (emergencyStopHandled())
+    std::atomic<uint32_t> m_emergencyStops{ 0 };
+    uint32_t    m_emergencyStopsTidied{ 0 };
+    std::atomic<uint32_t> m_emergencyStopsCleared{ 0 };
+    // Set while a key is waiting for a motor with the model unlocked (see
+    // waitForMotor()). checkStatus() leaves the axes to it meanwhile.
+    bool        m_waitingForMotor{ false };
+    bool        m_spindleDroopWarning{ false };
+    // As for the droop warning, this one stays up until the operator
+    // next moves Z, or it would be cleared on the next tick in threading
+    bool        m_threadStartWarning{ false };
+    // Whether X is synchronised to Z, so the spindle monitor thread can
+    // tell without looking at the mode
+    std::atomic<bool> m_axis2Synchronised{ false };
+    // Set while a threading start waits for the spindle (without the gearbox)
+    std::atomic<bool> m_axis1StartPending{ false };
+    // ...and whether the scheduler ran that start, or gave up on it
+    std::future<bool> m_axis1Start;
+
+    ThreadingCycleStage        m_threadingStage{ ThreadingCycleStage::Idle };
+    std::vector<ThreadingPass> m_threadingPasses;
+    std::size_t m_threadingPass{ 0 };
+    bool        m_threadingPaused{ false };
+    long        m_threadingZStart{ 0 };
+    long        m_threadingZEnd{ 0 };
+    long        m_threadingXStart{ 0 };
+    int         m_threadingInfeedDirection{ 1 };
+    float       m_threadingPreviousXSpeed{ 40.f };
+    // How far round from the start angle each pass began, in degrees
+    // (NaN if it couldn't be told)
+    std::vector<double> m_threadingPhaseErrors;
+    // Set by the scheduler thread when it starts a cut without the
+    // gearbox, for sampleThreadingStart()
+    std::atomic<uint32_t> m_threadingStartTick{ 0 };
+    std::atomic<bool>     m_threadingStarted{ false };
+    double      m_threadingStartError{ 0.0 };
+    // Shown instead of the usual status while the cycle runs, and
+    // afterwards until something else moves
+    std::string m_threadingStatus;
 
     XRetractionDirection    m_xRetractionDirection;
 
     // Once the user has set the x position once then we use
     // the status bar to display the effective diameter
     bool        m_xDiameterSet{ false };
+    // The diameter as last shown, and the X step it was worked out at,
+    // so it's only formatted when X has moved
+    std::string m_diameterStatus;
+    long        m_diameterStep{ 0 };
+    // Read once, in initialise(), as the control thread needs them
+    double      m_axis1MaxMotorSpeed{ 700.0 };
+    double      m_axis1SpeedPreset2{ 40.0 };
+    double      m_axis2SpeedPreset2{ 20.0 };
+    // What checkStatus() last told m_onChanged about, to tell when
+    // they change (see checkStatus())
+    std::string m_notifiedAxis1Status;
+    std::string m_notifiedAxis2Status;
+    std::string m_notifiedGeneralStatus;
+    std::string m_notifiedWarning;
     double      m_axis1LastRelativeMove{ 0.0 };
     double      m_axis2LastRelativeMove{ 0.0 };
     Axis        m_lastRelativeMoveAxis;
 
     std::stack<double> m_axis1PreviousPositions;
+
+    // Waiting for each axis to stop (see axis1WhenStopped())
+    std::vector<StoppedFunction> m_axis1WhenStopped;
+    std::vector<StoppedFunction> m_axis2WhenStopped;
+
+    MotionQueue m_motionQueue;
+    // Runs planned from the queue and not yet started
+    std::deque<std::vector<MotionSegment>> m_motionRuns;
+    // Whether the motors have been sent the first step of the run at the
+    // front of m_motionRuns, so it can start once they've made it
+    bool m_motionRunStepped{ false };
+    // Where the motors were when the running coordinated move started,
+    // and which way it's taking them, until the motors have been told
+    // where it finished
+    bool m_coordinatedFollowing{ false };
+    long m_coordinatedAxis1Start{ 0 };
+    long m_coordinatedAxis2Start{ 0 };
+    int  m_coordinatedAxis1Direction{ 0 };
+    int  m_coordinatedAxis2Direction{ 0 };
+
+    // Declared last so their threads are stopped before anything
+    // they might call back into is destroyed
+    std::unique_ptr<mgo::ElectronicGearbox> m_gearbox;
+    std::unique_ptr<mgo::CoordinatedMove> m_coordinatedMove;
+    std::unique_ptr<mgo::SpindleMonitor> m_spindleMonitor;
 };
 
 } // end namespace
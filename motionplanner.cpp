@@ -0,0 +1,199 @@
+#include "motionplanner.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mgo
+{
+
+namespace
+{
+
+// Enough to get within a hair of the exact answer
+constexpr int BISECTION_STEPS = 50;
+
+} // end anonymous namespace
+
+SCurveProfile::SCurveProfile(
+    double              distance,
+    double              startVelocity,
+    double              endVelocity,
+    const MotionLimits& limits
+    )
+    : m_limits( limits )
+{
+    double v0 = std::clamp( startVelocity, 0.0, limits.maxVelocity );
+    double v1 = std::clamp( endVelocity, 0.0, limits.maxVelocity );
+    distance = std::max( distance, 0.0 );
+
+    // If we can't even get from one speed to the other, we settle for
+    // the nearest finishing speed we can manage
+    if( changeDistance( v0, v1, limits ) > distance )
+    {
+        double reachable = v0;
+        double unreachable = v1;
+        for( int n = 0; n < BISECTION_STEPS; ++n )
+        {
+            double v = ( reachable + unreachable ) / 2.0;
+            ( changeDistance( v0, v, limits ) <= distance ? reachable : unreachable ) = v;
+        }
+        v1 = reachable;
+    }
+    m_endVelocity = v1;
+
+    // The fastest we can get to and still slow down in time
+    double low = std::max( v0, v1 );
+    double high = limits.maxVelocity;
+    if( changeDistance( v0, high, limits ) + changeDistance( high, v1, limits ) <= distance )
+    {
+        low = high;
+    }
+    for( int n = 0; n < BISECTION_STEPS && low < high; ++n )
+    {
+        double v = ( low + high ) / 2.0;
+        if( changeDistance( v0, v, limits ) + changeDistance( v, v1, limits ) <= distance )
+        {
+            low = v;
+        }
+        else
+        {
+            high = v;
+        }
+    }
+    m_peakVelocity = low;
+
+    addPhase( 0.0, 0.0 );
+    m_phases.back().velocity = v0;
+    addChange( v0, m_peakVelocity );
+    double cruise = distance
+        - changeDistance( v0, m_peakVelocity, limits )
+        - changeDistance( m_peakVelocity, v1, limits );
+    if( cruise > 0.0 && m_peakVelocity > 0.0 )
+    {
+        addPhase( cruise / m_peakVelocity, 0.0 );
+    }
+    addChange( m_peakVelocity, v1 );
+}
+
+double SCurveProfile::changeTime( double from, double to, const MotionLimits& limits )
+{
+    double dv = std::abs( to - from );
+    if( dv == 0.0 ) return 0.0;
+    double a = limits.maxAcceleration;
+    double j = limits.maxJerk;
+    if( dv * j >= a * a )
+    {
+        // Build up to full acceleration, hold it, then wind it down
+        return dv / a + a / j;
+    }
+    // Never reaches full acceleration
+    return 2.0 * std::sqrt( dv / j );
+}
+
+double SCurveProfile::changeDistance( double from, double to, const MotionLimits& limits )
+{
+    // The profile is symmetrical, so the average speed is half way
+    return ( from + to ) / 2.0 * changeTime( from, to, limits );
+}
+
+void SCurveProfile::addPhase( double duration, double jerk )
+{
+    if( m_phases.empty() )
+    {
+        m_phases.push_back( { duration, jerk, 0.0, 0.0, 0.0, 0.0 } );
+        return;
+    }
+    const Phase& last = m_phases.back();
+    double t = last.duration;
+    m_phases.push_back( {
+        duration,
+        jerk,
+        last.start + t,
+        positionIn( last, t ),
+        last.velocity + last.acceleration * t + last.jerk * t * t / 2.0,
+        last.acceleration + last.jerk * t
+        } );
+}
+
+void SCurveProfile::addChange( double from, double to )
+{
+    double dv = std::abs( to - from );
+    if( dv == 0.0 ) return;
+    double sign = to > from ? 1.0 : -1.0;
+    double a = m_limits.maxAcceleration;
+    double j = m_limits.maxJerk * sign;
+    if( dv * m_limits.maxJerk >= a * a )
+    {
+        addPhase( a / m_limits.maxJerk, j );
+        addPhase( dv / a - a / m_limits.maxJerk, 0.0 );
+        addPhase( a / m_limits.maxJerk, -j );
+    }
+    else
+    {
+        double t = std::sqrt( dv / m_limits.maxJerk );
+        addPhase( t, j );
+        addPhase( t, -j );
+    }
+}
+
+double SCurveProfile::getDuration() const
+{
+    const Phase& last = m_phases.back();
+    return last.start + last.duration;
+}
+
+const SCurveProfile::Phase& SCurveProfile::phaseAt( double t ) const
+{
+    auto phase = std::upper_bound( m_phases.begin(), m_phases.end(), t,
+        []( double time, const Phase& p ){ return time < p.start; } );
+    return *( phase == m_phases.begin() ? phase : phase - 1 );
+}
+
+double SCurveProfile::positionIn( const Phase& phase, double t )
+{
+    return phase.position + phase.velocity * t + phase.acceleration * t * t / 2.0
+        + phase.jerk * t * t * t / 6.0;
+}
+
+double SCurveProfile::positionAt( double t ) const
+{
+    t = std::clamp( t, 0.0, getDuration() );
+    const Phase& phase = phaseAt( t );
+    return positionIn( phase, std::min( t - phase.start, phase.duration ) );
+}
+
+double SCurveProfile::velocityAt( double t ) const
+{
+    t = std::clamp( t, 0.0, getDuration() );
+    const Phase& phase = phaseAt( t );
+    double dt = std::min( t - phase.start, phase.duration );
+    return phase.velocity + phase.acceleration * dt + phase.jerk * dt * dt / 2.0;
+}
+
+std::vector<uint32_t> SCurveProfile::stepTimes( long steps ) const
+{
+    std::vector<uint32_t> times;
+    times.reserve( steps );
+    // Steps come in order, so we only ever move forwards through the phases
+    std::size_t phase = 0;
+    for( long step = 1; step <= steps; ++step )
+    {
+        while( phase + 1 < m_phases.size() &&
+               positionIn( m_phases[ phase ], m_phases[ phase ].duration ) < step )
+        {
+            ++phase;
+        }
+        const Phase& p = m_phases[ phase ];
+        double low = 0.0;
+        double high = p.duration;
+        for( int n = 0; n < BISECTION_STEPS; ++n )
+        {
+            double t = ( low + high ) / 2.0;
+            ( positionIn( p, t ) < step ? low : high ) = t;
+        }
+        times.push_back( static_cast<uint32_t>( std::llround( ( p.start + high ) * 1'000'000.0 ) ) );
+    }
+    return times;
+}
+
+} // end namespace
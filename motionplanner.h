@@ -0,0 +1,80 @@
+#pragma once
+// Jerk-limited ("S-curve") motion profiles. Rather than changing speed in
+// one go, acceleration itself is built up and wound down at no more than
+// the maximum jerk, so the motor isn't asked for a sudden change of
+// torque, which is what makes steppers stall at higher speeds. A move is
+// worked out in full before it starts, giving the time each step is due.
+//
+// Everything here is in steps and seconds: velocity in steps/s,
+// acceleration in steps/s^2 and jerk in steps/s^3.
+
+#include <cstdint>
+#include <vector>
+
+namespace mgo
+{
+
+struct MotionLimits
+{
+    double maxVelocity;
+    double maxAcceleration;
+    double maxJerk;
+};
+
+class SCurveProfile
+{
+public:
+    // Moves the given distance, starting and finishing at the given
+    // speeds. If the finishing speed can't be reached in the distance,
+    // we get as close to it as we can (see getEndVelocity()).
+    SCurveProfile(
+        double              distance,
+        double              startVelocity,
+        double              endVelocity,
+        const MotionLimits& limits
+        );
+
+    double getDuration() const;
+    double getPeakVelocity() const
+    {
+        return m_peakVelocity;
+    }
+    double getEndVelocity() const
+    {
+        return m_endVelocity;
+    }
+    double positionAt( double t ) const;
+    double velocityAt( double t ) const;
+
+    // The time (in microseconds from the start) at which each whole
+    // step from 1 to steps is reached
+    std::vector<uint32_t> stepTimes( long steps ) const;
+
+    // How far it takes to change speed from one to the other, and
+    // how long, within the limits
+    static double changeDistance( double from, double to, const MotionLimits& limits );
+    static double changeTime( double from, double to, const MotionLimits& limits );
+
+private:
+    struct Phase
+    {
+        double duration;
+        double jerk;
+        // State at the start of the phase
+        double start;
+        double position;
+        double velocity;
+        double acceleration;
+    };
+    void addPhase( double duration, double jerk );
+    void addChange( double from, double to );
+    const Phase& phaseAt( double t ) const;
+    static double positionIn( const Phase& phase, double t );
+
+    MotionLimits m_limits;
+    double m_peakVelocity{ 0.0 };
+    double m_endVelocity{ 0.0 };
+    std::vector<Phase> m_phases;
+};
+
+} // end namespace
@@ -0,0 +1,158 @@
+#include "motionqueue.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mgo
+{
+
+namespace
+{
+
+constexpr int BISECTION_STEPS = 50;
+
+int sign( long value )
+{
+    return value > 0 ? 1 : ( value < 0 ? -1 : 0 );
+}
+
+// The fastest we can get to from "from" in the given distance (which is
+// also the fastest we can start at and still slow to "from" in time)
+double reachableVelocity( double from, double distance, const MotionLimits& limits )
+{
+    double low = from;
+    double high = limits.maxVelocity;
+    if( SCurveProfile::changeDistance( from, high, limits ) <= distance ) return high;
+    for( int n = 0; n < BISECTION_STEPS; ++n )
+    {
+        double v = ( low + high ) / 2.0;
+        ( SCurveProfile::changeDistance( from, v, limits ) <= distance ? low : high ) = v;
+    }
+    return low;
+}
+
+} // end anonymous namespace
+
+std::vector<std::vector<MotionSegment>> MotionQueue::plan(
+    long                  axis1From,
+    long                  axis2From,
+    double                axis1MmPerStep,
+    double                axis2MmPerStep,
+    const LimitsFunction& limits
+    )
+{
+    std::vector<std::vector<MotionSegment>> runs;
+    std::vector<MotionSegment> run;
+    int axis1Direction = 0;
+    int axis2Direction = 0;
+    for( const Target& target : m_targets )
+    {
+        long axis1Steps = target.axis1Step - axis1From;
+        long axis2Steps = target.axis2Step - axis2From;
+        axis1From = target.axis1Step;
+        axis2From = target.axis2Step;
+        if( axis1Steps == 0 && axis2Steps == 0 ) continue;
+        // A change of direction on either axis needs a new run
+        if( ( sign( axis1Steps ) != 0 && axis1Direction != 0 &&
+              sign( axis1Steps ) != axis1Direction ) ||
+            ( sign( axis2Steps ) != 0 && axis2Direction != 0 &&
+              sign( axis2Steps ) != axis2Direction ) )
+        {
+            runs.push_back( std::move( run ) );
+            run.clear();
+            axis1Direction = 0;
+            axis2Direction = 0;
+        }
+        if( axis1Steps != 0 ) axis1Direction = sign( axis1Steps );
+        if( axis2Steps != 0 ) axis2Direction = sign( axis2Steps );
+        double axis1Mm = axis1Steps * axis1MmPerStep;
+        double axis2Mm = axis2Steps * axis2MmPerStep;
+        run.push_back( {
+            axis1Steps,
+            axis2Steps,
+            axis1Mm,
+            axis2Mm,
+            std::hypot( axis1Mm, axis2Mm ),
+            limits( std::abs( axis1Mm ), std::abs( axis2Mm ), target.feed ),
+            0.0,
+            0.0
+            } );
+    }
+    if( ! run.empty() )
+    {
+        runs.push_back( std::move( run ) );
+    }
+    for( auto& r : runs )
+    {
+        planRun( r );
+    }
+    m_targets.clear();
+    return runs;
+}
+
+double MotionQueue::junctionVelocity( const MotionSegment& from, const MotionSegment& to ) const
+{
+    // As in grbl: the corner is taken on an arc which comes within the
+    // junction deviation of it, at a speed whose centripetal acceleration
+    // is within the limit
+    double cosTheta = -( from.axis1Mm * to.axis1Mm + from.axis2Mm * to.axis2Mm )
+        / ( from.length * to.length );
+    double fastest = std::min( from.limits.maxVelocity, to.limits.maxVelocity );
+    if( cosTheta < -0.999999 )
+    {
+        // Straight on
+        return fastest;
+    }
+    if( cosTheta > 0.999999 )
+    {
+        // Straight back
+        return 0.0;
+    }
+    double sinHalfTheta = std::sqrt( 0.5 * ( 1.0 - cosTheta ) );
+    double acceleration =
+        std::min( from.limits.maxAcceleration, to.limits.maxAcceleration );
+    return std::min( fastest, std::sqrt(
+        acceleration * m_junctionDeviation * sinHalfTheta / ( 1.0 - sinHalfTheta ) ) );
+}
+
+void MotionQueue::planRun( std::vector<MotionSegment>& run ) const
+{
+    for( const auto& segment : run )
+    {
+        // Moves at a steady speed aren't blended
+        if( segment.limits.maxAcceleration <= 0.0 || segment.limits.maxJerk <= 0.0 ) return;
+    }
+    // Start with the corners...
+    for( std::size_t n = 0; n + 1 < run.size(); ++n )
+    {
+        double v = junctionVelocity( run[ n ], run[ n + 1 ] );
+        run[ n ].exitVelocity = v;
+        run[ n + 1 ].entryVelocity = v;
+    }
+    // ...then working back from the end, each move must be able to slow
+    // down to the speed the next one starts at...
+    for( std::size_t n = run.size(); n-- > 0; )
+    {
+        MotionSegment& segment = run[ n ];
+        if( n + 1 < run.size() )
+        {
+            segment.exitVelocity = std::min( segment.exitVelocity, run[ n + 1 ].entryVelocity );
+        }
+        segment.entryVelocity = std::min( segment.entryVelocity,
+            reachableVelocity( segment.exitVelocity, segment.length, segment.limits ) );
+    }
+    // ...and working forwards, must be able to get up to the speed it
+    // finishes at
+    for( std::size_t n = 0; n < run.size(); ++n )
+    {
+        MotionSegment& segment = run[ n ];
+        if( n > 0 )
+        {
+            segment.entryVelocity = std::min( segment.entryVelocity, run[ n - 1 ].exitVelocity );
+        }
+        segment.exitVelocity = std::min( segment.exitVelocity,
+            reachableVelocity( segment.entryVelocity, segment.length, segment.limits ) );
+    }
+}
+
+} // end namespace
@@ -0,0 +1,103 @@
+#pragma once
+// A list of straight-line moves to be made one after the other without
+// stopping in between. Before they're made, a look-ahead pass works out
+// how fast each corner can be taken (the sharper it is, the slower), and
+// then how fast each move may start and finish so that every later one
+// can still slow down in time. Moves then blend into each other instead
+// of each starting and ending at a standstill.
+//
+// The motors have to take up backlash if either of them changes
+// direction, so the moves are split into runs at those points, and each
+// run starts and finishes stopped.
+
+#include "motionplanner.h"
+
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace mgo
+{
+
+struct MotionSegment
+{
+    long   axis1Steps;  // signed
+    long   axis2Steps;
+    double axis1Mm;     // signed
+    double axis2Mm;
+    double length;      // mm
+    // Along the line, in mm and seconds
+    MotionLimits limits;
+    // Worked out by plan(), mm/s
+    double entryVelocity;
+    double exitVelocity;
+};
+
+class MotionQueue
+{
+public:
+    // The limits for a move of the given lengths (mm) at the given feed rate
+    // (mm/min along the line). With no acceleration limit, moves are made at
+    // a steady speed and not blended.
+    using LimitsFunction =
+        std::function<MotionLimits( double axis1Mm, double axis2Mm, double feed )>;
+
+    // How far (mm) the tool may stray from a corner to take it faster
+    explicit MotionQueue( double junctionDeviation = 0.01 )
+        : m_junctionDeviation( junctionDeviation ) {}
+
+    void setJunctionDeviation( double mm )
+    {
+        m_junctionDeviation = mm;
+    }
+
+    // Adds a move to the given steps at the given feed rate (mm/min)
+    void add( long axis1Step, long axis2Step, double feed )
+    {
+        m_targets.push_back( { axis1Step, axis2Step, feed } );
+    }
+    // Moves each target's axis2 step on by "ratio" for every axis1 step it
+    // is from axis1From, e.g. to correct a lathe which cuts a taper
+    void skew( long axis1From, double ratio )
+    {
+        for( auto& target : m_targets )
+        {
+            target.axis2Step += std::lround( ( target.axis1Step - axis1From ) * ratio );
+        }
+    }
+    bool empty() const
+    {
+        return m_targets.empty();
+    }
+    void clear()
+    {
+        m_targets.clear();
+    }
+
+    // Turns everything queued into runs of segments, starting from the
+    // given steps, and empties the queue
+    std::vector<std::vector<MotionSegment>> plan(
+        long                  axis1From,
+        long                  axis2From,
+        double                axis1MmPerStep,
+        double                axis2MmPerStep,
+        const LimitsFunction& limits
+        );
+
+    // The fastest a corner from one segment to the next can be taken
+    double junctionVelocity( const MotionSegment& from, const MotionSegment& to ) const;
+
+private:
+    struct Target
+    {
+        long   axis1Step;
+        long   axis2Step;
+        double feed;
+    };
+    void planRun( std::vector<MotionSegment>& run ) const;
+
+    double m_junctionDeviation;
+    std::vector<Target> m_targets;
+};
+
+} // end namespace
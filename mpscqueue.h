@@ -0,0 +1,104 @@
+#pragma once
+// A fixed-size, lock-free queue which any number of threads can push to,
+// and exactly one thread pops from. Each slot carries a sequence number
+// saying whose turn it is to use it (see Dmitry Vyukov's bounded queue),
+// so a producer claims a slot with a single compare-and-swap, and nobody
+// ever waits on a lock. Used to hand commands from the UI (and anything
+// else) to the thread which carries them out.
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace mgo
+{
+
+template<typename T, std::size_t Capacity>
+class MpscQueue
+{
+    static_assert( Capacity >= 2 && ( Capacity & ( Capacity - 1 ) ) == 0,
+        "MpscQueue capacity must be a power of two" );
+public:
+    MpscQueue()
+    {
+        for( std::size_t n = 0; n < Capacity; ++n )
+        {
+            m_cells[ n ].sequence.store( n, std::memory_order_relaxed );
+        }
+    }
+
+    MpscQueue( const MpscQueue& ) = delete;
+    MpscQueue& operator=( const MpscQueue& ) = delete;
+
+    // Any thread. Returns false, and drops the item, if the queue is full.
+    bool push( const T& item )
+    {
+        std::size_t pos = m_tail.load( std::memory_order_relaxed );
+        for(;;)
+        {
+            Cell& cell = m_cells[ pos & ( Capacity - 1 ) ];
+            const std::size_t sequence = cell.sequence.load( std::memory_order_acquire );
+            const auto diff =
+                static_cast<std::intptr_t>( sequence ) - static_cast<std::intptr_t>( pos );
+            if( diff == 0 )
+            {
+                // Free, if no other producer gets there first
+                if( m_tail.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+                {
+                    cell.item = item;
+                    cell.sequence.store( pos + 1, std::memory_order_release );
+                    return true;
+                }
+                // pos has been reloaded; try again
+            }
+            else if( diff < 0 )
+            {
+                // The consumer hasn't got round to this slot yet
+                return false;
+            }
+            else
+            {
+                // Another producer has had it; catch up
+                pos = m_tail.load( std::memory_order_relaxed );
+            }
+        }
+    }
+
+    // Consumer side only. Returns false if there is nothing to read
+    // (including a producer which has claimed a slot, but not yet filled
+    // it; its item comes next time).
+    bool pop( T& item )
+    {
+        Cell& cell = m_cells[ m_head & ( Capacity - 1 ) ];
+        const std::size_t sequence = cell.sequence.load( std::memory_order_acquire );
+        if( sequence != m_head + 1 )
+        {
+            return false;
+        }
+        item = cell.item;
+        // Ready for whoever gets here on the next time round
+        cell.sequence.store( m_head + Capacity, std::memory_order_release );
+        ++m_head;
+        return true;
+    }
+
+    constexpr std::size_t capacity() const
+    {
+        return Capacity;
+    }
+
+private:
+    struct alignas( 64 ) Cell
+    {
+        std::atomic<std::size_t> sequence;
+        T item{};
+    };
+
+    // Producers share the tail; the head is only the consumer's
+    alignas( 64 ) std::atomic<std::size_t> m_tail{ 0 };
+    alignas( 64 ) std::size_t m_head{ 0 };
+    std::array<Cell, Capacity> m_cells;
+};
+
+} // end namespace
@@ -0,0 +1,110 @@
+#include "pitchcompensation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace mgo
+{
+
+std::vector<PitchCompensationPoint> readPitchCompensation( std::istream& is )
+{
+    std::vector<PitchCompensationPoint> points;
+    std::string line;
+    int lineNumber = 0;
+    while( std::getline( is, line ) )
+    {
+        ++lineNumber;
+        line = line.substr( 0, line.find( '#' ) );
+        std::replace( line.begin(), line.end(), ',', ' ' );
+        std::istringstream iss( line );
+        PitchCompensationPoint point{ 0.0, 0.0 };
+        if( ! ( iss >> point.position ) ) continue;
+        std::string extra;
+        if( ! ( iss >> point.steps ) || iss >> extra )
+        {
+            throw std::runtime_error(
+                "Pitch compensation line " + std::to_string( lineNumber ) + " not understood" );
+        }
+        points.push_back( point );
+    }
+    return points;
+}
+
+std::vector<PitchCompensationPoint> readPitchCompensationFile( const std::string& filename )
+{
+    std::ifstream ifs( filename );
+    if( ! ifs )
+    {
+        throw std::runtime_error( "Could not open pitch compensation " + filename );
+    }
+    return readPitchCompensation( ifs );
+}
+
+PitchCompensation::PitchCompensation( std::vector<PitchCompensationPoint> points )
+    : m_points( std::move( points ) )
+{
+    for( std::size_t n = 1; n < m_points.size(); ++n )
+    {
+        if( m_points[ n ].position <= m_points[ n - 1 ].position )
+        {
+            throw std::runtime_error( "Pitch compensation positions must go up" );
+        }
+    }
+}
+
+long PitchCompensation::stepsAt( double position ) const
+{
+    if( m_points.empty() ) return 0;
+    return interpolate( indexAt( position ), position );
+}
+
+std::size_t PitchCompensation::indexAt( double position ) const
+{
+    auto it = std::upper_bound( m_points.begin(), m_points.end(), position,
+        []( double p, const PitchCompensationPoint& point ){ return p < point.position; } );
+    return it == m_points.begin() ? 0 : it - m_points.begin() - 1;
+}
+
+long PitchCompensation::interpolate( std::size_t index, double position ) const
+{
+    const PitchCompensationPoint& from = m_points[ index ];
+    if( index + 1 >= m_points.size() || position <= from.position )
+    {
+        return std::lround( from.steps );
+    }
+    const PitchCompensationPoint& to = m_points[ index + 1 ];
+    double t = std::min( 1.0, ( position - from.position ) / ( to.position - from.position ) );
+    return std::lround( from.steps + t * ( to.steps - from.steps ) );
+}
+
+PitchCompensation::Cursor::Cursor( const PitchCompensation& table, double mmPerStep, long step )
+    : m_table( table ),
+      m_mmPerStep( mmPerStep )
+{
+    if( ! m_table.empty() )
+    {
+        m_index = m_table.indexAt( step * m_mmPerStep );
+    }
+}
+
+long PitchCompensation::Cursor::stepsAt( long step )
+{
+    const auto& points = m_table.m_points;
+    if( points.empty() ) return 0;
+    double position = step * m_mmPerStep;
+    // Nearly always this is the same interval as last time, or the next
+    while( m_index + 1 < points.size() && position >= points[ m_index + 1 ].position )
+    {
+        ++m_index;
+    }
+    while( m_index > 0 && position < points[ m_index ].position )
+    {
+        --m_index;
+    }
+    return m_table.interpolate( m_index, position );
+}
+
+} // end namespace
@@ -0,0 +1,82 @@
+#pragma once
+// Leadscrew pitch error compensation. Backlash aside, a leadscrew's pitch
+// isn't quite exact, and the error adds up along its length. Measure it
+// against a DRO or dial indicator every so often along the travel and
+// put it in a text file, one point per line:
+//
+//     # comments start with a hash
+//     position, steps     steps to add (or take away, if negative) to
+//                         get to this position (mm)
+//
+// In between, the correction is interpolated; beyond the ends, it stays
+// at the nearest one. Positions are as displayed, so measure from where
+// the axis is zeroed (e.g. the chuck face) and zero it there each time.
+//
+// Stepping only goes one way at a time, so rather than search the table
+// for every step, a cursor keeps its place and moves on to the next point
+// only as the position passes it.
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace mgo
+{
+
+struct PitchCompensationPoint
+{
+    double position; // mm
+    double steps;
+};
+
+// These throw std::runtime_error, giving the line, if the table can't
+// be understood
+std::vector<PitchCompensationPoint> readPitchCompensation( std::istream& is );
+std::vector<PitchCompensationPoint> readPitchCompensationFile( const std::string& filename );
+
+class PitchCompensation
+{
+public:
+    // No compensation
+    PitchCompensation() = default;
+    // Throws std::runtime_error if the positions don't go up
+    explicit PitchCompensation( std::vector<PitchCompensationPoint> points );
+
+    bool empty() const
+    {
+        return m_points.empty();
+    }
+
+    // The correction (in whole steps) at the given position. This searches
+    // the table, so is for one-offs, not for each step.
+    long stepsAt( double position ) const;
+
+    class Cursor
+    {
+    public:
+        // The table must outlive the cursor. mmPerStep is the motor's
+        // conversion factor (negative if steps go the other way to the
+        // position), and step is where it's starting from.
+        Cursor( const PitchCompensation& table, double mmPerStep, long step );
+
+        // The correction at the given step, which should be near the last
+        // one asked for
+        long stepsAt( long step );
+
+    private:
+        const PitchCompensation& m_table;
+        double      m_mmPerStep;
+        std::size_t m_index{ 0 };
+    };
+
+private:
+    // The point at or before the position (or the first)
+    std::size_t indexAt( double position ) const;
+    // Between point index and the one after
+    long interpolate( std::size_t index, double position ) const;
+
+    std::vector<PitchCompensationPoint> m_points;
+};
+
+} // end namespace
@@ -0,0 +1,67 @@
+#pragma once
+// A mutex which lends the priority of whoever is waiting for it to
+// whoever holds it (priority inheritance). The control thread runs at a
+// realtime priority, but shares the model with the key and display
+// threads, which don't. With a plain std::mutex, one of those holding
+// the lock could be kept off the CPU by anything of middling priority,
+// and the control thread kept waiting with it.
+//
+// It has lock(), try_lock() and unlock(), so std::lock_guard and
+// std::unique_lock work with it as they do with std::mutex. It also
+// knows which thread has it, so that something deep inside a call can
+// let go of it for a while (see Model::waitForMotor()).
+
+#include <atomic>
+#include <pthread.h>
+#include <thread>
+
+namespace mgo
+{
+
+class PriorityMutex
+{
+public:
+    PriorityMutex()
+    {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init( &attr );
+        pthread_mutexattr_setprotocol( &attr, PTHREAD_PRIO_INHERIT );
+        pthread_mutex_init( &m_mutex, &attr );
+        pthread_mutexattr_destroy( &attr );
+    }
+    ~PriorityMutex()
+    {
+        pthread_mutex_destroy( &m_mutex );
+    }
+
+    PriorityMutex( const PriorityMutex& ) = delete;
+    PriorityMutex& operator=( const PriorityMutex& ) = delete;
+
+    void lock()
+    {
+        pthread_mutex_lock( &m_mutex );
+        m_owner = std::this_thread::get_id();
+    }
+    bool try_lock()
+    {
+        if( pthread_mutex_trylock( &m_mutex ) != 0 ) return false;
+        m_owner = std::this_thread::get_id();
+        return true;
+    }
+    void unlock()
+    {
+        m_owner = std::thread::id();
+        pthread_mutex_unlock( &m_mutex );
+    }
+
+    bool heldByThisThread() const
+    {
+        return m_owner == std::this_thread::get_id();
+    }
+
+private:
+    pthread_mutex_t m_mutex;
+    std::atomic<std::thread::id> m_owner{};
+};
+
+} // end namespace
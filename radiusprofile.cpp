@@ -0,0 +1,24 @@
+#include "radiusprofile.h"
+
+#include <cmath>
+
+namespace mgo
+{
+
+RadiusProfile::RadiusProfile( double radius, double mmPerStep )
+    : m_radius( radius ), m_mmPerStep( mmPerStep )
+{
+    if( radius <= 0.0 || mmPerStep <= 0.0 ) return;
+    // To solve for X, given Z, we can use Pythagoras as we have a
+    // right angle with known hypoteneuse (i.e. the radius):
+    // z^2 + x^2 = r^2, so sqrt( r^2 - z^2 ) = our x position
+    std::size_t steps = static_cast<std::size_t>( std::floor( radius / mmPerStep ) );
+    m_offsets.reserve( steps + 1 );
+    for( std::size_t step = 0; step <= steps; ++step )
+    {
+        double z = step * mmPerStep;
+        m_offsets.push_back( radius - std::sqrt( radius * radius - z * z ) );
+    }
+}
+
+} // end namespace
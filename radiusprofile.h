@@ -0,0 +1,47 @@
+#pragma once
+// The X offset along a radius for every Z step, worked out once when
+// the radius is set rather than with a square root each time the cross
+// slide follows the carriage. Looking up a step is then just a divide
+// and an index, which keeps up with finer steps and faster carriage
+// speeds.
+
+#include <cstddef>
+#include <vector>
+
+namespace mgo
+{
+
+class RadiusProfile
+{
+public:
+    RadiusProfile() = default;
+    // radius and mmPerStep are both positive
+    RadiusProfile( double radius, double mmPerStep );
+
+    // How far the surface of the radius is from its apex, z mm along from
+    // the apex. Before the apex that's nothing, and beyond the end of the
+    // radius it's the whole radius.
+    double xOffsetAt( double z ) const
+    {
+        if( z <= 0.0 || m_offsets.empty() ) return 0.0;
+        std::size_t step = static_cast<std::size_t>( z / m_mmPerStep + 0.5 );
+        if( step >= m_offsets.size() ) return m_radius;
+        return m_offsets[ step ];
+    }
+
+    double getRadius() const
+    {
+        return m_radius;
+    }
+    double getMmPerStep() const
+    {
+        return m_mmPerStep;
+    }
+
+private:
+    double m_radius{ 0.0 };
+    double m_mmPerStep{ 1.0 };
+    std::vector<double> m_offsets;
+};
+
+} // end namespace
@@ -0,0 +1,69 @@
+#include "recordinggpio.h"
+
+namespace mgo
+{
+
+void RecordingGpio::setStepPin( int pin, PinState state )
+{
+    m_gpio.setStepPin( pin, state );
+    recordWrite( TraceEvent::StepPin, pin, state );
+}
+
+void RecordingGpio::setReversePin( int pin, PinState state )
+{
+    m_gpio.setReversePin( pin, state );
+    recordWrite( TraceEvent::ReversePin, pin, state );
+}
+
+void RecordingGpio::setEnablePin( int pin, PinState state )
+{
+    m_gpio.setEnablePin( pin, state );
+    recordWrite( TraceEvent::EnablePin, pin, state );
+}
+
+void RecordingGpio::setRotaryEncoderCallback(
+    int pinA,
+    int pinB,
+    void ( *callback )( int, int, uint32_t, void* ),
+    void* user
+    )
+{
+    m_registrations.push_back( { this, callback, user } );
+    m_gpio.setRotaryEncoderCallback( pinA, pinB, staticCallback, &m_registrations.back() );
+}
+
+bool RecordingGpio::setIndexPinCallback(
+    int pin,
+    void ( *callback )( int, int, uint32_t, void* ),
+    void* user
+    )
+{
+    IIndexPin* indexPin = dynamic_cast<IIndexPin*>( &m_gpio );
+    if( indexPin == nullptr ) return false;
+    m_registrations.push_back( { this, callback, user } );
+    return indexPin->setIndexPinCallback( pin, staticCallback, &m_registrations.back() );
+}
+
+void RecordingGpio::staticCallback( int pin, int level, uint32_t tick, void* userData )
+{
+    Registration* registration = reinterpret_cast<Registration*>( userData );
+    registration->self->m_writer.write( {
+        tick,
+        TraceEvent::EncoderEdge,
+        static_cast<uint8_t>( pin ),
+        static_cast<uint8_t>( level )
+        } );
+    registration->callback( pin, level, tick, registration->user );
+}
+
+void RecordingGpio::recordWrite( TraceEvent event, int pin, PinState state )
+{
+    m_writer.write( {
+        m_gpio.getTick(),
+        event,
+        static_cast<uint8_t>( pin ),
+        static_cast<uint8_t>( state == PinState::high ? 1 : 0 )
+        } );
+}
+
+} // end namespace
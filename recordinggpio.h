@@ -0,0 +1,65 @@
+#pragma once
+// Sits between the program and the real (or mock) GPIO, passing everything
+// through unchanged but writing encoder edges and motor pin writes to a
+// trace file on the way, so a run on the machine can be replayed later
+// with ReplayGpio.
+
+#include "gpiotrace.h"
+#include "iindexpin.h"
+#include "stepperControl/igpio.h"
+
+#include <deque>
+#include <string>
+
+namespace mgo
+{
+
+class RecordingGpio : public IGpio, public IIndexPin
+{
+public:
+    RecordingGpio( IGpio& gpio, const std::string& filename )
+        : m_gpio( gpio ), m_writer( filename ) {}
+
+    void setStepPin( int pin, PinState state ) override;
+    void setReversePin( int pin, PinState state ) override;
+    void setEnablePin( int pin, PinState state ) override;
+    void delayMicroSeconds( long usecs ) override
+    {
+        m_gpio.delayMicroSeconds( usecs );
+    }
+    void setRotaryEncoderCallback(
+        int pinA,
+        int pinB,
+        void ( *callback )( int, int, uint32_t, void* ),
+        void* user
+        ) override;
+    uint32_t getTick() override
+    {
+        return m_gpio.getTick();
+    }
+    // Only if the gpio we're wrapping can
+    bool setIndexPinCallback(
+        int pin,
+        void ( *callback )( int, int, uint32_t, void* ),
+        void* user
+        ) override;
+
+private:
+    // What the caller asked to be called back with. We register
+    // ourselves in its place, and pass each edge on after recording it.
+    struct Registration
+    {
+        RecordingGpio* self;
+        void ( *callback )( int, int, uint32_t, void* );
+        void* user;
+    };
+    static void staticCallback( int pin, int level, uint32_t tick, void* userData );
+    void recordWrite( TraceEvent event, int pin, PinState state );
+
+    IGpio& m_gpio;
+    TraceWriter m_writer;
+    // A deque, so registrations don't move when another is added
+    std::deque<Registration> m_registrations;
+};
+
+} // end namespace
@@ -0,0 +1,101 @@
+#include "replaygpio.h"
+
+#include <thread>
+
+namespace mgo
+{
+
+void ReplayGpio::delayMicroSeconds( long usecs )
+{
+    std::this_thread::sleep_for( std::chrono::microseconds( usecs ) );
+}
+
+void ReplayGpio::setRotaryEncoderCallback(
+    int pinA,
+    int pinB,
+    void ( *callback )( int, int, uint32_t, void* ),
+    void* user
+    )
+{
+    m_registrations[ pinA ] = { callback, user };
+    m_registrations[ pinB ] = { callback, user };
+}
+
+bool ReplayGpio::setIndexPinCallback(
+    int pin,
+    void ( *callback )( int, int, uint32_t, void* ),
+    void* user
+    )
+{
+    m_registrations[ pin ] = { callback, user };
+    return true;
+}
+
+uint32_t ReplayGpio::getTick()
+{
+    if( m_clockRunning )
+    {
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - m_startTime );
+        return m_startTick + static_cast<uint32_t>( elapsed.count() );
+    }
+    return m_tick;
+}
+
+std::size_t ReplayGpio::replay(
+    bool realTime,
+    const std::function<void()>& afterEdge
+    )
+{
+    std::size_t delivered = 0;
+    bool started = false;
+    for( const auto& record : m_recording )
+    {
+        if( record.event != TraceEvent::EncoderEdge ) continue;
+        auto registration = m_registrations.find( record.pin );
+        if( registration == m_registrations.end() ) continue;
+        if( ! started )
+        {
+            m_startTick = record.tick;
+            m_startTime = std::chrono::steady_clock::now();
+            m_clockRunning = realTime;
+            started = true;
+        }
+        if( realTime )
+        {
+            // Ticks wrap every 71 minutes, hence the unsigned arithmetic
+            std::this_thread::sleep_until(
+                m_startTime + std::chrono::microseconds( record.tick - m_startTick ) );
+        }
+        m_tick = record.tick;
+        registration->second.callback(
+            record.pin, record.level, record.tick, registration->second.user );
+        if( afterEdge )
+        {
+            afterEdge();
+        }
+        ++delivered;
+    }
+    m_clockRunning = false;
+    return delivered;
+}
+
+std::vector<TraceRecord> ReplayGpio::getWrites()
+{
+    std::lock_guard<std::mutex> lock( m_writesMutex );
+    return m_writes;
+}
+
+void ReplayGpio::recordWrite( TraceEvent event, int pin, PinState state )
+{
+    TraceRecord record{
+        getTick(),
+        event,
+        static_cast<uint8_t>( pin ),
+        static_cast<uint8_t>( state == PinState::high ? 1 : 0 )
+        };
+    std::lock_guard<std::mutex> lock( m_writesMutex );
+    m_writes.push_back( record );
+}
+
+} // end namespace
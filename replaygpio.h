@@ -0,0 +1,99 @@
+#pragma once
+// An IGpio which plays back a trace recorded by RecordingGpio. Encoder
+// edges are fed to whatever registered for their pins, either with their
+// original timing or as fast as possible, so a captured spindle run can
+// drive the real encoder code without the machine. Pin writes made by the
+// motors during playback are kept, so they can be compared with the ones
+// in the recording.
+
+#include "gpiotrace.h"
+#include "iindexpin.h"
+#include "stepperControl/igpio.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mgo
+{
+
+class ReplayGpio : public IGpio, public IIndexPin
+{
+public:
+    explicit ReplayGpio( const std::string& filename )
+        : m_recording( readTrace( filename ) ) {}
+    explicit ReplayGpio( std::vector<TraceRecord> recording )
+        : m_recording( std::move( recording ) ) {}
+
+    void setStepPin( int pin, PinState state ) override
+    {
+        recordWrite( TraceEvent::StepPin, pin, state );
+    }
+    void setReversePin( int pin, PinState state ) override
+    {
+        recordWrite( TraceEvent::ReversePin, pin, state );
+    }
+    void setEnablePin( int pin, PinState state ) override
+    {
+        recordWrite( TraceEvent::EnablePin, pin, state );
+    }
+    // Motors aren't part of the replay, so they still wait in real time
+    void delayMicroSeconds( long usecs ) override;
+    void setRotaryEncoderCallback(
+        int pinA,
+        int pinB,
+        void ( *callback )( int, int, uint32_t, void* ),
+        void* user
+        ) override;
+    // The tick in the recording that we've reached
+    uint32_t getTick() override;
+    bool setIndexPinCallback(
+        int pin,
+        void ( *callback )( int, int, uint32_t, void* ),
+        void* user
+        ) override;
+
+    // Delivers every recorded encoder edge, on the calling thread, and
+    // returns how many there were. Edges for pins nobody has registered
+    // for are skipped. The encoder only queues edges, with room for a few
+    // thousand, so afterEdge is called after each one to let whatever
+    // reads the encoder catch up (as the control thread would on the
+    // machine). It can be left out when replaying in real time with
+    // something else polling the encoder.
+    std::size_t replay(
+        bool realTime,
+        const std::function<void()>& afterEdge = std::function<void()>()
+        );
+
+    const std::vector<TraceRecord>& getRecording() const
+    {
+        return m_recording;
+    }
+    // Pin writes made since we were created
+    std::vector<TraceRecord> getWrites();
+
+private:
+    struct Registration
+    {
+        void ( *callback )( int, int, uint32_t, void* );
+        void* user;
+    };
+    void recordWrite( TraceEvent event, int pin, PinState state );
+
+    std::vector<TraceRecord> m_recording;
+    std::unordered_map<int, Registration> m_registrations;
+    std::atomic<uint32_t> m_tick{ 0 };
+    // While replaying in real time, the tick follows the clock
+    // between edges, as it would on the machine
+    std::atomic<bool> m_clockRunning{ false };
+    uint32_t m_startTick{ 0 };
+    std::chrono::steady_clock::time_point m_startTime;
+    std::mutex m_writesMutex;
+    std::vector<TraceRecord> m_writes;
+};
+
+} // end namespace
@@ -1,8 +1,34 @@
 #include "rotaryencoder.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace mgo
 {
 
+namespace
+{
+
+// 4x quadrature decoding. Indexed by ( previous state << 2 ) | new state,
+// where state is ( A << 1 ) | B. Going "normal" (forwards) the states run
+// 00 -> 01 -> 11 -> 10 -> 00, i.e. A rises while B is high. We're told
+// about one pin at a time, so both bits can't change at once and those
+// entries (and no change at all, which is dealt with before we get here)
+// are never used.
+constexpr int quadratureTable[ 16 ] = {
+//  new: 00   01   10   11
+          0,   1,  -1,   0,   // was 00
+         -1,   0,   0,   1,   // was 01
+          1,   0,   0,  -1,   // was 10
+          0,  -1,   1,   0    // was 11
+};
+
+// Longest run of edges within one batch before the tracker is brought up
+// to date anyway, so it still sees the speed change if we fall behind
+constexpr int32_t TRACKER_INTERVAL_MICROSECONDS = 1'000;
+
+} // end anonymous namespace
+
 void RotaryEncoder::staticCallback(
     int      pin,
     int      level,
@@ -20,27 +46,113 @@ void RotaryEncoder::callback(
     uint32_t tick
     )
 {
-    if ( pin == m_lastPin )
+    // This runs on pigpio's callback thread, which calls us in batches of
+    // thirty or so edges roughly every millisecond. We do the bare minimum
+    // here: queue the edge and get out. All the interpretation is done on
+    // the consumer side in processEdges().
+    EncoderEdge edge{ tick, static_cast<uint8_t>( pin ), static_cast<uint8_t>( level ) };
+    if( ! m_edges.push( edge ) )
+    {
+        m_overruns.fetch_add( 1, std::memory_order_relaxed );
+    }
+}
+
+void RotaryEncoder::processEdges()
+{
+    std::lock_guard<std::mutex> lock( m_consumerMutex );
+    drainEdges();
+}
+
+void RotaryEncoder::drainEdges()
+{
+    uint32_t overruns = m_overruns.load( std::memory_order_relaxed );
+    if( overruns != m_overrunsSeen )
+    {
+        // Edges have been dropped, so our count within the current
+        // revolution can't be trusted any more. Start again.
+        MGOLOG( "Rotary encoder queue overrun, " << overruns - m_overrunsSeen
+            << " edge(s) lost" );
+        m_overrunsSeen = overruns;
+        m_warmingUp = true;
+        m_levelA = -1;
+        m_levelB = -1;
+        m_indexSeen = false;
+        m_rpmEstimator.reset();
+        m_tracker.reset();
+        m_trackerBehind = false;
+    }
+    // Edges are decoded with integer arithmetic only. The tracker is
+    // floating point, so rather than on every edge it's given the count
+    // as it stands at the end of each batch (or each millisecond's worth
+    // of edges, if a batch is a long one).
+    EncoderEdge edge;
+    while( m_edges.pop( edge ) )
+    {
+        processEdge( edge );
+        if( m_trackerBehind &&
+            static_cast<int32_t>( m_lastTick - m_trackerTick ) >= TRACKER_INTERVAL_MICROSECONDS )
+        {
+            updateTracker();
+        }
+    }
+    if( m_trackerBehind )
+    {
+        updateTracker();
+    }
+}
+
+void RotaryEncoder::updateTracker()
+{
+    m_tracker.update( m_position, m_lastTick );
+    m_trackerTick = m_lastTick;
+    m_trackerBehind = false;
+}
+
+void RotaryEncoder::processEdge( const EncoderEdge& edge )
+{
+    uint32_t tick  = edge.tick;
+    int level = edge.level;
+    if( level > 1 )
     {
-        // debounce
+        // pigpio reports a watchdog timeout as level 2; nothing changed
+        return;
+    }
+
+    if( m_pinIndex != 0 && edge.pin == m_pinIndex )
+    {
+        // The pulse is more than one count wide, so we only use the
+        // leading edge, and only going forwards, to get a repeatable count
+        if( level == 1 && ! m_warmingUp && m_direction == RotationDirection::normal )
+        {
+            processIndexPulse();
+        }
         return;
     }
-    m_lastPin = pin;
 
     if ( m_warmingUp )
     {
-        // We ignore the first few calls until we can
-        // set the previous tick
-        if( pin == m_pinA && level == 1 )
+        // We can't decode anything until we've seen the level of both pins
+        if( edge.pin == m_pinA )
+        {
+            m_levelA = level;
+        }
+        else
+        {
+            m_levelB = level;
+        }
+        if( m_levelA != -1 && m_levelB != -1 )
         {
             m_lastTick = tick;
+            m_rpmEstimator.reset();
+            m_tracker.reset();
+            updateTracker();
             m_warmingUp = false;
         }
         return;
     }
 
-    // Check rotation
-    if ( pin == m_pinA )
+    int previousState = ( m_levelA << 1 ) | m_levelB;
+    if ( edge.pin == m_pinA )
     {
         m_levelA = level;
     }
@@ -48,68 +160,144 @@ void RotaryEncoder::callback(
     {
         m_levelB = level;
     }
-
-    if ( pin == m_pinA && level == 1 )
+    int state = ( m_levelA << 1 ) | m_levelB;
+    if( state == previousState )
     {
-        if ( m_levelB ) m_direction = RotationDirection::normal;
+        // As we are told about one pin at a time, a missed edge shows up
+        // as the same level being reported twice in a row on one pin. We
+        // can't tell which way we moved, so we don't count it.
+        ++m_illegalTransitions;
+        return;
     }
-    else if ( pin == m_pinB && level == 1 )
+    int step = quadratureTable[ ( previousState << 2 ) | state ];
+
+    RotationDirection direction =
+        step > 0 ? RotationDirection::normal : RotationDirection::reversed;
+    if( direction != m_direction )
     {
-        if ( m_levelA ) m_direction = RotationDirection::reversed;
+        // Timing for rpm only makes sense while going one way round
+        m_rpmEstimator.reset();
+        m_direction = direction;
     }
 
-    // Note - we only count one pin's pulses, and measure from
-    // rising edge to next rising edge
-    if( pin == m_pinA && level == 1 )
+    m_rpmEstimator.addEdge( tick );
+    moveCount( step );
+    m_lastTick = tick;
+    m_trackerBehind = true;
+}
+
+void RotaryEncoder::moveCount( int64_t delta )
+{
+    // Bresenham-style: each count moves us Divisor / Numerator of a
+    // revolution, so we accumulate the divisor and wrap round each
+    // time we pass the numerator. All integer, so the zero position is
+    // exact however long we run for.
+    m_position += delta;
+    m_phase += delta * m_countsPerRevDivisor;
+    if( delta == 1 || delta == -1 )
     {
-        ++m_tickCount;
-        // Because of gearing, we have a non-integer number of pulses
-        // per spindle revolution which means as it stands, over five minutes,
-        // our zero position will be off by about 90°. This can be addressed
-        // by altering the gearing, or by countering this in code with the
-        // "leap tick" approach below.
-        uint32_t zeroTick = static_cast<uint32_t>( m_pulsesPerSpindleRev );
-        if( m_leapTickCountdown == 1 )
+        // The usual case, one count at a time. If the divisor is greater
+        // than the numerator we can cross more than one revolution.
+        while( m_phase >= m_countsPerRevNumerator )
         {
-            ++zeroTick;
+            m_phase -= m_countsPerRevNumerator;
         }
-        if( m_tickCount == zeroTick )
+        while( m_phase < 0 )
         {
-            if( m_revolutionsPerLeapTick > 0 )
-            {
-                --m_leapTickCountdown;
-                if( m_leapTickCountdown == 0 )
-                {
-                    m_leapTickCountdown = m_revolutionsPerLeapTick;
-                }
-            }
-            m_averageTickDelta = m_tickDiffTotal / static_cast<float>( zeroTick );
-            m_tickDiffTotal = 0;
-            m_tickCount = 0;
-            // We remember what the tick was at the last zero degrees position
-            // (we arbitrarily call the start position zero) so we can extrapolate
-            // out to the next one for accurate starting when waiting to cut a
-            // thread. Owing to the latency on the callbacks, it's not sufficient
-            // to simply wait for the next zero-degree tick. With the 1 ms latency,
-            // this could result in an inaccuracy of up to 6° at 1,000 rpm.
-            m_lastZeroDegreesTick = tick;
+            m_phase += m_countsPerRevNumerator;
         }
-        m_tickDiffTotal += tick - m_lastTick; // don't need to worry about wrap
-        m_lastTick = tick;
     }
+    else
+    {
+        m_phase %= m_countsPerRevNumerator;
+        if( m_phase < 0 )
+        {
+            m_phase += m_countsPerRevNumerator;
+        }
+    }
+}
 
+void RotaryEncoder::processIndexPulse()
+{
+    // The index pulse is on the encoder's shaft, so it comes round once per
+    // encoder revolution (not spindle revolution, unless the gearing is
+    // 1:1). Either way, the count should be at the same point in the
+    // encoder's revolution every time we see it. If it isn't, we've missed
+    // (or gained) counts, and we put the count back where it should be.
+    const int64_t countsPerEncoderRev = m_pulsesPerRev * 4;
+    int64_t count = m_position % countsPerEncoderRev;
+    if( count < 0 ) count += countsPerEncoderRev;
+    if( ! m_indexSeen )
+    {
+        m_indexSeen = true;
+        m_indexCount = count;
+        MGOLOG( "Rotary encoder index pulse found at count " << count );
+        return;
+    }
+    int64_t drift = count - m_indexCount;
+    // Take the shorter way round
+    if( drift >= countsPerEncoderRev / 2 ) drift -= countsPerEncoderRev;
+    if( drift < -countsPerEncoderRev / 2 ) drift += countsPerEncoderRev;
+    if( drift == 0 ) return;
+
+    moveCount( -drift );
+    m_tracker.shift( -drift );
+    ++m_indexCorrections;
+    MGOLOG( "Rotary encoder index pulse corrected drift of " << drift << " count(s)" );
+}
+
+bool RotaryEncoder::warmingUp()
+{
+    std::lock_guard<std::mutex> lock( m_consumerMutex );
+    drainEdges();
+    return m_warmingUp;
 }
 
 float RotaryEncoder::getRpm()
 {
+    std::lock_guard<std::mutex> lock( m_consumerMutex );
+    drainEdges();
     // Ticks are in microseconds
-    if( warmingUp() ) return 0.f;
-    if( m_gpio.getTick() - m_lastTick > 100'000 ) return 0.f;
-    float rpm = 60'000'000.f / ( m_averageTickDelta * m_pulsesPerSpindleRev );
+    if( m_warmingUp ) return 0.f;
+    float rpm = m_rpmEstimator.getRpm( m_gpio.getTick() );
     if( rpm > 5'000.f ) rpm = 0.f;
     return rpm;
 }
 
+float RotaryEncoder::getRpmVariance()
+{
+    std::lock_guard<std::mutex> lock( m_consumerMutex );
+    drainEdges();
+    if( m_warmingUp ) return 0.f;
+    return m_rpmEstimator.getRpmVariance( m_gpio.getTick() );
+}
+
+float RotaryEncoder::getSpindleAcceleration()
+{
+    std::lock_guard<std::mutex> lock( m_consumerMutex );
+    drainEdges();
+    if( m_warmingUp ) return 0.f;
+    return m_rpmEstimator.getAcceleration( m_gpio.getTick() );
+}
+
+float RotaryEncoder::getWorstCaseRpm( uint32_t latencyMicroseconds, uint32_t& lastEdgeTick )
+{
+    std::lock_guard<std::mutex> lock( m_consumerMutex );
+    drainEdges();
+    lastEdgeTick = m_lastTick;
+    if( m_warmingUp ) return 0.f;
+    uint32_t now = m_gpio.getTick();
+    float rpm = m_rpmEstimator.getRpm( now );
+    uint32_t sinceLastEdge = now - m_lastTick;
+    if( sinceLastEdge > latencyMicroseconds )
+    {
+        float ceiling = 60'000'000.f /
+            ( ( sinceLastEdge - latencyMicroseconds ) * m_countsPerSpindleRev );
+        rpm = std::min( rpm, ceiling );
+    }
+    return rpm;
+}
+
 float RotaryEncoder::getPositionDegrees()
 {
     // There will be latency in this as the pigpio thread which calls back to
@@ -121,38 +309,169 @@ float RotaryEncoder::getPositionDegrees()
 
     // * But it's useful for unit testing :)
 
-    // TODO this only works in one direction currently, we need to
-    // take rotation direction into account
+    std::lock_guard<std::mutex> lock( m_consumerMutex );
+    drainEdges();
+    // m_phase follows the chuck backwards too
+    return 360.f * m_phase / m_countsPerRevNumerator;
+}
 
-    return 360.f * ( m_tickCount / m_pulsesPerSpindleRev );
+int64_t RotaryEncoder::getPositionCount()
+{
+    std::lock_guard<std::mutex> lock( m_consumerMutex );
+    drainEdges();
+    return m_position;
+}
+
+uint64_t RotaryEncoder::getIllegalTransitionCount()
+{
+    std::lock_guard<std::mutex> lock( m_consumerMutex );
+    drainEdges();
+    return m_illegalTransitions;
+}
+
+uint64_t RotaryEncoder::getIndexCorrectionCount()
+{
+    std::lock_guard<std::mutex> lock( m_consumerMutex );
+    drainEdges();
+    return m_indexCorrections;
 }
 
 RotationDirection RotaryEncoder::getRotationDirection()
 {
+    std::lock_guard<std::mutex> lock( m_consumerMutex );
+    drainEdges();
     return m_direction;
 }
 
-void  RotaryEncoder::callbackAtZeroDegrees(
+SpindleState RotaryEncoder::getSpindleStateAt( uint32_t tick )
+{
+    std::lock_guard<std::mutex> lock( m_consumerMutex );
+    drainEdges();
+    TrackerEstimate estimate = m_tracker.estimateAt( tick );
+    if( m_warmingUp || ! estimate.valid )
+    {
+        return { 0.f, 0.f, 0.f, false };
+    }
+    double revolutions = estimate.position / m_countsPerSpindleRev;
+    // velocity is in counts per microsecond
+    return {
+        static_cast<float>( 360.0 * ( revolutions - std::floor( revolutions ) ) ),
+        static_cast<float>( estimate.velocity * 60'000'000.0 / m_countsPerSpindleRev ),
+        static_cast<float>( 360.0 * estimate.uncertainty / m_countsPerSpindleRev ),
+        true
+    };
+}
+
+bool RotaryEncoder::nextAnglePosition( double angle, double& position )
+{
+    std::lock_guard<std::mutex> lock( m_consumerMutex );
+    drainEdges();
+    if( m_warmingUp ) return false;
+    TrackerEstimate estimate = m_tracker.estimateAt( m_gpio.getTick() );
+    if( ! estimate.valid || estimate.velocity <= 0.0 )
+    {
+        // Not turning, or turning backwards
+        return false;
+    }
+    // We advance the target by the configured amount, so look for the first
+    // time we'll be at the angle that's at least that far ahead of now
+    double angleCounts =
+        m_countsPerSpindleRev * ( angle - 360.0 * std::floor( angle / 360.0 ) ) / 360.0;
+    double advanceCounts = m_advanceValueMicroseconds * estimate.velocity;
+    double nextRevolution = std::floor(
+        ( estimate.position + advanceCounts - angleCounts ) / m_countsPerSpindleRev ) + 1.0;
+    position = nextRevolution * m_countsPerSpindleRev + angleCounts;
+    return true;
+}
+
+bool RotaryEncoder::tickAtPosition( double position, uint32_t& tick )
+{
+    std::lock_guard<std::mutex> lock( m_consumerMutex );
+    drainEdges();
+    if( m_warmingUp ) return false;
+    TrackerEstimate estimate = m_tracker.estimateAt( m_gpio.getTick() );
+    if( ! estimate.valid || estimate.velocity <= 0.0 ) return false;
+    return m_tracker.tickAtPosition( position, tick );
+}
+
+bool RotaryEncoder::getEstimatedCount( uint32_t tick, double& count )
+{
+    std::lock_guard<std::mutex> lock( m_consumerMutex );
+    drainEdges();
+    if( m_warmingUp ) return false;
+    TrackerEstimate estimate = m_tracker.estimateAt( tick );
+    count = estimate.position;
+    return estimate.valid;
+}
+
+bool RotaryEncoder::nextCountAtDegrees(
+    double   angle,
+    uint32_t leadMicroseconds,
+    int64_t& count
+    )
+{
+    std::lock_guard<std::mutex> lock( m_consumerMutex );
+    drainEdges();
+    if( m_warmingUp ) return false;
+    TrackerEstimate estimate = m_tracker.estimateAt( m_gpio.getTick() );
+    if( ! estimate.valid || estimate.velocity <= 0.0 ) return false;
+    // In units of 1 / Divisor of a count, m_position * Divisor is always
+    // m_phase plus a whole number of revolutions of Numerator each, so
+    // angle A in revolution k comes at k * Numerator + A * Numerator / 360. We want
+    // the first whole count at or past that, which is at least as far
+    // ahead as the earliest count we could get to in time.
+    const int64_t n = m_countsPerRevNumerator;
+    const int64_t d = m_countsPerRevDivisor;
+    int64_t earliest = static_cast<int64_t>(
+        std::ceil( estimate.position + estimate.velocity * leadMicroseconds ) );
+    int64_t angleUnits = std::llround(
+        ( angle - 360.0 * std::floor( angle / 360.0 ) ) / 360.0 * n ) % n;
+    auto floorDiv = []( int64_t a, int64_t b )
+        {
+            return a / b - ( ( a % b != 0 ) && ( ( a < 0 ) != ( b < 0 ) ) );
+        };
+    int64_t revolution = floorDiv( ( earliest - 1 ) * d - angleUnits, n ) + 1;
+    count = -floorDiv( -( revolution * n + angleUnits ), d );
+    return true;
+}
+
+std::future<bool> RotaryEncoder::callbackAtDegrees(
+    double                angle,
     std::function<void()> cb
     )
 {
-    // We just need to start threading operations at a
-    // repeatable rotational position each time, so we
-    // arbitrarily choose zero.
+    // We need to start threading operations at a repeatable rotational
+    // position each time. For single-start threads we arbitrarily choose
+    // zero; multi-start threads offset each start by 360/N degrees.
     // Because there is a latency on the callback (the pigpio
-    // library batches up the callbacks), we interpolate here
-    // for better accuracy.
-    if( m_warmingUp ) return; // spindle not running?
-    while( m_lastZeroDegreesTick == 0 ); // spin if the last pos isn't set yet
-    uint32_t timeForOneRevolution = m_averageTickDelta * m_pulsesPerSpindleRev;
-    uint32_t targetTick = m_lastZeroDegreesTick +
-        ( timeForOneRevolution - m_advanceValueMicroseconds );
-    while( m_gpio.getTick() > targetTick )
-    {
-        targetTick += timeForOneRevolution;
-    }
-    // Now spin until we get to the right time
-    while( m_gpio.getTick() < targetTick );
-    cb();
+    // library batches up the callbacks), it's not sufficient to
+    // simply wait for the edge at that angle. With the 1 ms latency,
+    // this could result in an inaccuracy of up to 6° at 1,000 rpm.
+    // Instead we ask the tracker when the spindle will reach the
+    // angle, based on its current position and speed.
+    if( warmingUp() ) // spindle not running?
+    {
+        std::promise<bool> notRun;
+        notRun.set_value( false );
+        return notRun.get_future();
+    }
+    bool   haveTarget = false;
+    double targetPosition = 0.0;
+    return m_scheduler.schedule(
+        [ this, angle, haveTarget, targetPosition ]( uint32_t& tick ) mutable
+            {
+                // We pick which revolution to aim for once, then
+                // keep refining when we'll get there as more edges arrive
+                if( ! haveTarget )
+                {
+                    haveTarget = nextAnglePosition( angle, targetPosition );
+                    if( ! haveTarget ) return false;
+                }
+                if( ! tickAtPosition( targetPosition, tick ) ) return false;
+                tick -= static_cast<uint32_t>( m_advanceValueMicroseconds );
+                return true;
+            },
+        std::move( cb )
+        );
 }
 } // end namespace
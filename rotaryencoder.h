@@ -3,11 +3,19 @@
 // encoder which measures the lathe's spindle rotation.
 
 #include "stepperControl/igpio.h"
+#include "alphabetatracker.h"
+#include "deadlinescheduler.h"
+#include "iindexpin.h"
 #include "log.h"
+#include "rpmestimator.h"
+#include "spscring.h"
 
 #include <atomic>
 #include <cstdint>
 #include <functional>
+#include <future>
+#include <mutex>
+#include <numeric>
 #include <ostream>
 
 namespace mgo
@@ -19,6 +27,22 @@ enum class RotationDirection
     reversed
 };
 
+struct SpindleState
+{
+    float angleDegrees;       // 0 - 360
+    float rpm;                // negative if turning backwards
+    float uncertaintyDegrees; // approx one standard deviation
+    bool  valid;
+};
+
+// One GPIO level change as delivered by the pigpio callback
+struct EncoderEdge
+{
+    uint32_t tick;
+    uint8_t  pin;
+    uint8_t  level;
+};
+
 class RotaryEncoder
 {
 public:
@@ -27,24 +51,30 @@ public:
         int     pinA,
         int     pinB,
         int     pulsesPerRev, // of the RE, not spindle
-        float   gearing
+        long    gearingNumerator,
+        long    gearingDivisor,
+        int     pinIndex = 0  // optional once-per-rev (Z) pulse, 0 = none
         )
         :
         m_gpio( gpio ),
         m_pinA( pinA ),
         m_pinB( pinB ),
-        m_pulsesPerRev( pulsesPerRev ),
-        m_gearing( gearing ),
-        m_revolutionsPerLeapTick( 0 )
+        m_pinIndex( pinIndex ),
+        m_pulsesPerRev( pulsesPerRev )
     {
-        m_pulsesPerSpindleRev = m_pulsesPerRev * m_gearing;
-        float remainder = m_pulsesPerSpindleRev - static_cast<int>( m_pulsesPerSpindleRev );
-        if( remainder > 0.01f )
-        {
-            m_revolutionsPerLeapTick = 1.f / remainder;
-            MGOLOG( "Revolutions per leap tick = " << m_revolutionsPerLeapTick );
-        }
-        m_leapTickCountdown = m_revolutionsPerLeapTick;
+        // We decode every edge on both pins ("4x" quadrature decoding)
+        // so there are four counts per pulse. Because of gearing, that
+        // generally gives a non-integer number of counts per spindle
+        // revolution, so we keep it as an exact ratio.
+        m_countsPerRevNumerator = 4LL * m_pulsesPerRev * gearingNumerator;
+        m_countsPerRevDivisor   = gearingDivisor;
+        int64_t divisor = std::gcd( m_countsPerRevNumerator, m_countsPerRevDivisor );
+        m_countsPerRevNumerator /= divisor;
+        m_countsPerRevDivisor   /= divisor;
+        // Only used for estimates, never for placing the zero position
+        m_countsPerSpindleRev =
+            static_cast<double>( m_countsPerRevNumerator ) / m_countsPerRevDivisor;
+        m_rpmEstimator = RpmEstimator( m_countsPerSpindleRev );
 
         m_gpio.setRotaryEncoderCallback(
             m_pinA,
@@ -52,6 +82,20 @@ public:
             staticCallback,
             this
             );
+        if( m_pinIndex != 0 )
+        {
+            // The index pin has its own registration, if the gpio can do
+            // it. Its edges arrive through the same callback (and queue)
+            // as the A and B edges, in the right order relative to them.
+            IIndexPin* indexPin = dynamic_cast<IIndexPin*>( &m_gpio );
+            if( indexPin == nullptr
+                || ! indexPin->setIndexPinCallback( m_pinIndex, staticCallback, this ) )
+            {
+                MGOLOG( "Can't watch rotary encoder index pin " << m_pinIndex
+                    << ", so it won't be used" );
+                m_pinIndex = 0;
+            }
+        }
     }
 
     static void staticCallback(
@@ -67,46 +111,177 @@ public:
         uint32_t tick
         );
 
+    // Drains any edges queued by the callback and updates the derived
+    // values (rpm, angle, direction). The getters below call this, but
+    // it can also be called periodically to stop the queue filling up.
+    void processEdges();
+
+    // Worked out from the last few milliseconds of edges (see
+    // setRpmWindow()) so it follows speed changes within the revolution
     float getRpm();
+    // Spread of the individual readings behind getRpm(), in rpm squared
+    float getRpmVariance();
+    // Positive when speeding up, in rpm per second
+    float getSpindleAcceleration();
+    // As getRpm(), but if the next edge is overdue (allowing for the given
+    // delivery latency) the spindle can be going no faster than one count
+    // in the time since the last one, so we return that if it's lower.
+    // This notices a sudden stall well before getRpm() goes stale.
+    float getWorstCaseRpm( uint32_t latencyMicroseconds, uint32_t& lastEdgeTick );
     float getPositionDegrees();
     RotationDirection getRotationDirection();
+    // Signed count of quadrature edges since warm-up finished.
+    // Four counts per encoder pulse.
+    int64_t getPositionCount();
+    // Spindle angle and speed at the given gpio tick (which can be in
+    // the future), interpolated from the edge stream by a tracker so
+    // it's good to a fraction of a count
+    SpindleState getSpindleStateAt( uint32_t tick );
+    // Number of times a pin was reported at the level it was already at,
+    // which means we missed an edge. These don't alter the position count.
+    uint64_t getIllegalTransitionCount();
+    // Number of times an index pulse found the count had drifted
+    uint64_t getIndexCorrectionCount();
 
-    void  callbackAtZeroDegrees(
+    // The tracker's estimate of the (fractional) position count at the
+    // given tick. Returns false if it hasn't got one.
+    bool getEstimatedCount( uint32_t tick, double& count );
+    // When the spindle will reach (or did reach) the given position
+    // count. Returns false if it isn't turning forwards.
+    bool tickAtPosition( double position, uint32_t& tick );
+    // The first count, at least leadMicroseconds from now, at which the
+    // spindle reaches the given angle. This is worked out exactly from the
+    // gearing, so it's the same point in the revolution every time.
+    // Returns false if the spindle isn't turning forwards.
+    bool nextCountAtDegrees(
+        double   angle,
+        uint32_t leadMicroseconds,
+        int64_t& count
+        );
+    int64_t getCountsPerRevNumerator() const
+    {
+        return m_countsPerRevNumerator;
+    }
+    int64_t getCountsPerRevDivisor() const
+    {
+        return m_countsPerRevDivisor;
+    }
+
+    // Runs cb on the scheduler thread when the spindle next reaches the
+    // given angle. The future becomes true once cb has run, or false if
+    // the spindle isn't turning or the request is cancelled.
+    std::future<bool> callbackAtDegrees(
+        double                angle,
         std::function<void()> cb
         );
 
+    std::future<bool> callbackAtZeroDegrees(
+        std::function<void()> cb
+        )
+    {
+        return callbackAtDegrees( 0.0, std::move( cb ) );
+    }
+
+    // Abandons any callbacks which haven't run yet
+    void cancelCallbacks()
+    {
+        m_scheduler.cancelAll();
+    }
+
+    DeadlineScheduler& getScheduler()
+    {
+        return m_scheduler;
+    }
+
+    void setRpmWindow( std::size_t edges, uint32_t microseconds )
+    {
+        std::lock_guard<std::mutex> lock( m_consumerMutex );
+        m_rpmEstimator.setWindow( edges, microseconds );
+    }
+
+    void setRpmFilter( RpmFilter filter )
+    {
+        std::lock_guard<std::mutex> lock( m_consumerMutex );
+        m_rpmEstimator.setFilter( filter );
+    }
+
     void setAdvanceValueMicroseconds( float value )
     {
         m_advanceValueMicroseconds = value;
     }
+    float getAdvanceValueMicroseconds() const
+    {
+        return m_advanceValueMicroseconds;
+    }
 
-    bool warmingUp()
+    bool warmingUp();
+
+    // Number of edges dropped because the queue was full
+    uint32_t getOverrunCount() const
     {
-        return m_warmingUp;
+        return m_overruns.load( std::memory_order_relaxed );
     }
 
 private:
+    // These must be called with m_consumerMutex held
+    void drainEdges();
+    void processEdge( const EncoderEdge& edge );
+    void processIndexPulse();
+    // Gives the tracker the count at the latest edge
+    void updateTracker();
+    // Moves the count, keeping track of the angle within the revolution
+    void moveCount( int64_t delta );
+    // Not this one: it's used from the scheduler thread, and takes the
+    // lock itself
+    bool nextAnglePosition( double angle, double& position );
+
     IGpio&   m_gpio;
     int      m_pinA;
     int      m_pinB;
-    int      m_levelA;
-    int      m_levelB;
-    int      m_lastPin{ 0 };
+    int      m_pinIndex;
     int      m_pulsesPerRev; // of RE
-    float    m_pulsesPerSpindleRev;
-    float    m_gearing;
+    // Counts per spindle revolution is exactly Numerator / Divisor
+    int64_t  m_countsPerRevNumerator;
+    int64_t  m_countsPerRevDivisor;
+    double   m_countsPerSpindleRev;
+
+    // The callback (producer) side touches nothing but these two:
+    SpscRing<EncoderEdge, 8192> m_edges;
+    std::atomic<uint32_t> m_overruns{ 0 };
+
+    // Everything below is consumer-side state, only ever touched
+    // with m_consumerMutex held (in practice, from processEdges())
+    std::mutex m_consumerMutex;
+    uint32_t m_overrunsSeen{ 0 };
+    int      m_levelA{ -1 }; // -1 = not seen yet
+    int      m_levelB{ -1 };
     bool     m_warmingUp{ true };
-    uint32_t m_lastTick;
-    std::atomic<uint32_t> m_lastZeroDegreesTick{ 0 }; // TODO other members need to be atomic too
-    uint32_t m_tickCount{ 0 };
-    uint32_t m_tickDiffTotal{ 0 };
-    float    m_averageTickDelta{ 0.f };
-    RotationDirection m_direction;
-    float    m_advanceValueMicroseconds{ 0.f };
-    // Values to deal with a non-integer number of ticks per
-    // spindle revolution (owing to gearing)
-    int      m_leapTickCountdown;
-    int      m_revolutionsPerLeapTick;
+    uint32_t m_lastTick{ 0 };
+    int64_t  m_position{ 0 };
+    // Where we are within the spindle's revolution, scaled by the
+    // divisor, so the angle is exactly 360 * m_phase /
+    // m_countsPerRevNumerator. Always in the range 0 to
+    // m_countsPerRevNumerator - 1.
+    int64_t  m_phase{ 0 };
+    uint64_t m_illegalTransitions{ 0 };
+    // Where in the encoder's own revolution (in counts) the index
+    // pulse was first seen, once it has been. Forgotten if edges are
+    // lost, as the count could then be out by any amount.
+    bool     m_indexSeen{ false };
+    int64_t  m_indexCount{ 0 };
+    uint64_t m_indexCorrections{ 0 };
+    RpmEstimator m_rpmEstimator{ 1.0 };
+    AlphaBetaTracker m_tracker;
+    // Whether there have been edges since the tracker was last given
+    // the count, and the tick it was given it at
+    bool     m_trackerBehind{ false };
+    uint32_t m_trackerTick{ 0 };
+    RotationDirection m_direction{ RotationDirection::normal };
+    std::atomic<float> m_advanceValueMicroseconds{ 0.f };
+
+    // Declared last so its thread is stopped before anything
+    // it might call back into is destroyed
+    DeadlineScheduler m_scheduler{ m_gpio };
 };
 
 } // end namespace
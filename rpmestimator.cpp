@@ -0,0 +1,161 @@
+#include "rpmestimator.h"
+
+#include <algorithm>
+
+namespace mgo
+{
+
+namespace
+{
+
+// With no edges for this long, we say the spindle has stopped
+constexpr int32_t STALE_MICROSECONDS = 100'000;
+
+// We always use at least this many edges (two quadrature
+// cycles' worth of samples) however old they are
+constexpr std::size_t MIN_EDGES = 9;
+
+// Proportion of samples discarded from each end when trimming
+constexpr std::size_t TRIM_DIVISOR = 10;
+
+} // end anonymous namespace
+
+void RpmEstimator::setWindow( std::size_t edges, uint32_t microseconds )
+{
+    m_windowEdges = std::clamp( edges, MIN_EDGES, MAX_EDGES );
+    m_windowMicroseconds = microseconds;
+    m_statsValid = false;
+}
+
+void RpmEstimator::addEdge( uint32_t tick )
+{
+    m_ticks[ m_next ] = tick;
+    m_next = ( m_next + 1 ) % MAX_EDGES;
+    if( m_count < MAX_EDGES )
+    {
+        ++m_count;
+    }
+    m_statsValid = false;
+}
+
+RpmEstimator::Stats RpmEstimator::calculate( uint32_t now ) const
+{
+    if( m_count < 5 ) return { 0.f, 0.f, 0.f };
+    uint32_t newest = m_ticks[ ( m_next + MAX_EDGES - 1 ) % MAX_EDGES ];
+    if( static_cast<int32_t>( now - newest ) > STALE_MICROSECONDS ) return { 0.f, 0.f, 0.f };
+    if( ! m_statsValid )
+    {
+        m_stats = calculateFromEdges();
+        m_statsValid = true;
+    }
+    return m_stats;
+}
+
+RpmEstimator::Stats RpmEstimator::calculateFromEdges() const
+{
+    const Stats stopped{ 0.f, 0.f, 0.f };
+    // n = 0 is the most recent tick
+    auto tickAt = [ this ]( std::size_t n )
+        {
+            return m_ticks[ ( m_next + MAX_EDGES - 1 - n ) % MAX_EDGES ];
+        };
+    uint32_t newest = tickAt( 0 );
+
+    std::size_t edges = std::min( m_count, m_windowEdges );
+    std::size_t used = 1;
+    while( used < edges )
+    {
+        if( used >= MIN_EDGES && newest - tickAt( used ) > m_windowMicroseconds ) break;
+        ++used;
+    }
+
+    // Each sample is one full quadrature cycle, i.e. four counts
+    struct Sample
+    {
+        float seconds; // relative to the newest edge
+        float rpm;
+    };
+    std::array<Sample, MAX_EDGES> samples;
+    std::size_t sampleCount = 0;
+    for( std::size_t n = 0; n + 4 < used; ++n )
+    {
+        uint32_t cycle = tickAt( n ) - tickAt( n + 4 );
+        if( cycle == 0 ) continue;
+        samples[ sampleCount ].seconds =
+            - static_cast<float>( newest - tickAt( n ) ) / 1'000'000.f;
+        samples[ sampleCount ].rpm =
+            static_cast<float>( 4.0 * 60'000'000.0 / ( cycle * m_countsPerRev ) );
+        ++sampleCount;
+    }
+    if( sampleCount == 0 ) return stopped;
+
+    // Outlier rejection: ignore the extremes. We don't need them in
+    // order, only the middle ones separated from the rest, which
+    // nth_element does without a full sort.
+    auto byRpm = []( const Sample& a, const Sample& b ){ return a.rpm < b.rpm; };
+    std::size_t trim = sampleCount / TRIM_DIVISOR;
+    std::size_t first = trim;
+    std::size_t last = sampleCount - trim; // one past
+    auto begin = samples.begin();
+    std::nth_element( begin, begin + first, begin + sampleCount, byRpm );
+    std::nth_element( begin + first, begin + last - 1, begin + sampleCount, byRpm );
+    float kept = static_cast<float>( last - first );
+
+    float meanRpm = 0.f;
+    float meanSeconds = 0.f;
+    for( std::size_t n = first; n < last; ++n )
+    {
+        meanRpm += samples[ n ].rpm;
+        meanSeconds += samples[ n ].seconds;
+    }
+    meanRpm /= kept;
+    meanSeconds /= kept;
+
+    float variance = 0.f;
+    float covariance = 0.f;
+    float timeVariance = 0.f;
+    for( std::size_t n = first; n < last; ++n )
+    {
+        float dr = samples[ n ].rpm - meanRpm;
+        float dt = samples[ n ].seconds - meanSeconds;
+        variance += dr * dr;
+        covariance += dr * dt;
+        timeVariance += dt * dt;
+    }
+    variance /= kept;
+
+    Stats stats;
+    if( m_filter == RpmFilter::Median )
+    {
+        // The median is always among the ones we kept
+        auto middle = begin + sampleCount / 2;
+        std::nth_element( begin + first, middle, begin + last, byRpm );
+        stats.rpm = ( sampleCount % 2 ) ? middle->rpm :
+            ( std::max_element( begin + first, middle, byRpm )->rpm + middle->rpm ) / 2.f;
+    }
+    else
+    {
+        stats.rpm = meanRpm;
+    }
+    stats.variance = variance;
+    // Least-squares slope of rpm against time
+    stats.acceleration = timeVariance > 0.f ? covariance / timeVariance : 0.f;
+    return stats;
+}
+
+float RpmEstimator::getRpm( uint32_t now ) const
+{
+    return calculate( now ).rpm;
+}
+
+float RpmEstimator::getRpmVariance( uint32_t now ) const
+{
+    return calculate( now ).variance;
+}
+
+float RpmEstimator::getAcceleration( uint32_t now ) const
+{
+    return calculate( now ).acceleration;
+}
+
+} // end namespace
@@ -0,0 +1,80 @@
+#pragma once
+// Works out spindle speed from the most recent encoder edges, rather than
+// once per revolution. Each sample is the time taken for a full quadrature
+// cycle (four counts), which cancels out any unevenness in the spacing of
+// the A and B edges. Samples spoilt by bounce or a late callback are
+// rejected before averaging.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace mgo
+{
+
+enum class RpmFilter
+{
+    Median,
+    TrimmedMean
+};
+
+class RpmEstimator
+{
+public:
+    static constexpr std::size_t MAX_EDGES = 512;
+
+    explicit RpmEstimator( double countsPerRev )
+        : m_countsPerRev( countsPerRev ) {}
+
+    // The window is the most recent "edges" edges, less any older than
+    // "microseconds" before the latest one (but always at least a couple
+    // of quadrature cycles, so we still get a reading at low speed)
+    void setWindow( std::size_t edges, uint32_t microseconds );
+    void setFilter( RpmFilter filter )
+    {
+        m_filter = filter;
+        m_statsValid = false;
+    }
+
+    void reset()
+    {
+        m_count = 0;
+        m_statsValid = false;
+    }
+
+    // Call once for each count, all in the same direction (reset()
+    // when the direction changes)
+    void addEdge( uint32_t tick );
+
+    // All of these return zero if there have been no edges recently.
+    // They're worked out when first asked for after an edge arrives, and
+    // kept until the next one, so calling them often is cheap.
+    float getRpm( uint32_t now ) const;
+    float getRpmVariance( uint32_t now ) const; // rpm squared
+    float getAcceleration( uint32_t now ) const; // rpm per second
+
+private:
+    struct Stats
+    {
+        float rpm;
+        float variance;
+        float acceleration;
+    };
+    Stats calculate( uint32_t now ) const;
+    // Everything but the staleness check, which depends on the time
+    Stats calculateFromEdges() const;
+
+    double      m_countsPerRev;
+    std::size_t m_windowEdges{ 64 };
+    uint32_t    m_windowMicroseconds{ 20'000 };
+    RpmFilter   m_filter{ RpmFilter::TrimmedMean };
+    std::array<uint32_t, MAX_EDGES> m_ticks{};
+    std::size_t m_next{ 0 };  // where the next tick goes
+    std::size_t m_count{ 0 }; // how many are valid
+    // What calculateFromEdges() last came up with, if nothing has
+    // changed since
+    mutable bool  m_statsValid{ false };
+    mutable Stats m_stats{ 0.f, 0.f, 0.f };
+};
+
+} // end namespace
@@ -0,0 +1,90 @@
+#include "spindlemonitor.h"
+
+#include "log.h"
+
+#include <chrono>
+#include <pthread.h>
+
+namespace mgo
+{
+
+SpindleMonitor::SpindleMonitor(
+    IGpio&         gpio,
+    RotaryEncoder& encoder,
+    Reaction       reaction,
+    uint32_t       pollMicroseconds,
+    uint32_t       edgeLatencyMicroseconds
+    )
+    : m_gpio( gpio ),
+      m_encoder( encoder ),
+      m_reaction( std::move( reaction ) ),
+      m_pollMicroseconds( pollMicroseconds ),
+      m_edgeLatencyMicroseconds( edgeLatencyMicroseconds )
+{
+    m_thread = std::thread( &SpindleMonitor::threadFunction, this );
+    // There's no point spotting a stall quickly if we then have to wait
+    // for the GUI to get out of the way. As ever, this only works as root.
+    sched_param param;
+    param.sched_priority = sched_get_priority_max( SCHED_FIFO ) - 1;
+    if( pthread_setschedparam( m_thread.native_handle(), SCHED_FIFO, &param ) != 0 )
+    {
+        MGOLOG( "Could not set realtime priority for spindle monitor" );
+    }
+}
+
+SpindleMonitor::~SpindleMonitor()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_quit = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+}
+
+void SpindleMonitor::configure( float dropPercent, uint32_t windowMicroseconds, float minimumRpm )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_detector.configure( dropPercent, windowMicroseconds, minimumRpm );
+}
+
+void SpindleMonitor::threadFunction()
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    while( ! m_cv.wait_for(
+        lock,
+        std::chrono::microseconds( m_pollMicroseconds ),
+        [&](){ return m_quit; } ) )
+    {
+        poll();
+    }
+}
+
+void SpindleMonitor::poll()
+{
+    // Called with m_mutex held
+    uint32_t lastEdge = 0;
+    float rpm = m_encoder.getWorstCaseRpm( m_edgeLatencyMicroseconds, lastEdge );
+    uint32_t detected = m_gpio.getTick();
+    if( ! m_detector.update( detected, rpm ) ) return;
+
+    if( ! m_reaction() )
+    {
+        MGOLOG( "Spindle droop from " << m_detector.getReferenceRpm() << " to "
+            << rpm << " rpm, nothing to do" );
+        return;
+    }
+    uint32_t done = m_gpio.getTick();
+    uint32_t latency = done - lastEdge;
+    m_lastLatency = latency;
+    if( latency > m_worstLatency )
+    {
+        m_worstLatency = latency;
+    }
+    MGOLOG( "Spindle droop from " << m_detector.getReferenceRpm() << " to "
+        << rpm << " rpm, reacted " << latency << " us after the last edge ("
+        << detected - lastEdge << " us to detect, " << done - detected
+        << " us to react)" );
+}
+
+} // end namespace
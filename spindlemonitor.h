@@ -0,0 +1,73 @@
+#pragma once
+// Keeps an eye on the spindle speed from a thread of its own, polling the
+// encoder every millisecond or so (far more often than the main loop runs)
+// and reacting when the StallDetector trips. What the reaction is, is up to
+// the owner. Each time it fires, we log how long it took from the last
+// encoder edge we had to the reaction being complete, to help with tuning.
+
+#include "rotaryencoder.h"
+#include "stalldetector.h"
+#include "stepperControl/igpio.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace mgo
+{
+
+class SpindleMonitor
+{
+public:
+    // Return false if there was nothing to do (e.g. no motors were moving)
+    using Reaction = std::function<bool()>;
+
+    SpindleMonitor(
+        IGpio&         gpio,
+        RotaryEncoder& encoder,
+        Reaction       reaction,
+        uint32_t       pollMicroseconds = 1'000,
+        // pigpio delivers edges in batches, so we allow this long for
+        // them to arrive before deciding the next edge is overdue
+        uint32_t       edgeLatencyMicroseconds = 2'000
+        );
+    ~SpindleMonitor();
+
+    SpindleMonitor( const SpindleMonitor& ) = delete;
+    SpindleMonitor& operator=( const SpindleMonitor& ) = delete;
+
+    void configure( float dropPercent, uint32_t windowMicroseconds, float minimumRpm );
+
+    // From the last encoder edge to the reaction being complete, for the
+    // most recent reaction and the worst so far, in microseconds
+    uint32_t getLastLatencyMicroseconds() const
+    {
+        return m_lastLatency;
+    }
+    uint32_t getWorstLatencyMicroseconds() const
+    {
+        return m_worstLatency;
+    }
+
+private:
+    void threadFunction();
+    void poll();
+
+    IGpio&         m_gpio;
+    RotaryEncoder& m_encoder;
+    Reaction       m_reaction;
+    uint32_t       m_pollMicroseconds;
+    uint32_t       m_edgeLatencyMicroseconds;
+    StallDetector  m_detector;
+    std::atomic<uint32_t> m_lastLatency{ 0 };
+    std::atomic<uint32_t> m_worstLatency{ 0 };
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_quit{ false };
+    std::thread m_thread;
+};
+
+} // end namespace
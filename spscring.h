@@ -0,0 +1,73 @@
+#pragma once
+// A fixed-size, lock-free ring buffer for exactly one producer thread
+// and exactly one consumer thread. Used to hand data from time-critical
+// callbacks (e.g. the pigpio alert thread) to the rest of the program
+// without either side ever blocking the other.
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace mgo
+{
+
+template<typename T, std::size_t Capacity>
+class SpscRing
+{
+    static_assert( Capacity > 0 && ( Capacity & ( Capacity - 1 ) ) == 0,
+        "SpscRing capacity must be a power of two" );
+public:
+    // Producer side only. Returns false, and drops the item, if the
+    // consumer has fallen so far behind that the ring is full.
+    bool push( const T& item )
+    {
+        const std::size_t head = m_head.load( std::memory_order_relaxed );
+        if( head - m_cachedTail >= Capacity )
+        {
+            // Only go to the shared index when our cached copy says
+            // we're full - this keeps the common case to a single
+            // store on the producer's own cache line.
+            m_cachedTail = m_tail.load( std::memory_order_acquire );
+            if( head - m_cachedTail >= Capacity )
+            {
+                return false;
+            }
+        }
+        m_buffer[ head & ( Capacity - 1 ) ] = item;
+        m_head.store( head + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Consumer side only. Returns false if there is nothing to read.
+    bool pop( T& item )
+    {
+        const std::size_t tail = m_tail.load( std::memory_order_relaxed );
+        if( tail == m_cachedHead )
+        {
+            m_cachedHead = m_head.load( std::memory_order_acquire );
+            if( tail == m_cachedHead )
+            {
+                return false;
+            }
+        }
+        item = m_buffer[ tail & ( Capacity - 1 ) ];
+        m_tail.store( tail + 1, std::memory_order_release );
+        return true;
+    }
+
+    constexpr std::size_t capacity() const
+    {
+        return Capacity;
+    }
+
+private:
+    // Producer and consumer indices live on separate cache lines
+    // so the two threads don't fight over them
+    alignas( 64 ) std::atomic<std::size_t> m_head{ 0 };
+    std::size_t m_cachedTail{ 0 }; // producer's view of m_tail
+    alignas( 64 ) std::atomic<std::size_t> m_tail{ 0 };
+    std::size_t m_cachedHead{ 0 }; // consumer's view of m_head
+    alignas( 64 ) std::array<T, Capacity> m_buffer{};
+};
+
+} // end namespace
@@ -0,0 +1,64 @@
+#include "stalldetector.h"
+
+namespace mgo
+{
+
+StallDetector::StallDetector(
+    float    dropPercent,
+    uint32_t windowMicroseconds,
+    float    minimumRpm
+    )
+{
+    configure( dropPercent, windowMicroseconds, minimumRpm );
+}
+
+void StallDetector::configure( float dropPercent, uint32_t windowMicroseconds, float minimumRpm )
+{
+    m_dropPercent = dropPercent;
+    m_windowMicroseconds = windowMicroseconds;
+    m_minimumRpm = minimumRpm;
+    reset();
+}
+
+void StallDetector::reset()
+{
+    m_first = 0;
+    m_count = 0;
+}
+
+bool StallDetector::update( uint32_t tick, float rpm )
+{
+    // Forget anything older than the window
+    while( m_count > 0 && tick - m_samples[ m_first ].tick > m_windowMicroseconds )
+    {
+        m_first = ( m_first + 1 ) % MAX_SAMPLES;
+        --m_count;
+    }
+    float highest = 0.f;
+    for( std::size_t n = 0; n < m_count; ++n )
+    {
+        float sampleRpm = m_samples[ ( m_first + n ) % MAX_SAMPLES ].rpm;
+        if( sampleRpm > highest ) highest = sampleRpm;
+    }
+
+    if( highest >= m_minimumRpm && rpm < highest * ( 1.f - m_dropPercent / 100.f ) )
+    {
+        m_referenceRpm = highest;
+        reset();
+        m_samples[ 0 ] = { tick, rpm };
+        m_count = 1;
+        return true;
+    }
+
+    if( m_count == MAX_SAMPLES )
+    {
+        // Being fed faster than expected; lose the oldest
+        m_first = ( m_first + 1 ) % MAX_SAMPLES;
+        --m_count;
+    }
+    m_samples[ ( m_first + m_count ) % MAX_SAMPLES ] = { tick, rpm };
+    ++m_count;
+    return false;
+}
+
+} // end namespace
@@ -0,0 +1,55 @@
+#pragma once
+// Spots the spindle slowing down sharply, e.g. because the tool has dug in
+// or the motor is stalling, while there's still time to do something about
+// it. It's fed the spindle speed at regular intervals and trips when the
+// speed falls by more than a set percentage of the highest speed seen in
+// the last few milliseconds.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace mgo
+{
+
+class StallDetector
+{
+public:
+    StallDetector(
+        float    dropPercent = 20.f,
+        uint32_t windowMicroseconds = 5'000,
+        float    minimumRpm = 30.f  // below this we say the spindle is stopped
+        );
+
+    void configure( float dropPercent, uint32_t windowMicroseconds, float minimumRpm );
+    void reset();
+
+    // Returns true when the speed has just dropped by more than the
+    // configured amount. Having tripped, it starts afresh from the new
+    // speed, so it won't trip again unless there's a further drop.
+    bool update( uint32_t tick, float rpm );
+
+    // The speed the drop was measured from, the last time we tripped
+    float getReferenceRpm() const
+    {
+        return m_referenceRpm;
+    }
+
+private:
+    struct Sample
+    {
+        uint32_t tick;
+        float    rpm;
+    };
+    static constexpr std::size_t MAX_SAMPLES = 256;
+
+    float    m_dropPercent;
+    uint32_t m_windowMicroseconds;
+    float    m_minimumRpm;
+    float    m_referenceRpm{ 0.f };
+    std::array<Sample, MAX_SAMPLES> m_samples{};
+    std::size_t m_first{ 0 }; // oldest sample
+    std::size_t m_count{ 0 };
+};
+
+} // end namespace
@@ -1,11 +1,35 @@
 #include "stepperControl/mockgpio.h"
 #include "stepperControl/steppermotor.h"
 #include "rotaryencoder.h"
+#include "alphabetatracker.h"
+#include "radiusprofile.h"
+#include "rpmestimator.h"
 #include "log.h"
+#include "misalignment.h"
 #include "model.h"
+#include "motionplanner.h"
+#include "motionqueue.h"
+#include "mpscqueue.h"
+#include "pitchcompensation.h"
+#include "prioritymutex.h"
 #include "configreader.h"
+#include "coordinatedmove.h"
+#include "deadlinescheduler.h"
+#include "electronicgearbox.h"
+#include "formprofile.h"
+#include "gpiotrace.h"
+#include "keybindings.h"
+#include "latency.h"
+#include "replaygpio.h"
+#include "spscring.h"
+#include "stalldetector.h"
+#include "threadingcycle.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
 #include <thread>
 
 #define CATCH_CONFIG_MAIN
@@ -139,7 +163,8 @@ TEST_CASE( "Stepper: Rotary Encoder RPM" )
         23,
         24,
         2000,
-        35.f / 30.f
+        35,
+        30
         );
     gpio.delayMicroSeconds( 500'000 );
     REQUIRE( re.getRpm() > 0.f);
@@ -153,15 +178,545 @@ TEST_CASE( "Stepper: Rotary Encoder Position Callback" )
         23,
         24,
         2000,
-        35.f / 30.f
+        35,
+        30
         );
     bool called = false;
     while( re.warmingUp() ) gpio.delayMicroSeconds( 1'000 );
-    re.callbackAtZeroDegrees([&](){ called = true; });
+    auto fired = re.callbackAtZeroDegrees([&](){ called = true; });
+    REQUIRE( fired.get() == true );
     REQUIRE( re.warmingUp() == false );
     REQUIRE( called == true );
 }
 
+namespace
+{
+
+// An IGpio whose tick is just the time in microseconds, and which
+// otherwise only counts step pulses, for things that only need a clock
+class ClockGpio : public mgo::IGpio
+{
+public:
+    void setStepPin( int, mgo::PinState state ) override
+    {
+        if( state == mgo::PinState::high ) ++stepPulses;
+    }
+    void setReversePin( int, mgo::PinState ) override {}
+    void setEnablePin( int, mgo::PinState ) override {}
+    void delayMicroSeconds( long usecs ) override
+    {
+        std::this_thread::sleep_for( std::chrono::microseconds( usecs ) );
+    }
+    void setRotaryEncoderCallback(
+        int, int, void ( * )( int, int, uint32_t, void* ), void* ) override {}
+    uint32_t getTick() override
+    {
+        return static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - m_start ).count() );
+    }
+    std::atomic<long> stepPulses{ 0 };
+private:
+    std::chrono::steady_clock::time_point m_start{ std::chrono::steady_clock::now() };
+};
+
+} // end anonymous namespace
+
+TEST_CASE( "Scheduler: Fires on time and says how late it was" )
+{
+    ClockGpio gpio;
+    mgo::DeadlineScheduler scheduler( gpio );
+    uint32_t target = gpio.getTick() + 20'000;
+    uint32_t firedAt = 0;
+    auto fired = scheduler.schedule(
+        [&]( uint32_t& tick ){ tick = target; return true; },
+        [&](){ firedAt = gpio.getTick(); }
+        );
+    REQUIRE( fired.get() == true );
+    // Never early, as it spins for the last part
+    REQUIRE( static_cast<int32_t>( firedAt - target ) >= 0 );
+    int32_t error = scheduler.getLastErrorMicroseconds();
+    REQUIRE( error >= 0 );
+    // Generous, as the test may not get realtime priority
+    REQUIRE( error < 5'000 );
+    REQUIRE( std::abs( scheduler.getWorstErrorMicroseconds() ) >= error );
+}
+
+TEST_CASE( "Scheduler: Cancelled requests never run" )
+{
+    ClockGpio gpio;
+    mgo::DeadlineScheduler scheduler( gpio );
+    bool ran = false;
+    // One which can't get a deadline yet, one a long way off, and one
+    // still queued behind them
+    auto waiting = scheduler.schedule(
+        []( uint32_t& ){ return false; },
+        [&](){ ran = true; }
+        );
+    uint32_t later = gpio.getTick() + 10'000'000;
+    auto distant = scheduler.schedule(
+        [&]( uint32_t& tick ){ tick = later; return true; },
+        [&](){ ran = true; }
+        );
+    auto queued = scheduler.schedule(
+        [&]( uint32_t& tick ){ tick = later; return true; },
+        [&](){ ran = true; }
+        );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+    auto started = std::chrono::steady_clock::now();
+    scheduler.cancelAll();
+    REQUIRE( waiting.get() == false );
+    REQUIRE( distant.get() == false );
+    REQUIRE( queued.get() == false );
+    REQUIRE( ! ran );
+    // The sleeping thread noticed within a sleep or so, not at the deadline
+    REQUIRE( std::chrono::steady_clock::now() - started < std::chrono::seconds( 1 ) );
+    // ...and it still takes new requests afterwards
+    auto after = scheduler.schedule(
+        [&]( uint32_t& tick ){ tick = gpio.getTick(); return true; },
+        [&](){ ran = true; }
+        );
+    REQUIRE( after.get() == true );
+    REQUIRE( ran );
+}
+
+TEST_CASE( "Scheduler: Gives up on a request which never gets a deadline" )
+{
+    ClockGpio gpio;
+    mgo::DeadlineScheduler scheduler( gpio );
+    scheduler.setGiveUpMicroseconds( 20'000 );
+    bool ran = false;
+    auto never = scheduler.schedule(
+        []( uint32_t& ){ return false; },
+        [&](){ ran = true; }
+        );
+    auto behind = scheduler.schedule(
+        [&]( uint32_t& tick ){ tick = gpio.getTick(); return true; },
+        [](){}
+        );
+    REQUIRE( never.get() == false );
+    REQUIRE( ! ran );
+    // ...and the one behind it isn't held up for good
+    REQUIRE( behind.get() == true );
+    REQUIRE( scheduler.getTimedOut() == 1 );
+    REQUIRE( scheduler.getFired() == 1 );
+}
+
+namespace
+{
+
+// Turns an encoder's pins by hand, one edge at a time, as pigpio would
+// report them, with the given number of microseconds between edges
+struct QuadratureDriver
+{
+    QuadratureDriver( mgo::RotaryEncoder& encoder, uint32_t interval )
+        : re( encoder ), interval( interval )
+    {
+        // Both pins low to start with
+        re.callback( 23, 0, tick );
+        re.callback( 24, 0, tick );
+    }
+    // Forwards (1) or backwards (-1), this many counts
+    void turn( int direction, int counts )
+    {
+        // Going forwards the states run 00 -> 01 -> 11 -> 10
+        const int levels[ 4 ][ 2 ] = { { 0, 0 }, { 0, 1 }, { 1, 1 }, { 1, 0 } };
+        for( int n = 0; n < counts; ++n )
+        {
+            int next = ( state + direction + 4 ) % 4;
+            tick += interval;
+            if( levels[ next ][ 0 ] != levels[ state ][ 0 ] )
+            {
+                re.callback( 23, levels[ next ][ 0 ], tick );
+            }
+            else
+            {
+                re.callback( 24, levels[ next ][ 1 ], tick );
+            }
+            state = next;
+        }
+    }
+    mgo::RotaryEncoder& re;
+    uint32_t interval;
+    uint32_t tick{ 1'000 };
+    int state{ 0 };
+};
+
+// Turns an encoder forwards in real time, on a thread of its own, a count
+// every "interval" microseconds by the gpio's clock. The edge for count c
+// comes at tick 1,000 + c * interval, and they're handed over in batches,
+// as pigpio does.
+class Spindle
+{
+public:
+    Spindle( ClockGpio& gpio, mgo::RotaryEncoder& encoder, uint32_t interval )
+        : m_driver( encoder, interval )
+    {
+        m_thread = std::thread( [ this, &gpio, &encoder, interval ]()
+            {
+                while( m_running )
+                {
+                    uint32_t now = gpio.getTick();
+                    while( m_turning &&
+                        static_cast<int32_t>( now - m_driver.tick - interval ) >= 0 )
+                    {
+                        m_driver.turn( 1, 1 );
+                    }
+                    encoder.processEdges();
+                    std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+                }
+            } );
+        while( encoder.warmingUp() || encoder.getRpm() == 0.f )
+        {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        }
+    }
+    ~Spindle()
+    {
+        m_running = false;
+        m_thread.join();
+    }
+    // No more edges, as if the chuck had jammed
+    void stop()
+    {
+        m_turning = false;
+    }
+private:
+    QuadratureDriver m_driver;
+    std::atomic<bool> m_running{ true };
+    std::atomic<bool> m_turning{ true };
+    std::thread m_thread;
+};
+
+} // end anonymous namespace
+
+TEST_CASE( "Encoder: Direction and signed count" )
+{
+    // Nothing comes from the pins but what we send
+    mgo::ReplayGpio gpio( std::vector<mgo::TraceRecord>{} );
+    // 400 counts per rev
+    mgo::RotaryEncoder re( gpio, 23, 24, 100, 1, 1 );
+    QuadratureDriver driver( re, 100 );
+    REQUIRE( ! re.warmingUp() );
+    driver.turn( 1, 40 );
+    REQUIRE( re.getPositionCount() == 40 );
+    REQUIRE( re.getRotationDirection() == mgo::RotationDirection::normal );
+    REQUIRE( re.getPositionDegrees() == Approx( 36.0 ) );
+    // Back past zero, changing direction part way through a pulse
+    driver.turn( -1, 61 );
+    REQUIRE( re.getPositionCount() == -21 );
+    REQUIRE( re.getRotationDirection() == mgo::RotationDirection::reversed );
+    REQUIRE( re.getPositionDegrees() == Approx( 360.0 - 18.9 ) );
+    driver.turn( 1, 1 );
+    REQUIRE( re.getPositionCount() == -20 );
+    REQUIRE( re.getRotationDirection() == mgo::RotationDirection::normal );
+    // A missed edge shows up as a pin staying where it was; it isn't counted
+    re.callback( 23, 0, driver.tick += 100 );
+    REQUIRE( re.getIllegalTransitionCount() == 1 );
+    REQUIRE( re.getPositionCount() == -20 );
+}
+
+TEST_CASE( "Encoder: Gearing stays exact over many revolutions" )
+{
+    mgo::ReplayGpio gpio( std::vector<mgo::TraceRecord>{} );
+    // 2,000 ppr geared 1,000:997, so 8,000,000 / 997 (about 8,024.07)
+    // counts per rev, which no float or double holds exactly
+    mgo::RotaryEncoder re( gpio, 23, 24, 2000, 1000, 997 );
+    REQUIRE( re.getCountsPerRevNumerator() == 8'000'000 );
+    REQUIRE( re.getCountsPerRevDivisor() == 997 );
+    QuadratureDriver driver( re, 10 );
+    // In batches, so the queue doesn't overflow
+    auto turn = [&]( int direction, int64_t counts )
+        {
+            while( counts > 0 )
+            {
+                int batch = static_cast<int>( std::min<int64_t>( counts, 4'000 ) );
+                driver.turn( direction, batch );
+                re.processEdges();
+                counts -= batch;
+            }
+        };
+    // 8,000,000 counts is exactly 997 revolutions, so we're back at zero
+    turn( 1, 8'000'000 );
+    REQUIRE( re.getPositionCount() == 8'000'000 );
+    REQUIRE( re.getPositionDegrees() == 0.f );
+    // One more count is 997 / 8,000,000 of a turn, whichever
+    // revolution we're in
+    turn( 1, 1 );
+    REQUIRE( re.getPositionDegrees() == 360.f * 997 / 8'000'000 );
+    // Angles are the same on the way back down, down to the last bit
+    turn( 1, 4'012 );
+    float halfwayish = re.getPositionDegrees();
+    turn( -1, 8'000'000 );
+    turn( 1, 8'000'000 );
+    REQUIRE( re.getPositionDegrees() == halfwayish );
+    turn( -1, 8'004'013 );
+    REQUIRE( re.getPositionCount() == 0 );
+    REQUIRE( re.getPositionDegrees() == 0.f );
+    REQUIRE( re.getIllegalTransitionCount() == 0 );
+}
+
+TEST_CASE( "Encoder: The next count at an angle is exact" )
+{
+    // 600 rpm, a count every 100 us, with 2,000 ppr geared 35:30, so
+    // the revolutions start at counts 0, 9,333.3, 18,666.7, 28,000...
+    std::vector<mgo::TraceRecord> trace;
+    const int levels[ 4 ][ 2 ] = { { 0, 0 }, { 0, 1 }, { 1, 1 }, { 1, 0 } };
+    for( int n = 0; n < 20'000; ++n )
+    {
+        int pin = ( n % 2 ) ? 24 : 23;
+        trace.push_back( { 1'000 + static_cast<uint32_t>( n ) * 100, mgo::TraceEvent::EncoderEdge,
+            static_cast<uint8_t>( pin ), static_cast<uint8_t>( levels[ n % 4 ][ pin == 23 ? 0 : 1 ] ) } );
+    }
+    mgo::ReplayGpio gpio( trace );
+    mgo::RotaryEncoder re( gpio, 23, 24, 2000, 35, 30 );
+    gpio.replay( false, [ &re ](){ re.processEdges(); } );
+    // Two edges are used up warming up
+    REQUIRE( re.getPositionCount() == 19'998 );
+    int64_t count = 0;
+    // The next zero is the start of the fourth revolution
+    REQUIRE( re.nextCountAtDegrees( 0.0, 0, count ) );
+    REQUIRE( count == 28'000 );
+    // With a lead taking us past that, it's the fifth, which starts at
+    // 37,333.3, so the first whole count of it is 37,334
+    REQUIRE( re.nextCountAtDegrees( 0.0, 900'000, count ) );
+    REQUIRE( count == 37'334 );
+    // A quarter of the way round the third revolution is exactly 21,000
+    REQUIRE( re.nextCountAtDegrees( 90.0, 0, count ) );
+    REQUIRE( count == 21'000 );
+    // ...and three quarters is 25,666.7, so the first count after it
+    REQUIRE( re.nextCountAtDegrees( -90.0, 0, count ) );
+    REQUIRE( count == 25'667 );
+}
+
+TEST_CASE( "Encoder: The index pulse re-anchors the count" )
+{
+    mgo::ReplayGpio gpio( std::vector<mgo::TraceRecord>{} );
+    // 400 counts per rev, with the index on pin 25
+    mgo::RotaryEncoder re( gpio, 23, 24, 100, 1, 1, 25 );
+    QuadratureDriver driver( re, 100 );
+    auto index = [&]()
+        {
+            re.callback( 25, 1, driver.tick += 10 );
+            re.callback( 25, 0, driver.tick += 10 );
+        };
+    driver.turn( 1, 10 );
+    index();
+    // A revolution later it's where it was
+    driver.turn( 1, 400 );
+    index();
+    REQUIRE( re.getIndexCorrectionCount() == 0 );
+    REQUIRE( re.getPositionCount() == 410 );
+    // One count short of a revolution: we lost one, so it's put back
+    driver.turn( 1, 399 );
+    index();
+    REQUIRE( re.getIndexCorrectionCount() == 1 );
+    REQUIRE( re.getPositionCount() == 810 );
+
+    // Overrun the queue. The count is now out by 810 (808 edges dropped,
+    // and two to warm up again), and the index is found afresh rather
+    // than dragging the count back to the old place.
+    driver.turn( 1, 9'000 );
+    REQUIRE( re.getOverrunCount() == 808 );
+    int64_t afterOverrun = re.getPositionCount();
+    REQUIRE( afterOverrun == 810 + 9'000 - 810 );
+    index();
+    REQUIRE( re.getIndexCorrectionCount() == 1 );
+    REQUIRE( re.getPositionCount() == afterOverrun );
+    // ...and then it's held to the new place
+    driver.turn( 1, 401 );
+    index();
+    REQUIRE( re.getIndexCorrectionCount() == 2 );
+    REQUIRE( re.getPositionCount() == afterOverrun + 400 );
+}
+
+TEST_CASE( "Encoder: Callbacks at any angle, and at each thread start" )
+{
+    ClockGpio gpio;
+    // 2,000 ppr geared 35:30, so 9,333.3 counts per rev, and a count
+    // every 40 us (about 160 rpm)
+    mgo::RotaryEncoder re( gpio, 23, 24, 2000, 35, 30 );
+    const uint32_t interval = 40;
+    const double countsPerRev = 4.0 * 2000 * 35 / 30;
+    Spindle spindle( gpio, re, interval );
+    auto angleAt = [&]( uint32_t tick )
+        {
+            double counts = static_cast<int32_t>( tick - 1'000 ) / static_cast<double>( interval );
+            return std::fmod( counts * 360.0 / countsPerRev, 360.0 );
+        };
+    // How far apart two angles are, either way round
+    auto separation = []( double a, double b )
+        {
+            double difference = std::fmod( std::abs( a - b ), 360.0 );
+            return std::min( difference, 360.0 - difference );
+        };
+
+    // Anywhere in the revolution, not just at zero. 5° is about 5 ms
+    // at this speed, which allows for the test not running realtime.
+    for( double angle : { 77.7, 359.0 } )
+    {
+        uint32_t firedAt = 0;
+        auto fired = re.callbackAtDegrees( angle, [&](){ firedAt = gpio.getTick(); } );
+        REQUIRE( fired.get() == true );
+        REQUIRE( separation( angleAt( firedAt ), angle ) < 5.0 );
+    }
+
+    // Three starts, each 120° on from the last
+    const int starts = 3;
+    const int64_t n = re.getCountsPerRevNumerator();
+    const int64_t d = re.getCountsPerRevDivisor();
+    for( int start = 0; start < starts; ++start )
+    {
+        double angle = 360.0 * start / starts;
+        uint32_t firedAt = 0;
+        auto fired = re.callbackAtDegrees( angle, [&](){ firedAt = gpio.getTick(); } );
+        REQUIRE( fired.get() == true );
+        REQUIRE( separation( angleAt( firedAt ), angle ) < 5.0 );
+
+        // The gearbox starts at a whole count, which must be the first
+        // one at or past the start's angle: the same count within the
+        // revolution every time, however far round we are
+        int64_t count = 0;
+        REQUIRE( re.nextCountAtDegrees( angle, 10'000, count ) );
+        int64_t angleUnits = std::llround( angle / 360.0 * n );
+        int64_t into = ( ( count * d - angleUnits ) % n + n ) % n;
+        REQUIRE( into >= 0 );
+        REQUIRE( into < d );
+        int64_t nextCount = 0;
+        REQUIRE( re.nextCountAtDegrees( angle, 10'000 + 400'000, nextCount ) );
+        // ...and a revolution later it's a revolution of counts on
+        int64_t revolutions = std::llround( static_cast<double>( nextCount - count ) * d / n );
+        REQUIRE( revolutions >= 1 );
+        REQUIRE( std::abs( ( nextCount - count ) - static_cast<double>( revolutions * n ) / d ) < 1.0 );
+    }
+}
+
+TEST_CASE( "Replay: A recorded spindle run drives the encoder" )
+{
+    const std::string filename = "test_trace.bin";
+    {
+        // 600 rpm, with 2,000 ppr geared 35:30 (9,333.3 counts per rev),
+        // for longer than the encoder's queue could hold at once
+        mgo::TraceWriter writer( filename );
+        const int levels[ 4 ][ 2 ] = { { 0, 0 }, { 0, 1 }, { 1, 1 }, { 1, 0 } };
+        for( int n = 0; n < 20'000; ++n )
+        {
+            uint32_t tick = 1'000 + static_cast<uint32_t>( n * 60'000'000.0 / 600 / 9'333.333 );
+            // Alternate A and B, following the forward sequence
+            int pin = ( n % 2 ) ? 24 : 23;
+            int level = levels[ n % 4 ][ pin == 23 ? 0 : 1 ];
+            writer.write( { tick, mgo::TraceEvent::EncoderEdge,
+                static_cast<uint8_t>( pin ), static_cast<uint8_t>( level ) } );
+        }
+        REQUIRE( writer.getDropped() == 0 );
+    }
+    mgo::ReplayGpio gpio( filename );
+    std::remove( filename.c_str() );
+    REQUIRE( gpio.getRecording().size() == 20'000 );
+    mgo::RotaryEncoder re( gpio, 23, 24, 2000, 35, 30 );
+    REQUIRE( gpio.replay( false, [ &re ](){ re.processEdges(); } ) == 20'000 );
+    REQUIRE( re.getOverrunCount() == 0 );
+    REQUIRE( re.getPositionCount() == 20'000 - 2 );
+    REQUIRE( ! re.warmingUp() );
+    REQUIRE( re.getRpm() == Approx( 600.0 ).epsilon( 0.02 ) );
+    REQUIRE( re.getIllegalTransitionCount() == 0 );
+    // Motor writes made during the replay are kept
+    gpio.setStepPin( 8, mgo::PinState::high );
+    REQUIRE( gpio.getWrites().size() == 1 );
+}
+
+TEST_CASE( "Tracker: Interpolates between and beyond edges" )
+{
+    mgo::AlphaBetaTracker tracker;
+    REQUIRE( ! tracker.valid() );
+    // One count every 50 us, with +/- 3 us of jitter on the edge times
+    const int jitter[] = { 0, 3, -2, 1, -3, 2 };
+    for( int n = 0; n < 500; ++n )
+    {
+        tracker.update( n, 10'000 + n * 50 + jitter[ n % 6 ] );
+    }
+    REQUIRE( tracker.valid() );
+    // Halfway between edges, and two edges ahead
+    auto estimate = tracker.estimateAt( 10'000 + 499 * 50 + 25 );
+    REQUIRE( estimate.position == Approx( 499.5 ).margin( 0.1 ) );
+    REQUIRE( estimate.velocity == Approx( 1.0 / 50.0 ).epsilon( 0.01 ) );
+    estimate = tracker.estimateAt( 10'000 + 501 * 50 );
+    REQUIRE( estimate.position == Approx( 501.0 ).margin( 0.1 ) );
+    REQUIRE( estimate.uncertainty < 0.2 );
+    uint32_t tick = 0;
+    REQUIRE( tracker.tickAtPosition( 600.0, tick ) );
+    REQUIRE( std::abs( static_cast<int32_t>( tick - ( 10'000 + 600 * 50 ) ) ) < 5 );
+
+    // The edges stop: a few intervals on, it no longer guesses
+    REQUIRE( ! tracker.stale( 10'000 + 503 * 50 ) );
+    REQUIRE( tracker.stale( 10'000 + 520 * 50 ) );
+    REQUIRE( ! tracker.estimateAt( 10'000 + 520 * 50 ).valid );
+    // Nor when the edges were slow, once it's been long enough
+    mgo::AlphaBetaTracker slow;
+    for( int n = 0; n < 10; ++n )
+    {
+        slow.update( n, n * 40'000u );
+    }
+    REQUIRE( slow.estimateAt( 9 * 40'000u + 90'000u ).valid );
+    REQUIRE( ! slow.estimateAt( 9 * 40'000u + 110'000u ).valid );
+}
+
+TEST_CASE( "RpmEstimator: Rejects bounces and follows acceleration" )
+{
+    // 1,000 counts per rev at 600 rpm is one count every 100 us
+    mgo::RpmEstimator estimator( 1'000.0 );
+    uint32_t tick = 0;
+    for( int n = 0; n < 200; ++n )
+    {
+        tick += 100;
+        // A bounced edge, which arrives very late
+        estimator.addEdge( n == 190 ? tick + 60 : tick );
+    }
+    REQUIRE( estimator.getRpm( tick ) == Approx( 600.0 ).epsilon( 0.01 ) );
+    REQUIRE( estimator.getRpmVariance( tick ) < 100.f );
+    REQUIRE( std::abs( estimator.getAcceleration( tick ) ) < 100.f );
+    estimator.setFilter( mgo::RpmFilter::Median );
+    REQUIRE( estimator.getRpm( tick ) == Approx( 600.0 ).epsilon( 0.001 ) );
+    // Nothing for a while means we've stopped
+    REQUIRE( estimator.getRpm( tick + 200'000 ) == 0.f );
+
+    // Speeding up
+    estimator.reset();
+    double interval = 100.0;
+    for( int n = 0; n < 200; ++n )
+    {
+        interval *= 0.999;
+        tick += static_cast<uint32_t>( interval );
+        estimator.addEdge( tick );
+    }
+    REQUIRE( estimator.getAcceleration( tick ) > 0.f );
+    REQUIRE( estimator.getRpm( tick ) > 600.f );
+}
+
+TEST_CASE( "StallDetector: Trips on a sharp drop only" )
+{
+    // 20% within 5 ms
+    mgo::StallDetector detector( 20.f, 5'000, 30.f );
+    uint32_t tick = 0;
+    // Slowing down gently is fine, 600 -> 400 rpm over 100 ms
+    for( int n = 0; n <= 100; ++n )
+    {
+        tick += 1'000;
+        REQUIRE( ! detector.update( tick, 600.f - 2.f * n ) );
+    }
+    // 400 -> 300 rpm in a few milliseconds isn't
+    REQUIRE( ! detector.update( tick += 1'000, 370.f ) );
+    REQUIRE( ! detector.update( tick += 1'000, 330.f ) );
+    REQUIRE( detector.update( tick += 1'000, 300.f ) );
+    REQUIRE( detector.getReferenceRpm() == Approx( 404.f ) );
+    // ...and having tripped, it doesn't keep on tripping
+    REQUIRE( ! detector.update( tick += 1'000, 290.f ) );
+    // A spindle that's already stopped doesn't trip it either
+    detector.reset();
+    REQUIRE( ! detector.update( tick += 1'000, 20.f ) );
+    REQUIRE( ! detector.update( tick += 1'000, 0.f ) );
+}
+
 TEST_CASE( "Stepper: Check backlash compensation" )
 {
     mgo::MockGpio gpio( false );
@@ -273,4 +828,914 @@ TEST_CASE( "Model:   check radius" )
     // X position should be zero
     pos = model.m_axis2Motor->getPosition();
     REQUIRE( pos < 0.05 );
-}
\ No newline at end of file
+}
+
+TEST_CASE( "Model:   whenStopped is called once the move is done" )
+{
+    mgo::MockGpio gpio( false );
+    mgo::MockConfigReader config;
+    mgo::Model model( gpio, config );
+    model.initialise();
+    model.axis1SetSpeed( 200.0 );
+    int calls = 0;
+    bool completed = false;
+    model.axis1GoToPosition( 0.5, [ & ]( bool c ){ ++calls; completed = c; } );
+    REQUIRE( calls == 0 );
+    model.axis1Wait();
+    model.checkStatus();
+    REQUIRE( calls == 1 );
+    REQUIRE( completed );
+    // Only the once
+    model.checkStatus();
+    REQUIRE( calls == 1 );
+
+    // Stopped on the way
+    model.axis1GoToPosition( 100.0, [ & ]( bool c ){ ++calls; completed = c; } );
+    model.axis1Stop();
+    REQUIRE( calls == 2 );
+    REQUIRE( ! completed );
+}
+
+TEST_CASE( "Model:   nothing starts until the emergency stop is dealt with" )
+{
+    mgo::MockGpio gpio( false );
+    mgo::MockConfigReader config;
+    mgo::Model model( gpio, config );
+    model.initialise();
+    model.axis1SetSpeed( 200.0 );
+    model.emergencyStop();
+    REQUIRE( model.emergencyStopped() );
+    int calls = 0;
+    bool completed = true;
+    model.axis1GoToStep( 100, [ & ]( bool c ){ ++calls; completed = c; } );
+    REQUIRE( calls == 1 );
+    REQUIRE( ! completed );
+    REQUIRE( ! model.axis1IsRunning() );
+    // Still refused until the control loop has tidied up after it
+    model.emergencyStopHandled();
+    REQUIRE( model.emergencyStopped() );
+    model.checkStatus();
+    REQUIRE( model.emergencyStopped() );
+    model.emergencyStopHandled();
+    REQUIRE( ! model.emergencyStopped() );
+    model.axis1GoToStep( 100, [ & ]( bool c ){ ++calls; completed = c; } );
+    model.axis1Wait();
+    model.checkStatus();
+    REQUIRE( calls == 2 );
+    REQUIRE( completed );
+    REQUIRE( model.m_axis1Motor->getCurrentStep() == 100 );
+}
+
+TEST_CASE( "Model:   the threading cycle goes pass by pass, pauses, and stops short" )
+{
+    mgo::MockGpio gpio( false );
+    mgo::MockConfigReader config;
+    // Started by the scheduler, which gives up if the spindle isn't turning
+    config.setBool( "ThreadingElectronicGearbox", false );
+    mgo::Model model( gpio, config );
+    model.initialise();
+    model.changeMode( mgo::Mode::Threading );
+    using Stage = mgo::ThreadingCycleStage;
+    auto runUntil = [ & ]( auto done )
+        {
+            auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds( 10 );
+            while( ! done() && std::chrono::steady_clock::now() < giveUp )
+            {
+                model.checkStatus();
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+            }
+        };
+
+    // Nowhere to cut to yet
+    model.threadingCycleStart();
+    REQUIRE( model.m_threadingStage == Stage::Idle );
+    REQUIRE( model.m_threadingStatus == "Memorise the end of the thread first" );
+
+    model.m_axis1Memory.at( model.m_currentMemory ) =
+        model.m_axis1Motor->getCurrentStep() - 10'000;
+    model.threadingCycleStart();
+    REQUIRE( model.m_threadingStage == Stage::Retract );
+    REQUIRE( model.m_threadingPasses.size() > 1 );
+    // Pausing holds it, once X has backed off, before the first pass
+    model.threadingCyclePause();
+    runUntil( [ & ](){ return model.m_threadingStatus.rfind( "Paused", 0 ) == 0; } );
+    REQUIRE( model.m_threadingStage == Stage::Retract );
+    REQUIRE( model.m_threadingStatus.rfind( "Paused before pass 1 of", 0 ) == 0 );
+
+    // Carrying on: to the start, in to depth, and cutting
+    model.threadingCyclePause();
+    std::vector<Stage> seen{ Stage::Retract };
+    runUntil( [ & ]()
+        {
+            if( model.m_threadingStage != seen.back() )
+            {
+                seen.push_back( model.m_threadingStage );
+            }
+            return model.m_threadingStage == Stage::Cutting ||
+                model.m_threadingStage == Stage::Idle;
+        } );
+    REQUIRE( seen == std::vector<Stage>{
+        Stage::Retract, Stage::ToStart, Stage::Infeed, Stage::Cutting } );
+    // The first pass is one infeed deep, and one sidefeed along
+    REQUIRE( model.m_threadingPasses.front().sidefeed == Approx( mgo::SIDEFEED ) );
+
+    // Z not getting to the end spoils the thread, so the cycle stops
+    // rather than going in for the next pass
+    model.axis1Stop();
+    runUntil( [ & ](){ return model.m_threadingStage == Stage::Idle; } );
+    REQUIRE( model.m_threadingStage == Stage::Idle );
+    REQUIRE( model.m_threadingStatus.find( "pass didn't finish" ) != std::string::npos );
+    REQUIRE( model.m_threadingPhaseErrors.empty() );
+}
+
+TEST_CASE( "Model:   a Z,X go to is one coordinated move" )
+{
+    mgo::MockGpio gpio( false );
+    mgo::MockConfigReader config;
+    config.setDouble( "Axis1MaxAccel", 50.0 );
+    config.setDouble( "Axis1MaxJerk", 500.0 );
+    config.setDouble( "Axis2MaxAccel", 20.0 );
+    config.setDouble( "Axis2MaxJerk", 200.0 );
+    mgo::Model model( gpio, config );
+    model.initialise();
+    model.axis1SetSpeed( 200.0 );
+    // Choosing the mode is what enables it, which mustn't count as
+    // a function that ties the axes together
+    model.changeMode( mgo::Mode::Axis1GoTo );
+    model.m_input = "0.5,0.25";
+    model.acceptInputValue();
+    REQUIRE( ( ! model.m_motionRuns.empty() || model.m_coordinatedMove->isRunning() ) );
+    auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds( 10 );
+    while( model.axis1IsRunning() && std::chrono::steady_clock::now() < giveUp )
+    {
+        model.checkStatus();
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+    model.checkStatus();
+    REQUIRE( model.m_axis1Motor->getPosition() == Approx( 0.5 ).margin( 0.01 ) );
+    REQUIRE( model.m_axis2Motor->getPosition() == Approx( 0.25 ).margin( 0.01 ) );
+
+    // Whereas while tapering, X already follows Z
+    model.changeMode( mgo::Mode::Taper );
+    REQUIRE( model.axesLinked() );
+}
+
+TEST_CASE( "Model:   without an S-curve, a Z,X go to is still one line" )
+{
+    mgo::MockGpio gpio( false );
+    mgo::MockConfigReader config;
+    // A jerk limit on its own isn't enough
+    config.setDouble( "Axis1MaxJerk", 500.0 );
+    mgo::Model model( gpio, config );
+    model.initialise();
+    model.axis1SetSpeed( 200.0 );
+    REQUIRE( ! model.sCurveConfigured( "Axis1" ) );
+    // A rapid would start and stop at full speed
+    REQUIRE( ! model.axis1RapidToStep( 100 ) );
+    REQUIRE( model.coordinatedLimits( 0.5, 0.25, 200.0 ).maxAcceleration == 0.0 );
+
+    // Whereas a go to is at the feed rate, steady all the way
+    model.changeMode( mgo::Mode::Axis1GoTo );
+    model.m_input = "0.5,0.25";
+    model.acceptInputValue();
+    REQUIRE( ( ! model.m_motionRuns.empty() || model.m_coordinatedMove->isRunning() ) );
+    auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds( 10 );
+    while( model.axis1IsRunning() && std::chrono::steady_clock::now() < giveUp )
+    {
+        model.checkStatus();
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+    model.checkStatus();
+    REQUIRE( model.m_axis1Motor->getPosition() == Approx( 0.5 ).margin( 0.01 ) );
+    REQUIRE( model.m_axis2Motor->getPosition() == Approx( 0.25 ).margin( 0.01 ) );
+
+    config.setDouble( "Axis1MaxAccel", 50.0 );
+    REQUIRE( model.sCurveConfigured( "Axis1" ) );
+}
+
+TEST_CASE( "Model:   repeats and returns to memory go through the motion queue" )
+{
+    mgo::MockGpio gpio( false );
+    mgo::MockConfigReader config;
+    config.setDouble( "Axis1MaxAccel", 50.0 );
+    config.setDouble( "Axis1MaxJerk", 500.0 );
+    mgo::Model model( gpio, config );
+    model.initialise();
+    model.axis1SetSpeed( 200.0 );
+    auto runToEnd = [ & ]()
+        {
+            auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds( 10 );
+            while( model.axis1IsRunning() && std::chrono::steady_clock::now() < giveUp )
+            {
+                model.checkStatus();
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+            }
+            model.checkStatus();
+        };
+    long start = model.m_axis1Motor->getCurrentStep();
+    model.m_axis1Memory.at( model.m_currentMemory ) = start;
+
+    model.axis1GoToOffset( 0.2 );
+    runToEnd();
+    model.repeatLastRelativeMove();
+    REQUIRE( ( ! model.m_motionRuns.empty() || model.m_coordinatedMove->isRunning() ) );
+    runToEnd();
+    REQUIRE( model.m_axis1Motor->getPosition() == Approx( 0.4 ).margin( 0.01 ) );
+
+    bool returned = false;
+    model.axis1GoToCurrentMemory( [ & ]( bool completed ){ returned = completed; } );
+    REQUIRE( ( ! model.m_motionRuns.empty() || model.m_coordinatedMove->isRunning() ) );
+    runToEnd();
+    REQUIRE( returned );
+    REQUIRE( model.m_axis1Motor->getCurrentStep() == start );
+
+    // X has no S-curve limits, so is left to ramp itself
+    model.axis2GoToOffset( 0.1 );
+    model.axis2Wait();
+    model.repeatLastRelativeMove();
+    REQUIRE( model.m_motionRuns.empty() );
+    REQUIRE( ! model.m_coordinatedMove->isRunning() );
+    model.axis2Wait();
+    REQUIRE( model.m_axis2Motor->getPosition() == Approx( 0.2 ).margin( 0.01 ) );
+}
+
+TEST_CASE( "Radius: Table follows the circle" )
+{
+    // 5 mm radius, 0.001 mm per step
+    mgo::RadiusProfile profile( 5.0, 0.001 );
+    REQUIRE( profile.xOffsetAt( -1.0 ) == 0.0 );
+    REQUIRE( profile.xOffsetAt( 0.0 ) == 0.0 );
+    REQUIRE( profile.xOffsetAt( 3.0 ) == Approx( 1.0 ) );
+    REQUIRE( profile.xOffsetAt( 4.0 ) == Approx( 2.0 ) );
+    // In between steps, we get the nearest
+    REQUIRE( profile.xOffsetAt( 4.0004 ) == profile.xOffsetAt( 4.0 ) );
+    REQUIRE( profile.xOffsetAt( 5.0 ) == Approx( 5.0 ) );
+    REQUIRE( profile.xOffsetAt( 6.0 ) == 5.0 );
+}
+
+TEST_CASE( "Profile: Chamfer into a ball end" )
+{
+    // A 1 mm 45° chamfer, then a quarter circle of radius 2 down to
+    // the centre line
+    std::istringstream iss(
+        "# chamfer then ball\n"
+        "0, 3\n"
+        "1, 2\n"
+        "arc 3, 0, 2\n"
+        );
+    mgo::FormProfile profile( mgo::readProfile( iss ) );
+    profile.compile( 0.001 );
+    REQUIRE( profile.getPointCount() == 3 );
+    REQUIRE( profile.getLength() == Approx( 3.0 ) );
+    REQUIRE( profile.getDepth() == Approx( 3.0 ) );
+    REQUIRE( profile.xOffsetAt( -1.0 ) == 0.0 );
+    REQUIRE( profile.xOffsetAt( 0.5 ) == Approx( -0.5 ) );
+    // Centre of the arc is at Z 1, X 0
+    REQUIRE( profile.xOffsetAt( 1.0 + std::sqrt( 2.0 ) ) == Approx( std::sqrt( 2.0 ) - 3.0 ).margin( 0.002 ) );
+    REQUIRE( profile.xOffsetAt( 5.0 ) == Approx( -3.0 ) );
+    // Going left from the start, X comes in
+    REQUIRE( profile.xDirectionFrom( 0.0, 1 ) == -1 );
+    REQUIRE( profile.xDirectionFrom( 3.0, 1 ) == 0 );
+
+    // Z has to keep going the same way
+    std::istringstream backwards( "0, 0\n1, 1\n0.5, 2\n" );
+    REQUIRE_THROWS( mgo::FormProfile( mgo::readProfile( backwards ) ) );
+    std::istringstream nonsense( "0, 0\nfred\n" );
+    REQUIRE_THROWS( mgo::readProfile( nonsense ) );
+}
+
+TEST_CASE( "LinearDda: Both axes finish on the same tick" )
+{
+    for( auto steps : { std::make_pair( 7L, 3L ), std::make_pair( 2L, 9L ),
+                        std::make_pair( 5L, 5L ), std::make_pair( 0L, 4L ) } )
+    {
+        mgo::LinearDda dda( steps.first, steps.second );
+        REQUIRE( dda.getTicks() == std::max( steps.first, steps.second ) );
+        long axis1Made = 0;
+        long axis2Made = 0;
+        bool axis1 = false;
+        bool axis2 = false;
+        for( long tick = 0; tick < dda.getTicks(); ++tick )
+        {
+            dda.tick( axis1, axis2 );
+            axis1Made += axis1;
+            axis2Made += axis2;
+        }
+        REQUIRE( axis1Made == steps.first );
+        REQUIRE( axis2Made == steps.second );
+        // The last tick steps every axis which moves at all
+        REQUIRE( axis1 == ( steps.first > 0 ) );
+        REQUIRE( axis2 == ( steps.second > 0 ) );
+    }
+}
+
+TEST_CASE( "Coordinated: Publishes the steps made as it goes" )
+{
+    ClockGpio gpio;
+    mgo::CoordinatedMove move( gpio, 1, 2 );
+    move.start( 200, 100, 0.2 );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+    // Part way, so the motors can be kept up to date while it runs
+    mgo::CoordinatedMove::Progress progress = move.getProgress();
+    REQUIRE( progress.running );
+    REQUIRE( progress.axis1Made > 0 );
+    REQUIRE( progress.axis1Made < 200 );
+    while( move.isRunning() )
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+    progress = move.getProgress();
+    REQUIRE( ! progress.running );
+    REQUIRE( progress.completed );
+    REQUIRE( progress.axis1Made == 200 );
+    REQUIRE( progress.axis2Made == 100 );
+    REQUIRE( gpio.stepPulses == 300 );
+
+    // Stopped part way, it says how far it got
+    move.start( 1'000, 1'000, 1.0 );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+    move.stop();
+    progress = move.getProgress();
+    REQUIRE( ! progress.running );
+    REQUIRE( ! progress.completed );
+    REQUIRE( progress.axis1Made > 0 );
+    REQUIRE( progress.axis1Made < 1'000 );
+    REQUIRE( progress.axis2Made == progress.axis1Made );
+    REQUIRE( gpio.stepPulses == 300 + 2 * progress.axis1Made );
+}
+
+TEST_CASE( "SCurve: Keeps within the limits and finishes on time" )
+{
+    mgo::MotionLimits limits{ 5'000.0, 20'000.0, 200'000.0 };
+    // Long enough to reach full speed...
+    mgo::SCurveProfile profile( 10'000.0, 0.0, 0.0, limits );
+    REQUIRE( profile.getPeakVelocity() == Approx( 5'000.0 ) );
+    // 0.25 s each way speeding up and slowing down, plus 1.75 s at
+    // full speed for what's left
+    REQUIRE( profile.getDuration() == Approx( 2.35 ) );
+    REQUIRE( profile.positionAt( profile.getDuration() ) == Approx( 10'000.0 ) );
+    double previous = 0.0;
+    double fastest = 0.0;
+    double hardest = 0.0;
+    for( double t = 0.001; t < profile.getDuration(); t += 0.001 )
+    {
+        double v = profile.velocityAt( t );
+        fastest = std::max( fastest, v );
+        hardest = std::max( hardest, std::abs( v - previous ) / 0.001 );
+        previous = v;
+    }
+    REQUIRE( fastest <= 5'000.0 + 0.001 );
+    REQUIRE( hardest <= 20'000.0 + 1.0 );
+    auto times = profile.stepTimes( 10'000 );
+    REQUIRE( times.size() == 10'000 );
+    REQUIRE( std::is_sorted( times.begin(), times.end() ) );
+    REQUIRE( times.back() == Approx( 2'350'000 ).margin( 1 ) );
+
+    // ...and too short to, so it turns round early
+    mgo::SCurveProfile shortMove( 100.0, 0.0, 0.0, limits );
+    REQUIRE( shortMove.getPeakVelocity() < 5'000.0 );
+    REQUIRE( shortMove.positionAt( shortMove.getDuration() ) == Approx( 100.0 ) );
+    REQUIRE( shortMove.velocityAt( shortMove.getDuration() ) == Approx( 0.0 ).margin( 0.01 ) );
+}
+
+TEST_CASE( "MotionQueue: Corners blend and reversals stop" )
+{
+    mgo::MotionQueue queue( 0.01 );
+    // Along Z, on along Z, a right-angled turn onto X, then back along Z
+    queue.add( 1'000, 0, 600.0 );
+    queue.add( 2'000, 0, 600.0 );
+    queue.add( 2'000, 1'000, 600.0 );
+    queue.add( 1'000, 1'000, 600.0 );
+    auto runs = queue.plan( 0, 0, 0.001, 0.001,
+        []( double, double, double feed )
+            {
+                return mgo::MotionLimits{ feed / 60.0, 50.0, 500.0 };
+            }
+        );
+    REQUIRE( queue.empty() );
+    // Z going back needs its backlash taken up, so that's a run of its own
+    REQUIRE( runs.size() == 2 );
+    REQUIRE( runs[ 0 ].size() == 3 );
+    REQUIRE( runs[ 1 ].size() == 1 );
+    const auto& run = runs[ 0 ];
+    REQUIRE( run.front().entryVelocity == 0.0 );
+    REQUIRE( run.back().exitVelocity == 0.0 );
+    // Going straight on it doesn't slow down at all...
+    REQUIRE( run[ 0 ].exitVelocity > 1.5 );
+    // ...but the corner is taken at sqrt( a * d * sin 45 / ( 1 - sin 45 ) )
+    REQUIRE( run[ 1 ].exitVelocity == Approx( 1.0987 ).epsilon( 0.001 ) );
+    for( std::size_t n = 0; n < run.size(); ++n )
+    {
+        if( n > 0 )
+        {
+            REQUIRE( run[ n ].entryVelocity == run[ n - 1 ].exitVelocity );
+        }
+        REQUIRE( mgo::SCurveProfile::changeDistance(
+            run[ n ].entryVelocity, run[ n ].exitVelocity, run[ n ].limits )
+                <= run[ n ].length + 1e-9 );
+    }
+    REQUIRE( runs[ 1 ][ 0 ].entryVelocity == 0.0 );
+    REQUIRE( runs[ 1 ][ 0 ].exitVelocity == 0.0 );
+    REQUIRE( queue.junctionVelocity( run[ 0 ], runs[ 1 ][ 0 ] ) == 0.0 );
+}
+
+TEST_CASE( "Misalignment: Angle from a test cut" )
+{
+    // 0.04 mm bigger at the chuck over 100 mm is 0.02 mm on the radius,
+    // so the tool has to come in as it gets there
+    double angle = mgo::misalignmentCorrectionAngle( 20.04, 20.0, 100.0 );
+    REQUIRE( angle == Approx( -0.011459 ).epsilon( 0.001 ) );
+    REQUIRE( mgo::misalignmentCorrectionAngle( 20.0, 20.04, 100.0 ) == Approx( -angle ) );
+    REQUIRE( mgo::misalignmentCorrectionAngle( 20.0, 20.0, 50.0 ) == 0.0 );
+    REQUIRE_THROWS( mgo::misalignmentCorrectionAngle( 20.04, 20.0, 0.0 ) );
+}
+
+TEST_CASE( "PitchCompensation: Cursor agrees with the table" )
+{
+    std::istringstream iss(
+        "# position, steps\n"
+        "0, 0\n"
+        "100, 4   # 0.004 mm short at 100 mm\n"
+        "200, 6\n"
+        );
+    mgo::PitchCompensation table( mgo::readPitchCompensation( iss ) );
+    REQUIRE( table.stepsAt( -10.0 ) == 0 );
+    REQUIRE( table.stepsAt( 50.0 ) == 2 );
+    REQUIRE( table.stepsAt( 150.0 ) == 5 );
+    REQUIRE( table.stepsAt( 500.0 ) == 6 );
+    // Steps counting down as the position goes up, both ways along it
+    mgo::PitchCompensation::Cursor cursor( table, -0.001, 10'000 );
+    bool same = true;
+    for( long step = 10'000; step >= -250'000; step -= 7 )
+    {
+        same = same && cursor.stepsAt( step ) == table.stepsAt( step * -0.001 );
+    }
+    for( long step = -250'000; step <= 10'000; step += 7 )
+    {
+        same = same && cursor.stepsAt( step ) == table.stepsAt( step * -0.001 );
+    }
+    REQUIRE( same );
+    std::istringstream bad( "0, 0\n100, 4\n50, 2\n" );
+    REQUIRE_THROWS( mgo::PitchCompensation( mgo::readPitchCompensation( bad ) ) );
+}
+
+TEST_CASE( "Model:   threading gearbox ratio is exact" )
+{
+    mgo::MockGpio gpio( false );
+    mgo::MockConfigReader config;
+    mgo::Model model( gpio, config );
+    model.initialise();
+    // 0.5 mm pitch, 1,000 steps per mm and 2,000 ppr geared 35:30
+    // (28,000 / 3 counts per rev) is 500 / ( 28,000 / 3 ) = 3 / 56
+    model.m_threadPitchIndex = 0;
+    int64_t numerator;
+    int64_t divisor;
+    model.threadingGearboxRatio( numerator, divisor );
+    REQUIRE( numerator == 3 );
+    REQUIRE( divisor == 56 );
+    // Two starts doubles the lead
+    model.m_threadStarts = 2;
+    model.threadingGearboxRatio( numerator, divisor );
+    REQUIRE( numerator == 3 );
+    REQUIRE( divisor == 28 );
+}
+
+TEST_CASE( "Gearbox: Steps with the spindle, and says how far it has got" )
+{
+    ClockGpio gpio;
+    // 400 counts per rev, a count every 40 us
+    mgo::RotaryEncoder re( gpio, 23, 24, 100, 1, 1 );
+    Spindle spindle( gpio, re, 40 );
+    mgo::ElectronicGearbox gearbox( gpio, re, 8 );
+    gearbox.setMaxStepsPerSecond( 100'000.0 );
+    // A step every four counts, so 500 steps is 50 ms
+    gearbox.setRatio( 1, 4 );
+    int64_t startCount = 0;
+    REQUIRE( re.nextCountAtDegrees( 0.0, 2'000, startCount ) );
+    REQUIRE( startCount > re.getPositionCount() );
+    gearbox.engage( startCount, 500, 0, 1, 0 );
+    REQUIRE( gearbox.isEngaged() );
+    // Progress is there to see on the way, not just at the end
+    long lastMade = 0;
+    bool seenPartWay = false;
+    mgo::ElectronicGearbox::Progress progress = gearbox.getProgress();
+    while( progress.engaged )
+    {
+        REQUIRE( progress.stepsMade >= lastMade );
+        lastMade = progress.stepsMade;
+        if( lastMade > 0 && lastMade < 500 ) seenPartWay = true;
+        std::this_thread::sleep_for( std::chrono::microseconds( 500 ) );
+        progress = gearbox.getProgress();
+    }
+    REQUIRE( seenPartWay );
+    REQUIRE( progress.completed );
+    REQUIRE( progress.stepsMade == 500 );
+    REQUIRE( progress.correction == 0 );
+    REQUIRE( gpio.stepPulses == 500 );
+    // The first step came when the spindle got to the start, give or
+    // take a millisecond (25 counts) for the test not being realtime
+    REQUIRE( std::abs( gearbox.getLastStartErrorCounts() ) < 25.0 );
+
+    // Disengaging part way says how many were made, which the motor
+    // owner needs to know where the carriage is
+    gpio.stepPulses = 0;
+    REQUIRE( re.nextCountAtDegrees( 0.0, 2'000, startCount ) );
+    gearbox.engage( startCount, 1'000'000, 0, 1, 0 );
+    while( gearbox.getProgress().stepsMade < 100 )
+    {
+        std::this_thread::sleep_for( std::chrono::microseconds( 500 ) );
+    }
+    gearbox.disengage();
+    progress = gearbox.getProgress();
+    REQUIRE( ! progress.engaged );
+    REQUIRE( ! progress.completed );
+    REQUIRE( progress.stepsMade >= 100 );
+    REQUIRE( progress.stepsMade == gpio.stepPulses );
+}
+
+TEST_CASE( "Gearbox: Stops when the spindle does" )
+{
+    ClockGpio gpio;
+    mgo::RotaryEncoder re( gpio, 23, 24, 100, 1, 1 );
+    Spindle spindle( gpio, re, 40 );
+    mgo::ElectronicGearbox gearbox( gpio, re, 8 );
+    gearbox.setMaxStepsPerSecond( 100'000.0 );
+    gearbox.setRatio( 1, 4 );
+    int64_t startCount = 0;
+    REQUIRE( re.nextCountAtDegrees( 0.0, 2'000, startCount ) );
+    gearbox.engage( startCount, 1'000'000, 0, 1, 0 );
+    while( gearbox.getProgress().stepsMade < 100 )
+    {
+        std::this_thread::sleep_for( std::chrono::microseconds( 500 ) );
+    }
+    spindle.stop();
+    // Time for the last edges to come through, and for anything
+    // running on at the old speed to show
+    std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+    long atStop = gpio.stepPulses;
+    std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+    REQUIRE( gpio.stepPulses == atStop );
+    // Never a step for a count the spindle didn't reach
+    REQUIRE( atStop <= ( re.getPositionCount() - startCount ) / 4 );
+    // Still waiting for it to turn again, not given up
+    REQUIRE( gearbox.isEngaged() );
+    gearbox.disengage();
+    REQUIRE( ! gearbox.getProgress().completed );
+}
+
+TEST_CASE( "Gearbox: Slips in and leaves out steps to follow the pitch table" )
+{
+    ClockGpio gpio;
+    mgo::RotaryEncoder re( gpio, 23, 24, 100, 1, 1 );
+    Spindle spindle( gpio, re, 40 );
+    mgo::ElectronicGearbox gearbox( gpio, re, 8 );
+    gearbox.setMaxStepsPerSecond( 100'000.0 );
+    gearbox.setRatio( 1, 4 );
+    // 0.01 mm per step, so 1 mm is 100 steps. Five extra steps by 1 mm,
+    // then three of them taken away again by 2 mm.
+    mgo::PitchCompensation table( {
+        { 0.0, 0.0 },
+        { 1.0, 5.0 },
+        { 2.0, 2.0 }
+        } );
+    gearbox.setPitchCompensation( table, 0.01 );
+
+    int64_t startCount = 0;
+    REQUIRE( re.nextCountAtDegrees( 0.0, 2'000, startCount ) );
+    gearbox.engage( startCount, 200, 0, 1, 0 );
+    while( gearbox.isEngaged() )
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+    mgo::ElectronicGearbox::Progress progress = gearbox.getProgress();
+    REQUIRE( progress.completed );
+    // The motor only counts the ones it was asked for
+    REQUIRE( progress.stepsMade == 200 );
+    REQUIRE( progress.correction == table.stepsAt( 2.0 ) );
+    REQUIRE( progress.correction == 2 );
+    // Five extra on the way up, three left out on the way down
+    REQUIRE( gpio.stepPulses == 202 );
+
+    // Coming back, the correction comes off again: three left out,
+    // then five slipped in
+    gpio.stepPulses = 0;
+    REQUIRE( re.nextCountAtDegrees( 0.0, 2'000, startCount ) );
+    gearbox.engage( startCount, 200, 200, -1, progress.correction );
+    while( gearbox.isEngaged() )
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+    progress = gearbox.getProgress();
+    REQUIRE( progress.completed );
+    REQUIRE( progress.stepsMade == 200 );
+    REQUIRE( progress.correction == 0 );
+    REQUIRE( gpio.stepPulses == 202 );
+}
+
+TEST_CASE( "Threading: Passes reach the full depth along the flank" )
+{
+    // M6 male, 0.613 mm deep: 12 passes of 0.05 mm and a last one of
+    // 0.013 mm, then two spring passes
+    auto passes = mgo::planThreadingPasses( 0.613f, mgo::INFEED, mgo::SIDEFEED, 2 );
+    REQUIRE( passes.size() == 15 );
+    REQUIRE( passes.front().depth == Approx( 0.05f ) );
+    REQUIRE( passes.at( 12 ).depth == Approx( 0.613f ) );
+    REQUIRE( ! passes.at( 12 ).spring );
+    for( const auto& pass : passes )
+    {
+        // tan 29.5°
+        REQUIRE( pass.sidefeed / pass.depth == Approx( 0.5658f ).epsilon( 0.001 ) );
+    }
+    REQUIRE( passes.back().spring );
+    REQUIRE( passes.back().depth == Approx( 0.613f ) );
+    // An exact number of infeeds doesn't gain a sliver of a pass
+    REQUIRE( mgo::planThreadingPasses( 0.5f, 0.05f, 0.f, 0 ).size() == 10 );
+}
+
+TEST_CASE( "PriorityMutex: Locks like a std::mutex" )
+{
+    mgo::PriorityMutex mutex;
+    long total = 0;
+    {
+        std::unique_lock<mgo::PriorityMutex> lock( mutex, std::try_to_lock );
+        REQUIRE( lock.owns_lock() );
+        REQUIRE( mutex.heldByThisThread() );
+        // Held here, so another thread can't have it
+        bool otherGotIt = true;
+        bool otherHeldIt = true;
+        std::thread( [ & ]()
+            {
+                otherHeldIt = mutex.heldByThisThread();
+                std::unique_lock<mgo::PriorityMutex> other( mutex, std::try_to_lock );
+                otherGotIt = other.owns_lock();
+            } ).join();
+        REQUIRE( ! otherGotIt );
+        REQUIRE( ! otherHeldIt );
+    }
+    REQUIRE( ! mutex.heldByThisThread() );
+    std::vector<std::thread> threads;
+    for( int n = 0; n < 4; ++n )
+    {
+        threads.emplace_back( [ & ]()
+            {
+                for( int i = 0; i < 10'000; ++i )
+                {
+                    std::lock_guard<mgo::PriorityMutex> lock( mutex );
+                    ++total;
+                }
+            } );
+    }
+    for( auto& thread : threads )
+    {
+        thread.join();
+    }
+    REQUIRE( total == 40'000 );
+}
+
+TEST_CASE( "SpscRing: Fill, overflow and drain" )
+{
+    mgo::SpscRing<int, 8> ring;
+    for( int n = 0; n < 8; ++n )
+    {
+        REQUIRE( ring.push( n ) );
+    }
+    // Full - further pushes are dropped
+    REQUIRE( ! ring.push( 99 ) );
+    int item = -1;
+    for( int n = 0; n < 8; ++n )
+    {
+        REQUIRE( ring.pop( item ) );
+        REQUIRE( item == n );
+    }
+    REQUIRE( ! ring.pop( item ) );
+    // And it wraps around correctly after being emptied
+    REQUIRE( ring.push( 42 ) );
+    REQUIRE( ring.pop( item ) );
+    REQUIRE( item == 42 );
+}
+
+TEST_CASE( "MpscQueue: Several producers, nothing lost or repeated" )
+{
+    mgo::MpscQueue<int, 8> queue;
+    int item = -1;
+    REQUIRE( ! queue.pop( item ) );
+    for( int n = 0; n < 8; ++n )
+    {
+        REQUIRE( queue.push( n ) );
+    }
+    REQUIRE( ! queue.push( 99 ) );
+    for( int n = 0; n < 8; ++n )
+    {
+        REQUIRE( queue.pop( item ) );
+        REQUIRE( item == n );
+    }
+    REQUIRE( ! queue.pop( item ) );
+
+    // Four threads push their own numbers while we take them off; each
+    // thread's come out in order, and every one comes out once
+    constexpr int perThread = 10'000;
+    std::vector<std::thread> producers;
+    for( int t = 0; t < 4; ++t )
+    {
+        producers.emplace_back( [ &queue, t ]()
+            {
+                for( int n = 0; n < perThread; ++n )
+                {
+                    while( ! queue.push( t * perThread + n ) )
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            } );
+    }
+    std::vector<int> next( 4, 0 );
+    int received = 0;
+    bool inOrder = true;
+    while( received < 4 * perThread )
+    {
+        if( queue.pop( item ) )
+        {
+            int t = item / perThread;
+            inOrder = inOrder && item % perThread == next.at( t );
+            ++next.at( t );
+            ++received;
+        }
+    }
+    for( auto& producer : producers )
+    {
+        producer.join();
+    }
+    REQUIRE( inOrder );
+    REQUIRE( next == std::vector<int>( 4, perThread ) );
+    REQUIRE( ! queue.pop( item ) );
+}
+
+TEST_CASE( "KeyBindings: Every key in every mode goes somewhere allowed" )
+{
+    // A key remapped to leader, to check the default one is given up
+    mgo::KeyBindings keys( mgo::key::q, mgo::key::x );
+    std::vector<bool> reached( mgo::ACTION_COUNT, false );
+    std::vector<int> allKeys;
+    for( int k = 0; k < static_cast<int>( mgo::KEY_CODES ); ++k )
+    {
+        allKeys.push_back( k );
+    }
+    allKeys.push_back( mgo::key::CtrlQ );
+    allKeys.push_back( 100'000 );
+    bool allowed = true;
+    bool leadersComplete = true;
+    for( std::size_t m = 0; m < mgo::MODE_COUNT; ++m )
+    {
+        auto mode = static_cast<mgo::Mode>( m );
+        for( std::size_t km = 0; km < mgo::KEY_MODE_COUNT; ++km )
+        {
+            for( bool retracted : { false, true } )
+            {
+                for( int k : allKeys )
+                {
+                    mgo::Action action = keys.modeAction( mode, retracted, k );
+                    if( action == mgo::Action::Pass )
+                    {
+                        action = keys.keyModeAction( static_cast<mgo::KeyMode>( km ), k );
+                        // A leader's table has nothing to pass it on to
+                        leadersComplete = leadersComplete && action != mgo::Action::Pass;
+                    }
+                    reached.at( mgo::toIndex( action ) ) = true;
+                    const mgo::ActionInfo& info = mgo::ACTIONS.at( mgo::toIndex( action ) );
+                    if( info.changesMode &&
+                        ! ( mgo::TRANSITIONS.at( m ) & mgo::modeBit( info.to ) ) )
+                    {
+                        allowed = false;
+                    }
+                }
+            }
+        }
+    }
+    REQUIRE( leadersComplete );
+    REQUIRE( allowed );
+    // Everything can be done from somewhere
+    for( std::size_t a = 0; a < mgo::ACTION_COUNT; ++a )
+    {
+        INFO( mgo::ACTIONS.at( a ).name );
+        REQUIRE( ( reached.at( a ) || a == mgo::toIndex( mgo::Action::Pass ) ) );
+    }
+
+    using mgo::Action;
+    using mgo::KeyMode;
+    using mgo::Mode;
+    namespace key = mgo::key;
+    REQUIRE( keys.keyModeAction( KeyMode::None, key::q ) == Action::Axis1Leader );
+    REQUIRE( keys.keyModeAction( KeyMode::None, key::z ) == Action::StopAll );
+    REQUIRE( keys.keyModeAction( KeyMode::None, key::x ) == Action::Axis2Leader );
+    // Keys past the table would take every other such key with them
+    REQUIRE_THROWS( mgo::KeyBindings( 512, key::x ) );
+    REQUIRE_THROWS( mgo::KeyBindings( key::q, key::CtrlQ ) );
+    REQUIRE( keys.keyModeAction( KeyMode::Axis1, key::ONE ) == Action::Axis1SpeedPreset1 );
+    REQUIRE( keys.keyModeAction( KeyMode::Function, key::COMMA ) == Action::OpenTaper );
+    REQUIRE( keys.keyModeAction( KeyMode::Function, key::SPACE ) == Action::Ignore );
+    // Typing, and keys which make no sense in a dialog
+    REQUIRE( keys.modeAction( Mode::Radius, false, key::MINUS ) == Action::Type );
+    REQUIRE( keys.modeAction( Mode::Radius, false, key::COMMA ) == Action::Ignore );
+    REQUIRE( keys.modeAction( Mode::Axis1GoTo, false, key::SPACE ) == Action::Type );
+    REQUIRE( keys.modeAction( Mode::Threading, false, key::ESC ) == Action::CancelThreading );
+    REQUIRE( keys.modeAction( Mode::Help, false, key::ENTER ) == Action::Accept );
+    REQUIRE( keys.modeAction( Mode::Help, false, key::F2 ) == Action::Pass );
+    REQUIRE( keys.modeAction( Mode::None, true, key::UP ) == Action::Ignore );
+    REQUIRE( keys.modeAction( Mode::None, true, key::LEFT ) == Action::Pass );
+}
+
+TEST_CASE( "Latency: Keys are timed to the first step" )
+{
+    mgo::LatencyHistogram histogram;
+    for( uint32_t us : { 1u, 3u, 3u, 100u, 5'000'000u } )
+    {
+        histogram.add( us );
+    }
+    REQUIRE( histogram.getCount() == 5 );
+    REQUIRE( histogram.getMax() == 5'000'000u );
+    REQUIRE( histogram.getBucket( 0 ) == 1 );
+    REQUIRE( histogram.getBucket( 2 ) == 2 ); // 3 us is in (2, 4]
+    REQUIRE( histogram.getBucket( mgo::LatencyHistogram::BUCKETS - 1 ) == 1 );
+    REQUIRE( histogram.getPercentile( 0.5 ) == 4 );
+    REQUIRE( histogram.getPercentile( 0.8 ) == 128 );
+    REQUIRE( histogram.getPercentile( 1.0 ) == 5'000'000u );
+
+    using Clock = mgo::LatencyMonitor::Clock;
+    using mgo::Action;
+    using mgo::LatencyStage;
+    using std::chrono::microseconds;
+    mgo::LatencyMonitor monitor;
+    Clock::time_point polled = Clock::now();
+
+    // Starts a motor from rest, which writes its direction pin, then steps
+    monitor.begin( Action::Axis1MoveLeft, polled, polled + microseconds( 10 ),
+        polled + microseconds( 100 ), false );
+    monitor.modelCalled( true, polled + microseconds( 200 ) );
+    monitor.motorWrite( false );
+    monitor.motorWrite( false );
+    monitor.motorWrite( true );
+    monitor.motorWrite( true );
+    for( LatencyStage stage : { LatencyStage::Polled, LatencyStage::Converted,
+        LatencyStage::Dispatched, LatencyStage::ModelCalled, LatencyStage::MotorStarted,
+        LatencyStage::FirstStep } )
+    {
+        REQUIRE( monitor.getHistogram( Action::Axis1MoveLeft, stage ).getCount() == 1 );
+    }
+    REQUIRE( monitor.getHistogram( Action::Axis1MoveLeft, LatencyStage::Dispatched ).getMax()
+        == 100 );
+    REQUIRE( monitor.getHistogram( Action::Axis1MoveLeft, LatencyStage::ModelCalled ).getMax()
+        == 200 );
+
+    // The model starts the motor, then waits for it to finish before it
+    // returns: the wait isn't the model's, and the step is still seen
+    monitor.begin( Action::Axis1FastReturn, polled, polled, polled, false );
+    monitor.motorWrite( false );
+    monitor.modelWaiting( polled + microseconds( 300 ) );
+    monitor.motorWrite( true );
+    REQUIRE( monitor.getHistogram( Action::Axis1FastReturn, LatencyStage::Polled ).getCount()
+        == 0 );
+    monitor.modelCalled( false, polled + std::chrono::milliseconds( 800 ) );
+    REQUIRE( monitor.getHistogram( Action::Axis1FastReturn, LatencyStage::ModelCalled ).getMax()
+        == 300 );
+    REQUIRE( monitor.getHistogram( Action::Axis1FastReturn, LatencyStage::MotorStarted ).getCount()
+        == 1 );
+    REQUIRE( monitor.getHistogram( Action::Axis1FastReturn, LatencyStage::FirstStep ).getCount()
+        == 1 );
+
+    // The motors were already going, so their steps aren't this key's
+    monitor.begin( Action::Axis1NudgeLeft, polled, polled, polled, true );
+    monitor.motorWrite( true );
+    monitor.modelCalled( true, polled );
+    REQUIRE( monitor.getHistogram( Action::Axis1NudgeLeft, LatencyStage::ModelCalled ).getCount()
+        == 1 );
+    REQUIRE( monitor.getHistogram( Action::Axis1NudgeLeft, LatencyStage::FirstStep ).getCount()
+        == 0 );
+
+    // Doesn't start anything, so it's done once the model has it
+    monitor.begin( Action::Type, polled, polled, polled, false );
+    monitor.modelCalled( false, polled );
+    monitor.motorWrite( true );
+    REQUIRE( monitor.getHistogram( Action::Type, LatencyStage::ModelCalled ).getCount() == 1 );
+    REQUIRE( monitor.getHistogram( Action::Type, LatencyStage::FirstStep ).getCount() == 0 );
+
+    // Nothing ever steps, so it times out, then a key which was
+    // interrupted by the next
+    monitor.begin( Action::Axis2MoveIn, polled, polled, polled, false );
+    monitor.modelCalled( true, polled );
+    monitor.tick( polled + std::chrono::milliseconds( 500 ) );
+    REQUIRE( monitor.getHistogram( Action::Axis2MoveIn, LatencyStage::Polled ).getCount() == 0 );
+    monitor.tick( polled + mgo::LatencyMonitor::MOTOR_TIMEOUT + microseconds( 1 ) );
+    REQUIRE( monitor.getHistogram( Action::Axis2MoveIn, LatencyStage::Polled ).getCount() == 1 );
+    monitor.begin( Action::Axis2MoveIn, polled, polled, polled, false );
+    monitor.modelCalled( true, polled );
+    monitor.begin( Action::StopAll, polled, polled, polled, true );
+    REQUIRE( monitor.getHistogram( Action::Axis2MoveIn, LatencyStage::ModelCalled ).getCount()
+        == 2 );
+    REQUIRE( monitor.getHistogram( Action::Axis2MoveIn, LatencyStage::FirstStep ).getCount()
+        == 0 );
+
+    std::ostringstream oss;
+    monitor.write( oss );
+    REQUIRE( oss.str().find( "Z move left: 1 key\n" ) != std::string::npos );
+    REQUIRE( oss.str().find( "first step" ) != std::string::npos );
+}
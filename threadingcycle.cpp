@@ -0,0 +1,34 @@
+#include "threadingcycle.h"
+
+#include <cmath>
+
+namespace mgo
+{
+
+std::vector<ThreadingPass> planThreadingPasses(
+    float totalDepth,
+    float infeed,
+    float sidefeed,
+    int   springPasses
+    )
+{
+    std::vector<ThreadingPass> passes;
+    if( totalDepth <= 0.f || infeed <= 0.f ) return passes;
+    // A hair off, so a depth which is an exact number of infeeds
+    // doesn't get an extra pass from rounding
+    int count = static_cast<int>( std::ceil( totalDepth / infeed - 0.0001f ) );
+    float sidefeedPerMm = sidefeed / infeed;
+    for( int n = 1; n <= count; ++n )
+    {
+        // The last one may be shallower, to finish at exactly the depth
+        float depth = n == count ? totalDepth : n * infeed;
+        passes.push_back( { depth, depth * sidefeedPerMm, false } );
+    }
+    for( int n = 0; n < springPasses; ++n )
+    {
+        passes.push_back( { totalDepth, totalDepth * sidefeedPerMm, true } );
+    }
+    return passes;
+}
+
+} // end namespace
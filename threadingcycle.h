@@ -0,0 +1,28 @@
+#pragma once
+// Plans the passes for cutting a thread in one go. Each pass goes INFEED
+// deeper than the one before, and the tool is moved along Z by SIDEFEED
+// for every INFEED it goes in, so it feeds in along the 29.5° flank, as
+// with a compound slide set over. The final depth is then repeated for a
+// few spring passes, which take off whatever the tool sprang away from.
+
+#include <vector>
+
+namespace mgo
+{
+
+struct ThreadingPass
+{
+    float depth;    // total X infeed, mm
+    float sidefeed; // total Z offset from the start, mm (the first pass
+                    // already has one pass's worth)
+    bool  spring;   // a repeat of the final depth
+};
+
+std::vector<ThreadingPass> planThreadingPasses(
+    float totalDepth,
+    float infeed,       // per pass
+    float sidefeed,     // per pass
+    int   springPasses
+    );
+
+} // end namespace
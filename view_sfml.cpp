@@ -288,6 +288,7 @@ int  ViewSfml::getInput()
     }
 
     // We only get here if a key was pressed
+    auto polled = std::chrono::steady_clock::now();
     if( lastKey == event.key.code && clock.getElapsedTime().asMilliseconds() - lastTime < 100 )
     {
         // Debounce
@@ -295,11 +296,28 @@ int  ViewSfml::getInput()
     }
     lastKey = event.key.code;
     lastTime = clock.getElapsedTime().asMilliseconds();
-    return convertKeyCode( event );
+    int code = convertKeyCode( event );
+    m_inputTimes = { polled, std::chrono::steady_clock::now() };
+    return code;
 }
 
-void ViewSfml::updateDisplay( const Model& model )
+InputTimes ViewSfml::getInputTimes() const
 {
+    return m_inputTimes;
+}
+
+bool ViewSfml::updateDisplay( const Model& model )
+{
+    // The model is only held while everything is drawn into the window's
+    // buffer, not while that's shown, which can wait for the screen.
+    // If it's busy (a key waiting for a motor to stop, say), what's on
+    // the screen stays there until next time rather than holding up
+    // the keys.
+    std::unique_lock<PriorityMutex> lock( model.m_mutex, std::try_to_lock );
+    if( ! lock.owns_lock() )
+    {
+        return false;
+    }
     m_window->clear();
     updateTextFromModel( model );
 
@@ -333,7 +351,8 @@ void ViewSfml::updateDisplay( const Model& model )
         m_window->draw( *m_txtWarning );
         m_window->draw( *m_txtNotification );
         if( model.m_enabledFunction == Mode::Taper ||
-            model.m_enabledFunction == Mode::Radius )
+            model.m_enabledFunction == Mode::Radius ||
+            model.m_enabledFunction == Mode::Profile )
         {
             m_window->draw( *m_txtTaperOrRadius );
         }
@@ -387,7 +406,9 @@ void ViewSfml::updateDisplay( const Model& model )
             m_window->draw( *m_txtMisc5 );
         }
     }
+    lock.unlock();
     m_window->display();
+    return true;
 }
 
 void ViewSfml::updateTextFromModel( const Model& model )
@@ -442,6 +463,11 @@ void ViewSfml::updateTextFromModel( const Model& model )
     {
         m_txtTaperOrRadius->setString( fmt::format( "Radius: {}", model.m_radius ) );
     }
+    else if( model.m_enabledFunction == Mode::Profile )
+    {
+        m_txtTaperOrRadius->setString( fmt::format( "Profile: {} points",
+            model.m_formProfile.getPointCount() ) );
+    }
 
     for( std::size_t n = 0; n < m_txtMemoryLabel.size(); ++n )
     {
@@ -481,7 +507,15 @@ void ViewSfml::updateTextFromModel( const Model& model )
     switch( model.m_enabledFunction )
     {
         case Mode::Threading:
-            m_txtNotification->setString( "THREADING" );
+            if( model.m_threadStarts > 1 )
+            {
+                m_txtNotification->setString( fmt::format( "THREAD {}/{}",
+                    model.m_threadStart + 1, model.m_threadStarts ) );
+            }
+            else
+            {
+                m_txtNotification->setString( "THREADING" );
+            }
             break;
         case Mode::Taper:
             m_txtNotification->setString( "TAPERING" );
@@ -489,6 +523,9 @@ void ViewSfml::updateTextFromModel( const Model& model )
         case Mode::Radius:
             m_txtNotification->setString( "RADIUS" );
             break;
+        case Mode::Profile:
+            m_txtNotification->setString( "PROFILE" );
+            break;
         default:
             m_txtNotification->setString( "" );
     }
@@ -498,8 +535,8 @@ void ViewSfml::updateTextFromModel( const Model& model )
         case Mode::Help:
         {
             m_txtMode->setString( "Help" );
-            m_txtMisc1->setString( "Modes: (F2=Leader) s=Setup t=Thread p=taPer r=Retract" );
-            m_txtMisc2->setString( "" );
+            m_txtMisc1->setString( "Modes: (F2=Leader) s=Setup t=Thread p=taPer r=Retract m=Misalign" );
+            m_txtMisc2->setString( "F12 logs how long keys are taking" );
             m_txtMisc3->setString( "Z axis speed: 1-5, X axis speed: 6-0" );
             m_txtMisc4->setString( "[ and ] select mem to use. M store, Enter return (F fast)." );
             m_txtMisc5->setString( "WASD = nudge 0.025mm. Space to stop all motors. R retract." );
@@ -535,6 +572,19 @@ void ViewSfml::updateTextFromModel( const Model& model )
             m_txtWarning->setString( "Enter to keep enabled, Esc to disable, Del to clear" );
             break;
         }
+        case Mode::MisalignmentSetup:
+        {
+            m_txtMode->setString( "Misalignment Correction" );
+            m_txtMisc1->setString( fmt::format( "Correction angle (degrees): {}_",
+                model.m_input ) );
+            m_txtMisc2->setString( fmt::format( "Currently {}. Applied to every Z move.",
+                model.m_misalignmentCorrection ) );
+            m_txtMisc3->setString( "Or to work it out from a test cut, enter the diameter at" );
+            m_txtMisc4->setString( "the chuck end, at the tail end, and the distance apart" );
+            m_txtMisc5->setString( "(e.g. 20.04,20,100). Copy to lc.cfg to keep it." );
+            m_txtWarning->setString( "Enter to set, Esc to cancel, Del to clear" );
+            break;
+        }
         case Mode::Radius:
         {
             m_txtMode->setString( "Radius" );
@@ -543,14 +593,28 @@ void ViewSfml::updateTextFromModel( const Model& model )
             m_txtMisc2->setString(
                 "Important! Ensure the tool is at the radius of the workpiece," );
             m_txtMisc3->setString(
-                "near the end, and set axes to ZERO (this drives the operation)." );
+                "near the end. Where it is now drives the operation." );
             m_txtMisc4->setString(
                 "Then cut OUTWARDS, and move INWARDS gradually for subsequent cuts." );
             m_txtMisc5->setString(
-                "Re-zero each time and use relative movement for each cut." );
+                "Re-enter each time, use relative moves. Negative is concave." );
             m_txtWarning->setString( "Enter to keep enabled, Esc to disable, Del to clear" );
             break;
         }
+        case Mode::Profile:
+        {
+            m_txtMode->setString( "Profile" );
+            m_txtMisc1->setString( model.m_formProfileStatus );
+            m_txtMisc2->setString(
+                "Important! Ensure the tool is at the first point of the profile." );
+            m_txtMisc3->setString(
+                "Where it is now drives the operation." );
+            m_txtMisc4->setString(
+                "Moving Z then takes X along the profile, as with a radius." );
+            m_txtMisc5->setString( "The file is set by FormProfileFile in the config." );
+            m_txtWarning->setString( "Enter to keep enabled, Esc to disable" );
+            break;
+        }
         case Mode::Threading:
         {
             m_txtMode->setString( "Thread" );
@@ -560,8 +624,8 @@ void ViewSfml::updateTextFromModel( const Model& model )
                 fmt::format( "Male   OD: {} mm, cut: {} mm", tp.maleOd, tp.cutDepthMale ) );
             m_txtMisc3->setString(
                 fmt::format( "Female ID: {} mm, cut: {} mm", tp.femaleId, tp.cutDepthFemale ) );
-            m_txtMisc4->setString( "" );
-            m_txtMisc5->setString( "Press Up/Down to change." );
+            m_txtMisc4->setString( fmt::format( "Number of starts: {}_", model.m_input ) );
+            m_txtMisc5->setString( "Up/Down changes thread. N cycles multi-starts, C cuts all passes." );
             m_txtWarning->setString( "Enter to keep enabled, Esc to disable" );
             break;
         }
@@ -619,8 +683,10 @@ void ViewSfml::updateTextFromModel( const Model& model )
                 model.m_config.read( "Axis1Label", "Z" ) ) );
             m_txtMisc1->setString( "" );
             m_txtMisc2->setString( "Specify a value" );
-            m_txtMisc3->setString( "" );
-            m_txtMisc4->setString( "" );
+            m_txtMisc3->setString( fmt::format( "or {},{} to move both in a straight line",
+                model.m_config.read( "Axis1Label", "Z" ),
+                model.m_config.read( "Axis2Label", "X" ) ) );
+            m_txtMisc4->setString( "Points separated by spaces are gone through in turn" );
             m_txtMisc5->setString( fmt::format( "Position: {}_",
                 model.m_input ) );
             m_txtWarning->setString( "Enter to set, Esc to cancel" );
@@ -632,8 +698,10 @@ void ViewSfml::updateTextFromModel( const Model& model )
                 model.m_config.read( "Axis2Label", "Z" ) ) );
             m_txtMisc1->setString( "" );
             m_txtMisc2->setString( "Specify a value" );
-            m_txtMisc3->setString( "" );
-            m_txtMisc4->setString( "" );
+            m_txtMisc3->setString( fmt::format( "or {},{} to move both in a straight line",
+                model.m_config.read( "Axis1Label", "Z" ),
+                model.m_config.read( "Axis2Label", "X" ) ) );
+            m_txtMisc4->setString( "Points separated by spaces are gone through in turn" );
             m_txtMisc5->setString( fmt::format( "Position: {}_",
                 model.m_input ) );
             m_txtWarning->setString( "Enter to set, Esc to cancel" );
@@ -16,11 +16,13 @@ public:
     virtual void initialise( const Model& ) override;
     virtual void close() override;
     virtual int getInput() override;
-    virtual void updateDisplay( const Model& ) override;
+    virtual InputTimes getInputTimes() const override;
+    virtual bool updateDisplay( const Model& ) override;
     // Non-overrides:
     void updateTextFromModel( const Model& );
 private:
     std::unique_ptr<sf::RenderWindow> m_window;
+    InputTimes m_inputTimes;
     std::unique_ptr<sf::Font> m_font;
 
     // Main text items which are always displayed:
@@ -0,0 +1,23 @@
+#include "wakeup.h"
+
+namespace mgo
+{
+
+void Wakeup::notify()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_notified = true;
+    }
+    m_cv.notify_one();
+}
+
+bool Wakeup::waitUntil( Clock::time_point deadline )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    bool notified = m_cv.wait_until( lock, deadline, [ this ](){ return m_notified; } );
+    m_notified = false;
+    return notified;
+}
+
+} // end namespace
@@ -0,0 +1,30 @@
+#pragma once
+// Something for a thread to sleep on until either another thread has
+// something for it, or a time comes round. Notifications made while
+// nobody is waiting aren't lost: the next wait returns straight away.
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace mgo
+{
+
+class Wakeup
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Any thread
+    void notify();
+
+    // Returns true if notified, false if the deadline came first
+    bool waitUntil( Clock::time_point deadline );
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_notified{ false };
+};
+
+} // end namespace